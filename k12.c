@@ -0,0 +1,312 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * KangarooTwelve C Implementation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+#include "k12.h"
+#include "sha3_pool.h"
+#include <stdlib.h>	/* For malloc() / free() */
+#include <string.h>	/* For memcpy() */
+
+#define K12_ROUNDS		12
+#define K12_RATE		168	/* 1600 - 256bits of capacity */
+#define K12_CV_LEN		32
+
+/* Domain separation bytes */
+#define K12_DELIM_SINGLE	0x07	/* Input fits in a single chunk */
+#define K12_DELIM_LEAF		0x0B	/* Chaining values of chunks 1 - n */
+#define K12_DELIM_FINAL		0x06	/* Final node */
+
+/* Goes after the first chunk on the final node */
+static const uint8_t k12_marker[8] = { 0x03, 0, 0, 0, 0, 0, 0, 0 };
+static const uint8_t k12_terminator[2] = { 0xFF, 0xFF };
+
+/*
+ * The input to the tree is S = M || C || length_encode(|C|), since
+ * we don't want to copy M around we keep the three parts separate
+ * and only copy the chunks that cross them.
+ */
+struct k12_input {
+	const uint8_t *part[3];
+	size_t part_len[3];
+	size_t len;
+	/* length_encode() output, up to 8 bytes plus the length byte */
+	uint8_t enc[9];
+};
+
+/* Hashing work for the chunks after the first one,
+ * shared between the pool's workers */
+struct k12_job {
+	const struct k12_input *in;
+	/* Chaining value of chunk i (i > 0) is at (i - 1) * K12_CV_LEN */
+	uint8_t *cvs;
+	size_t num_chunks;
+	/* Chunks are handed out in groups of group_len */
+	size_t num_groups;
+	unsigned int group_len;
+	/* Multi-buffer engine to use for each number of ways */
+	const k1600_mb_engine_t *mb_eng[KECCAK1600_MAX_WAYS + 1];
+};
+
+
+/*********\
+* HELPERS *
+\*********/
+
+/* Big endian encoding of x with no leading zeroes,
+ * followed by the number of bytes used */
+static size_t
+k12_length_encode(size_t x, uint8_t *out)
+{
+	size_t len = 0;
+	size_t i = 0;
+
+	for (i = x; i > 0; i >>= 8)
+		len++;
+
+	for (i = 0; i < len; i++)
+		out[i] = x >> (8 * (len - i - 1));
+	out[len] = len;
+
+	return len + 1;
+}
+
+static void
+k12_input_init(struct k12_input *in, const void *msg, size_t msg_len,
+	       const void *custom, size_t custom_len)
+{
+	in->part[0] = msg;
+	in->part_len[0] = msg_len;
+	in->part[1] = custom;
+	in->part_len[1] = custom_len;
+	in->part[2] = in->enc;
+	in->part_len[2] = k12_length_encode(custom_len, in->enc);
+	in->len = msg_len + custom_len + in->part_len[2];
+}
+
+/* Absorb len bytes of S, starting from off */
+static void
+k12_input_update(k1600_ctx_t *ctx, const struct k12_input *in,
+		 size_t off, size_t len)
+{
+	size_t part_bytes = 0;
+	int i = 0;
+
+	for (i = 0; i < 3 && len > 0; i++) {
+		if (off >= in->part_len[i]) {
+			off -= in->part_len[i];
+			continue;
+		}
+		part_bytes = in->part_len[i] - off;
+		if (part_bytes > len)
+			part_bytes = len;
+		keccakf1600_update(ctx, in->part[i] + off, part_bytes);
+		len -= part_bytes;
+		off = 0;
+	}
+}
+
+/* Get a pointer to chunk idx of S, if the chunk is within M
+ * we return a pointer to M, if not we copy it to buf */
+static const uint8_t *
+k12_input_chunk(const struct k12_input *in, size_t idx, size_t *chunk_len,
+		uint8_t *buf)
+{
+	size_t off = idx * K12_CHUNK_SIZE;
+	size_t len = in->len - off;
+	size_t part_bytes = 0;
+	size_t buf_off = 0;
+	int i = 0;
+
+	if (len > K12_CHUNK_SIZE)
+		len = K12_CHUNK_SIZE;
+	*chunk_len = len;
+
+	if (off + len <= in->part_len[0])
+		return in->part[0] + off;
+
+	for (i = 0; i < 3 && len > 0; i++) {
+		if (off >= in->part_len[i]) {
+			off -= in->part_len[i];
+			continue;
+		}
+		part_bytes = in->part_len[i] - off;
+		if (part_bytes > len)
+			part_bytes = len;
+		memcpy(buf + buf_off, in->part[i] + off, part_bytes);
+		buf_off += part_bytes;
+		len -= part_bytes;
+		off = 0;
+	}
+
+	return buf;
+}
+
+
+/***************\
+* CHUNK HASHING *
+\***************/
+
+/*
+ * Hash count chunks starting from first, and write their chaining
+ * values to out. Full chunks go through the widest multi-buffer
+ * engine that fits, the rest (and the last chunk that may be
+ * shorter) through the default engine.
+ */
+static void
+k12_hash_chunks(const struct k12_job *job, size_t first, size_t count,
+		uint8_t *out, uint8_t (*bufs)[K12_CHUNK_SIZE])
+{
+	const void *msgs[KECCAK1600_MAX_WAYS];
+	void *mds[KECCAK1600_MAX_WAYS];
+	const uint8_t *chunk = NULL;
+	size_t chunk_len = 0;
+	size_t full = 0;
+	unsigned int ways = KECCAK1600_MAX_WAYS;
+	unsigned int i = 0;
+
+	/* Only the last chunk may be partial */
+	full = count;
+	if (first + count == job->num_chunks &&
+	    job->in->len % K12_CHUNK_SIZE)
+		full--;
+
+	while (count > 0) {
+		while (ways > 1 && (full < ways || !job->mb_eng[ways]))
+			ways >>= 1;
+
+		if (ways == 1) {
+			chunk = k12_input_chunk(job->in, first, &chunk_len, bufs[0]);
+			turboshake128_oneshot(chunk, chunk_len, K12_DELIM_LEAF,
+					      out, K12_CV_LEN);
+			if (full)
+				full--;
+			first++;
+			count--;
+			out += K12_CV_LEN;
+			continue;
+		}
+
+		for (i = 0; i < ways; i++) {
+			msgs[i] = k12_input_chunk(job->in, first + i, &chunk_len,
+						  bufs[i]);
+			mds[i] = out + i * K12_CV_LEN;
+		}
+		keccakp1600_oneshot_mb(job->mb_eng[ways], K12_ROUNDS, K12_RATE,
+				       msgs, K12_CHUNK_SIZE, mds, K12_CV_LEN,
+				       K12_DELIM_LEAF);
+		full -= ways;
+		first += ways;
+		count -= ways;
+		out += ways * K12_CV_LEN;
+	}
+}
+
+/* One group of chunks, for the pool's workers */
+static void
+k12_hash_group(void *arg, size_t group)
+{
+	const struct k12_job *job = arg;
+	uint8_t bufs[KECCAK1600_MAX_WAYS][K12_CHUNK_SIZE];
+	size_t first = 1 + group * job->group_len;
+	size_t count = job->num_chunks - first;
+
+	if (count > job->group_len)
+		count = job->group_len;
+	k12_hash_chunks(job, first, count,
+			job->cvs + (first - 1) * K12_CV_LEN, bufs);
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+void
+turboshake128_oneshot(const void *msg, size_t msg_len, uint8_t domain,
+		      void *md, size_t md_len)
+{
+	keccakp1600_oneshot(NULL, K12_ROUNDS, K12_RATE, msg, msg_len, md,
+			    md_len, domain);
+}
+
+void
+k12_oneshot(const void *msg, size_t msg_len, const void *custom,
+	    size_t custom_len, void *md, size_t md_len,
+	    unsigned int nthreads)
+{
+	uint8_t bufs[KECCAK1600_MAX_WAYS][K12_CHUNK_SIZE];
+	uint8_t cvs[KECCAK1600_MAX_WAYS * K12_CV_LEN];
+	const k1600_mb_engine_t *mb_eng = NULL;
+	struct k12_input in;
+	struct k12_job job;
+	k1600_ctx_t ctx;
+	uint8_t enc[9] = {0};
+	size_t enc_len = 0;
+	size_t count = 0;
+	size_t i = 0;
+
+	k12_input_init(&in, msg, msg_len, custom, custom_len);
+
+	/* Single chunk, no tree */
+	if (in.len <= K12_CHUNK_SIZE) {
+		keccakp1600_init(&ctx, NULL, K12_ROUNDS, K12_RATE, md_len,
+				 K12_DELIM_SINGLE);
+		k12_input_update(&ctx, &in, 0, in.len);
+		keccakf1600_final(&ctx, md);
+		return;
+	}
+
+	memset(&job, 0, sizeof(job));
+	job.in = &in;
+	job.num_chunks = (in.len + K12_CHUNK_SIZE - 1) / K12_CHUNK_SIZE;
+
+	/* Grab the multi-buffer engines that can do
+	 * reduced rounds, group chunks so that each
+	 * group fills the widest one */
+	job.group_len = 1;
+	for (i = 2; i <= KECCAK1600_MAX_WAYS; i <<= 1) {
+		mb_eng = keccakf1600_get_mb_engine(i);
+		if (!mb_eng || !mb_eng->permute_rounds)
+			continue;
+		job.mb_eng[i] = mb_eng;
+		job.group_len = i;
+	}
+	job.num_groups = (job.num_chunks - 1 + job.group_len - 1) / job.group_len;
+
+	/* Final node starts with the first chunk */
+	keccakp1600_init(&ctx, NULL, K12_ROUNDS, K12_RATE, md_len,
+			 K12_DELIM_FINAL);
+	k12_input_update(&ctx, &in, 0, K12_CHUNK_SIZE);
+	keccakf1600_update(&ctx, k12_marker, sizeof(k12_marker));
+
+	/* The pool spreads the groups over its workers (and this
+	 * thread), the chaining values are absorbed at the end */
+	if (nthreads != 1 && job.num_groups > 1)
+		job.cvs = malloc((job.num_chunks - 1) * K12_CV_LEN);
+
+	if (job.cvs) {
+		sha3_pool_run(nthreads, job.num_groups, k12_hash_group, &job);
+		keccakf1600_update(&ctx, job.cvs,
+				   (job.num_chunks - 1) * K12_CV_LEN);
+		free(job.cvs);
+	} else {
+		/* Hash the chunks on this thread, one group at a time,
+		 * and absorb their chaining values as we go so that
+		 * we don't need to keep them around. */
+		for (i = 1; i < job.num_chunks; i += count) {
+			count = job.num_chunks - i;
+			if (count > job.group_len)
+				count = job.group_len;
+			k12_hash_chunks(&job, i, count, cvs, bufs);
+			keccakf1600_update(&ctx, cvs, count * K12_CV_LEN);
+		}
+	}
+
+	enc_len = k12_length_encode(job.num_chunks - 1, enc);
+	keccakf1600_update(&ctx, enc, enc_len);
+	keccakf1600_update(&ctx, k12_terminator, sizeof(k12_terminator));
+	keccakf1600_final(&ctx, md);
+}
@@ -0,0 +1,36 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * KangarooTwelve C Implementation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _K12_H
+#define _K12_H
+
+/*
+ * KangarooTwelve (RFC 9861) is a tree hash on top of TurboSHAKE128,
+ * a SHAKE128-like sponge using Keccak-p[1600, 12]. The input is split
+ * in 8KB chunks, all chunks except the first one are hashed separately
+ * (so they can be hashed in parallel) and their chaining values are
+ * then appended to the first chunk and hashed together in a final node.
+ */
+
+#include <stddef.h>	/* For size_t */
+#include <stdint.h>	/* For typed integers */
+
+#define K12_CHUNK_SIZE	8192
+
+/* The domain separation byte goes from 0x01 to 0x7F */
+void turboshake128_oneshot(const void *msg, size_t msg_len, uint8_t domain,
+			   void *md, size_t md_len);
+
+/* Chunks are hashed by nthreads threads (including the calling one),
+ * 0 means one for each online cpu and 1 means only the calling thread.
+ * The other threads come from a pool that's created on first use and
+ * kept around, if it's busy with another call the calling thread
+ * hashes everything itself. */
+void k12_oneshot(const void *msg, size_t msg_len, const void *custom,
+		 size_t custom_len, void *md, size_t md_len,
+		 unsigned int nthreads);
+
+#endif /* _K12_H */
@@ -4,6 +4,9 @@
  * Copyright (C) 2019 Nick Kossifidis <mick@ics.forth.gr>
  */
 
+#ifndef _KECCAK1600_H
+#define _KECCAK1600_H
+
 /*
  * Keccak's state is a cuboid with 5bits width (x),
  * 5bits height (y) and <lane> bits depth, where a
@@ -20,6 +23,7 @@
 
 #include <stdint.h>	/* For typed integers */
 #include <stddef.h>	/* For size_t */
+#include <string.h>	/* For memcpy() */
 
 #define KECCAK_NUM_COLS		5
 #define KECCAK_NUM_ROWS		5
@@ -43,6 +47,14 @@ typedef union {
 	uint8_t A_bytes[KECCAK1600_STATE_SIZE];
 } k1600_state_t;
 
+/* A lane split into a word with its even bits and
+ * one with its odd bits, for 32-bit targets, see
+ * keccak1600_bi32.c */
+typedef struct {
+	uint32_t e;
+	uint32_t o;
+} k1600_bi_lane_t;
+
 /* Left-rotate a lane, keep it like this so that the
  * compiler recognizes it and optimizes it using arch-specific
  * bit manip. instructions (rol, rori etc). */
@@ -52,19 +64,434 @@ static inline lane_t rotl_lane(lane_t val, int times)
 		((val) >> (KECCAK1600_LANE_BITS - (times))));
 }
 
+/*
+ * FIPS 202 maps the byte stream to lanes in little endian order, so
+ * on little endian hosts A and A_bytes are two views of the same
+ * thing. On big endian hosts lanes get byte-swapped when loaded from
+ * the input / stored to the output (compilers emit bswap / movbe /
+ * rev8 for __builtin_bswap64), and single bytes of the state are
+ * accessed through shifts.
+ */
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define KECCAK1600_BIG_ENDIAN	1
+#else
+#define KECCAK1600_BIG_ENDIAN	0
+#endif
+
+/* Load a lane from the input, the memcpy is well defined for any
+ * alignment and compilers turn it into a single load when the
+ * target handles misaligned accesses or the pointer is known to be
+ * aligned (e.g. via __builtin_assume_aligned). On targets where
+ * misaligned loads are slow (or trap, as on many RISC-V cores) it
+ * becomes a byte-by-byte load, so hot paths check the alignment
+ * once and use an aligned variant whenever they can. */
+static inline lane_t load_lane(const void *p)
+{
+	lane_t val = 0;
+	memcpy(&val, p, sizeof(lane_t));
+#if KECCAK1600_BIG_ENDIAN
+	val = __builtin_bswap64(val);
+#endif
+	return val;
+}
+
+static inline void store_lane(void *p, lane_t val)
+{
+#if KECCAK1600_BIG_ENDIAN
+	val = __builtin_bswap64(val);
+#endif
+	memcpy(p, &val, sizeof(lane_t));
+}
+
+/* Byte off of the state as seen by the sponge (lanes are
+ * little endian), on little endian hosts that's A_bytes */
+static inline void xor_state_byte(k1600_state_t *st, size_t off, uint8_t val)
+{
+#if KECCAK1600_BIG_ENDIAN
+	st->A[off / KECCAK1600_LANE_BYTES] ^=
+		((lane_t) val) << (8 * (off % KECCAK1600_LANE_BYTES));
+#else
+	st->A_bytes[off] ^= val;
+#endif
+}
+
+static inline uint8_t get_state_byte(const k1600_state_t *st, size_t off)
+{
+#if KECCAK1600_BIG_ENDIAN
+	return st->A[off / KECCAK1600_LANE_BYTES] >>
+		(8 * (off % KECCAK1600_LANE_BYTES));
+#else
+	return st->A_bytes[off];
+#endif
+}
+
+#define KECCAK1600_LANE_ALIGNED(_p)	((((uintptr_t) (_p)) & \
+					  (sizeof(lane_t) - 1)) == 0)
+
+/* Targets where misaligned loads are as fast as aligned ones,
+ * there's no point in having separate variants there */
+#if defined(__x86_64__) || defined(__i386__) || \
+    defined(__ARM_FEATURE_UNALIGNED) || defined(__riscv_misaligned_fast)
+#define KECCAK1600_FAST_UNALIGNED	1
+#define KECCAK1600_ASSUME_ALIGNED(_p)	(_p)
+#else
+#define KECCAK1600_ASSUME_ALIGNED(_p)	__builtin_assume_aligned(_p, \
+							 sizeof(lane_t))
+/* Blocks to copy at a time when the input is misaligned */
+#define KECCAK1600_BOUNCE_BLOCKS	4
+#endif
+
 /* Used for handling multiple underlying implementations */
 typedef void (*keccak1600_spf) (k1600_state_t * st);
+/* Same for Keccak-p[1600, nr], that only does the last nr rounds */
+typedef void (*keccak1600_sprf) (k1600_state_t * st, unsigned int nr);
+/* Absorb / squeeze num_blocks full blocks of rate_lanes lanes
+ * in one go, permuting after each absorbed block / before each
+ * squeezed one, for backends that can keep the state on registers.
+ * Both the input and the output are lane aligned unless
+ * KECCAK1600_FAST_UNALIGNED, the sponge goes through an aligned
+ * bounce buffer otherwise. */
+typedef void (*keccak1600_absorbf) (k1600_state_t * st, const void *msg,
+				    size_t num_blocks, unsigned int rate_lanes,
+				    unsigned int nr);
+typedef void (*keccak1600_squeezef) (k1600_state_t * st, void *out,
+				     size_t num_blocks, unsigned int rate_lanes,
+				     unsigned int nr);
+/* Convert a state from / to the standard encoding, dst may be src */
+typedef void (*keccak1600_convf) (k1600_state_t * dst,
+				  const k1600_state_t * src);
+
+/* Backend descriptor, the permutation function always goes
+ * together with the state encoding it expects (lane complementing
+ * or not). Those are immutable and each hashing context carries
+ * a pointer to one, so that threads can use different backends
+ * (or switch the default) without affecting each other. */
+typedef struct {
+	const char *name;
+	keccak1600_spf permute;
+	/* Optional, for reduced-round constructions */
+	keccak1600_sprf permute_rounds;
+	/* Optional, whole-block absorb / squeeze (the latter
+	 * outputs the state as is, so only without export) */
+	keccak1600_absorbf absorb;
+	keccak1600_squeezef squeeze;
+	/* Optional, for backends that keep the state in their own
+	 * encoding, import goes from the standard one to it (the
+	 * sponge calls it once on init) and export back (on each
+	 * squeezed block). The sponge xors its input to the state as
+	 * is, so the encoding must commute with that, e.g. a fixed xor
+	 * mask like the lane complementing one. */
+	keccak1600_convf state_import;
+	keccak1600_convf state_export;
+	/* Set when the above do lane complementing */
+	int lc;
+	/* CPU features required to run it (K1600_HWCAP_*) */
+	unsigned int hwcaps;
+	/* Preference when picking one without calibration */
+	int prio;
+} k1600_engine_t;
+
+/* CPU features relevant to the various backends */
+#define K1600_HWCAP_RV_ZBB		(1 << 0)
+#define K1600_HWCAP_RV_ZBKB		(1 << 1)
+#define K1600_HWCAP_RV_V		(1 << 2)
+#define K1600_HWCAP_RV_ZVBB		(1 << 3)
+#define K1600_HWCAP_X86_AVX2		(1 << 9)
+#define K1600_HWCAP_X86_AVX512F		(1 << 10)
+
+/* Multi-buffer backends work on up to KECCAK1600_MAX_WAYS
+ * independent states, interleaved lane by lane so that lane
+ * i of state j is at A[i * ways + j]. */
+#define KECCAK1600_MAX_WAYS	8
+typedef void (*keccak1600_mb_spf) (lane_t *A);
+typedef void (*keccak1600_mb_sprf) (lane_t *A, unsigned int nr);
+
+typedef struct {
+	const char *name;
+	keccak1600_mb_spf permute;
+	/* Optional, for reduced-round constructions */
+	keccak1600_mb_sprf permute_rounds;
+	unsigned int ways;
+	unsigned int hwcaps;
+	int prio;
+} k1600_mb_engine_t;
+
+/* Context for incremental hashing (init/update/final), it
+ * keeps the state together with the offset within the
+ * current block, so that full blocks can be absorbed
+ * straight from the caller's buffer across calls and only
+ * the tail bytes of each call are xored in byte by byte. */
+typedef struct {
+	k1600_state_t st;
+	const k1600_engine_t *eng;
+	size_t rate_bytes;
+	size_t md_len;
+	size_t block_off;
+	unsigned int rounds;
+	/* Set once padded, after that block_off is
+	 * how far we've squeezed the current block */
+	int squeezing;
+	uint8_t delim_suffix;
+} k1600_ctx_t;
 
+/* Same for a multi-buffer engine, it keeps eng->ways states
+ * interleaved (lane i of state j at A[i * ways + j]) across
+ * calls, so that each batch of messages stays in the engine's
+ * layout from the first block to the last. Each update takes
+ * the same number of bytes from each message and absorbs them
+ * straight to the interleaved state (only touching the rate
+ * lanes), squeezing stores straight to each output. */
+typedef struct {
+	lane_t A[KECCAK_NUM_LANES * KECCAK1600_MAX_WAYS]
+		__attribute__((aligned(64)));
+	const k1600_mb_engine_t *eng;
+	size_t rate_bytes;
+	size_t md_len;
+	size_t block_off;
+	unsigned int rounds;
+	int squeezing;
+	uint8_t delim_suffix;
+} k1600_mb_ctx_t;
+
+/* The default engine is used when a NULL engine is passed, it's
+ * sampled once when a context is initialized. */
+void keccakf1600_set_default_engine(const k1600_engine_t *eng);
+const k1600_engine_t *keccakf1600_get_default_engine(void);
+const k1600_engine_t *keccakf1600_get_engine(const char *name);
+/* Kept for compatibility, selects the default engine */
 void keccakf1600_set_permutation_function(keccak1600_spf func, int lc);
+/* Import / export for lane complementing engines, inverts lanes
+ * 1, 2, 8, 12, 17 and 20 */
+void keccakf1600_state_convert_lc(k1600_state_t *dst, const k1600_state_t *src);
+
+/* Runtime backend selection (keccak1600_dispatch.c), this also
+ * runs on startup, honoring the KECCAK1600_ENGINE environment
+ * variable (an engine name, or "calibrate") */
+unsigned int keccakf1600_get_hwcaps(void);
+int keccakf1600_engine_supported(const k1600_engine_t *eng);
+int keccakf1600_mb_engine_supported(const k1600_mb_engine_t *eng);
+const k1600_engine_t *keccakf1600_autoselect(int calibrate);
+/* Best multi-buffer engine for the given number of ways (NULL when
+ * there is none), selected together with the default engine */
+const k1600_mb_engine_t *keccakf1600_get_mb_engine(unsigned int ways);
+
+/* Sponge on top of Keccak-f[1600] with a capacity of twice the
+ * digest length, as used by SHA3 and the original Keccak */
+void keccakf1600_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+		      size_t md_len, uint8_t delim_suffix);
+void keccakf1600_update(k1600_ctx_t *ctx, const void *msg, size_t msg_len);
+void keccakf1600_final(k1600_ctx_t *ctx, void *md);
+
+/* Same as keccakf1600_init() but for a sponge on top of
+ * Keccak-p[1600, nr] with the given rate, the final call
+ * will produce md_len bytes. If the engine can't do a
+ * reduced number of rounds, the reference one is used. */
+void keccakp1600_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+		      unsigned int nr, size_t rate_bytes, size_t md_len,
+		      uint8_t delim_suffix);
+/* Extendable output, rate_bytes is what's left of the state
+ * after the capacity (e.g. 168 for SHAKE128). Squeeze can be
+ * called repeatedly to get more output, it pads on the first
+ * call and continues from where the previous call stopped, no
+ * more updates are allowed after that. */
+void keccakf1600_xof_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+			  size_t rate_bytes, uint8_t delim_suffix);
+void keccakf1600_xof_squeeze(k1600_ctx_t *ctx, void *out, size_t out_len);
+/* Snapshot a context, e.g. after absorbing a prefix shared by
+ * many messages (a key or a domain separation tag), to start each
+ * message from there instead of absorbing the prefix again. The
+ * state is copied as is, so this works with lane complementing
+ * engines too, the copy must only be used with the same engine. */
+void keccakf1600_clone(k1600_ctx_t *dst, const k1600_ctx_t *src);
+/* One-shot hashing, messages that fit in a single block (together
+ * with the padding) when the output also fits in one, go through a
+ * fast path that builds the padded block directly on the state. */
 void keccakf1600_oneshot(const void *msg, size_t msg_len, void *md,
 			 size_t md_len, uint8_t delim_suffix);
+void keccakf1600_oneshot_eng(const k1600_engine_t *eng, const void *msg,
+			     size_t msg_len, void *md, size_t md_len,
+			     uint8_t delim_suffix);
+/* Same on top of Keccak-p[1600, nr] with the given rate, md_len
+ * can be larger than a block for extendable output */
+void keccakp1600_oneshot(const k1600_engine_t *eng, unsigned int nr,
+			 size_t rate_bytes, const void *msg, size_t msg_len,
+			 void *md, size_t md_len, uint8_t delim_suffix);
+
+/* Incremental multi-buffer API, same as the single state one,
+ * msgs / mds have eng->ways entries and each call gets msg_len
+ * bytes from each message. The engine must provide permute_rounds
+ * if nr isn't 24. The context is cache line aligned, new / free
+ * are for allocating it from the heap, they return NULL / do
+ * nothing on NULL. */
+k1600_mb_ctx_t *keccakf1600_mb_ctx_new(void);
+void keccakf1600_mb_ctx_free(k1600_mb_ctx_t *ctx);
+void keccakp1600_mb_init(k1600_mb_ctx_t *ctx, const k1600_mb_engine_t *eng,
+			 unsigned int nr, size_t rate_bytes, size_t md_len,
+			 uint8_t delim_suffix);
+void keccakf1600_mb_update(k1600_mb_ctx_t *ctx, const void *const msgs[],
+			   size_t msg_len);
+void keccakf1600_mb_final(k1600_mb_ctx_t *ctx, void *const mds[]);
+void keccakf1600_mb_xof_squeeze(k1600_mb_ctx_t *ctx, void *const outs[],
+				size_t out_len);
+
+/* Hash eng->ways messages of the same length at once */
+void keccakf1600_oneshot_mb(const k1600_mb_engine_t *eng,
+			    const void *const msgs[], size_t msg_len,
+			    void *const mds[], size_t md_len,
+			    uint8_t delim_suffix);
+/* Same on top of Keccak-p[1600, nr] with the given rate, the
+ * engine must provide permute_rounds if nr isn't 24 */
+void keccakp1600_oneshot_mb(const k1600_mb_engine_t *eng, unsigned int nr,
+			    size_t rate_bytes, const void *const msgs[],
+			    size_t msg_len, void *const mds[], size_t md_len,
+			    uint8_t delim_suffix);
 
 /* Available implementations */
 void keccakf1600_state_permute_ref(k1600_state_t *st);
+void keccakp1600_state_permute_ref(k1600_state_t *st, unsigned int nr);
 void keccakf1600_state_permute_inplaceur(k1600_state_t *st);
+void keccakp1600_state_permute_inplaceur(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_inplaceur_zbb(k1600_state_t *st);
+void keccakp1600_state_permute_inplaceur_zbb(k1600_state_t *st, unsigned int nr);
 void keccakf1600_state_permute_intermediateur(k1600_state_t *st);
+void keccakp1600_state_permute_intermediateur(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_intermediateur(k1600_state_t *st, const void *msg,
+				       size_t num_blocks, unsigned int rate_lanes,
+				       unsigned int nr);
 void keccakf1600_state_permute_intermediateur_ep(k1600_state_t *st);
+void keccakp1600_state_permute_intermediateur_ep(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_intermediateur_ep(k1600_state_t *st, const void *msg,
+					  size_t num_blocks, unsigned int rate_lanes,
+					  unsigned int nr);
 void keccakf1600_state_permute_intermediateur_lc(k1600_state_t *st);
+void keccakp1600_state_permute_intermediateur_lc(k1600_state_t *st, unsigned int nr);
+/* Generated from keccak1600_template.h (keccak1600_template.c) */
+void keccakf1600_state_permute_tpl_inplace(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_inplace(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_tpl_intermediate(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_intermediate(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_tpl_ep(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_ep(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_tpl_lc(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_lc(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_tpl_ep_lc(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_ep_lc(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_tpl_inplace_lc(k1600_state_t *st);
+void keccakp1600_state_permute_tpl_inplace_lc(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_bi32(k1600_state_t *st);
+void keccakp1600_state_permute_bi32(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_bi32(k1600_state_t *st, const void *msg,
+			     size_t num_blocks, unsigned int rate_lanes,
+			     unsigned int nr);
+void keccakf1600_squeeze_bi32(k1600_state_t *st, void *out,
+			      size_t num_blocks, unsigned int rate_lanes,
+			      unsigned int nr);
+void keccakf1600_state_permute_bi32_lc(k1600_state_t *st);
+void keccakp1600_state_permute_bi32_lc(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_bi32_lc(k1600_state_t *st, const void *msg,
+				size_t num_blocks, unsigned int rate_lanes,
+				unsigned int nr);
+/* Works on the bit-interleaved state (keccak1600_bi32_rv32.S),
+ * the rest convert it and call that */
+void keccakp1600_bi32_permute_rv32(k1600_bi_lane_t *B, unsigned int nr);
+void keccakf1600_state_permute_bi32_rv32(k1600_state_t *st);
+void keccakp1600_state_permute_bi32_rv32(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_bi32_rv32(k1600_state_t *st, const void *msg,
+				  size_t num_blocks, unsigned int rate_lanes,
+				  unsigned int nr);
+void keccakf1600_squeeze_bi32_rv32(k1600_state_t *st, void *out,
+				   size_t num_blocks, unsigned int rate_lanes,
+				   unsigned int nr);
 void keccakf1600_state_permute_intermediateur_rv64i(k1600_state_t *st);
+void keccakp1600_state_permute_intermediateur_rv64i(k1600_state_t *st, unsigned int nr);
 void keccakf1600_state_permute_inplaceur_rv64id(k1600_state_t *st);
+void keccakp1600_state_permute_inplaceur_rv64id(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_inplaceur_rv64id(k1600_state_t *st, const void *msg,
+					 size_t num_blocks, unsigned int rate_lanes,
+					 unsigned int nr);
+void keccakf1600_squeeze_inplaceur_rv64id(k1600_state_t *st, void *out,
+					  size_t num_blocks, unsigned int rate_lanes,
+					  unsigned int nr);
+void keccakf1600_state_permute_intermediateur_rv64i_zbb(k1600_state_t *st);
+void keccakp1600_state_permute_intermediateur_rv64i_zbb(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_inplaceur_rv64id_zbb(k1600_state_t *st);
+void keccakp1600_state_permute_inplaceur_rv64id_zbb(k1600_state_t *st, unsigned int nr);
+void keccakf1600_absorb_inplaceur_rv64id_zbb(k1600_state_t *st, const void *msg,
+					     size_t num_blocks, unsigned int rate_lanes,
+					     unsigned int nr);
+void keccakf1600_squeeze_inplaceur_rv64id_zbb(k1600_state_t *st, void *out,
+					      size_t num_blocks, unsigned int rate_lanes,
+					      unsigned int nr);
+void keccakf1600_state_permute_intermediateur_x2(lane_t *A);
+void keccakf1600_state_permute_intermediateur_x4(lane_t *A);
+void keccakf1600_state_permute_intermediateur_x8(lane_t *A);
+void keccakp1600_state_permute_intermediateur_x2(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_intermediateur_x4(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_intermediateur_x8(lane_t *A, unsigned int nr);
+void keccakf1600_state_permute_tpl_ep_x2(lane_t *A);
+void keccakf1600_state_permute_tpl_ep_x4(lane_t *A);
+void keccakp1600_state_permute_tpl_ep_x2(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_tpl_ep_x4(lane_t *A, unsigned int nr);
+void keccakf1600_state_permute_avx512(k1600_state_t *st);
+void keccakp1600_state_permute_avx512(k1600_state_t *st, unsigned int nr);
+void keccakf1600_state_permute_avx2_x4(lane_t *A);
+void keccakf1600_state_permute_avx512_x8(lane_t *A);
+void keccakp1600_state_permute_avx2_x4(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_avx512_x8(lane_t *A, unsigned int nr);
+void keccakf1600_state_permute_rvv_x2(lane_t *A);
+void keccakf1600_state_permute_rvv_x4(lane_t *A);
+void keccakf1600_state_permute_rvv_x8(lane_t *A);
+void keccakp1600_state_permute_rvv_x2(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_rvv_x4(lane_t *A, unsigned int nr);
+void keccakp1600_state_permute_rvv_x8(lane_t *A, unsigned int nr);
+
+/* And their descriptors (keccak1600_engines.c) */
+extern const k1600_engine_t keccakf1600_engine_ref;
+extern const k1600_engine_t keccakf1600_engine_inplaceur;
+extern const k1600_engine_t keccakf1600_engine_intermediateur;
+extern const k1600_engine_t keccakf1600_engine_intermediateur_ep;
+extern const k1600_engine_t keccakf1600_engine_intermediateur_lc;
+extern const k1600_engine_t keccakf1600_engine_tpl_inplace;
+extern const k1600_engine_t keccakf1600_engine_tpl_intermediate;
+extern const k1600_engine_t keccakf1600_engine_tpl_ep;
+extern const k1600_engine_t keccakf1600_engine_tpl_lc;
+extern const k1600_engine_t keccakf1600_engine_tpl_ep_lc;
+extern const k1600_engine_t keccakf1600_engine_tpl_inplace_lc;
+extern const k1600_engine_t keccakf1600_engine_bi32;
+extern const k1600_engine_t keccakf1600_engine_bi32_lc;
+#ifdef RV32ASM_IMPL
+extern const k1600_engine_t keccakf1600_engine_bi32_rv32;
+#endif
+#ifdef RVASM_IMPL
+extern const k1600_engine_t keccakf1600_engine_intermediateur_rv64i;
+extern const k1600_engine_t keccakf1600_engine_inplaceur_rv64id;
+#endif
+#ifdef RVZBB_IMPL
+extern const k1600_engine_t keccakf1600_engine_inplaceur_zbb;
+#endif
+#if defined(RVASM_IMPL) && defined(RVZBB_IMPL)
+extern const k1600_engine_t keccakf1600_engine_intermediateur_rv64i_zbb;
+extern const k1600_engine_t keccakf1600_engine_inplaceur_rv64id_zbb;
+#endif
+#ifdef __x86_64__
+extern const k1600_engine_t keccakf1600_engine_avx512;
+#endif
+extern const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x2;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x4;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x8;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_tpl_ep_x2;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_tpl_ep_x4;
+#ifdef __x86_64__
+extern const k1600_mb_engine_t keccakf1600_mb_engine_avx2_x4;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_avx512_x8;
+#endif
+#ifdef RVASM_IMPL
+extern const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x2;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x4;
+extern const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x8;
+#endif
+/* NULL-terminated lists of all the above */
+extern const k1600_engine_t *const keccakf1600_engines[];
+extern const k1600_mb_engine_t *const keccakf1600_mb_engines[];
 
+#endif /* _KECCAK1600_H */
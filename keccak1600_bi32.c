@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Bit-interleaved state permutation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+
+/*
+ * On 32-bit cores every 64-bit rotation becomes a sequence of shifts
+ * and ors over the two halves of the lane. Bit interleaving, from
+ * section 2.1 of "Keccak implementation overview", instead splits
+ * each lane into a 32-bit word with its even bits and another one
+ * with its odd bits. A rotation by an even amount 2k is a rotation
+ * by k of each word, and a rotation by an odd amount 2k + 1 also
+ * swaps them, so the even word becomes the odd word rotated by
+ * k + 1, and the odd word becomes the even word rotated by k.
+ * Everything else is bitwise, so it's done on each word separately.
+ *
+ * The state is kept as is on k1600_state_t, so we convert it on
+ * entry and exit. For absorb / squeeze we only convert the state
+ * once for all blocks, and convert each block's lanes as we xor
+ * them in / store them out. The round itself comes from
+ * keccak1600_template.h.
+ */
+
+/* Round constants, split to even / odd bits */
+static const uint32_t bi32_round_constants[KECCAK1600_NUM_ROUNDS][2] =
+	{ { 0x00000001, 0x00000000 }, { 0x00000000, 0x00000089 },
+	  { 0x00000000, 0x8000008b }, { 0x00000000, 0x80008080 },
+	  { 0x00000001, 0x0000008b }, { 0x00000001, 0x00008000 },
+	  { 0x00000001, 0x80008088 }, { 0x00000001, 0x80000082 },
+	  { 0x00000000, 0x0000000b }, { 0x00000000, 0x0000000a },
+	  { 0x00000001, 0x00008082 }, { 0x00000000, 0x00008003 },
+	  { 0x00000001, 0x0000808b }, { 0x00000001, 0x8000000b },
+	  { 0x00000001, 0x8000008a }, { 0x00000001, 0x80000081 },
+	  { 0x00000000, 0x80000081 }, { 0x00000000, 0x80000008 },
+	  { 0x00000000, 0x00000083 }, { 0x00000000, 0x80008003 },
+	  { 0x00000001, 0x80008088 }, { 0x00000000, 0x80000088 },
+	  { 0x00000001, 0x00008000 }, { 0x00000000, 0x80008082 } };
+
+typedef void (*bi32_permf) (k1600_bi_lane_t *B, unsigned int nr);
+
+
+/*********\
+* HELPERS *
+\*********/
+
+/* The masked shift is so that we don't need to special-case 0,
+ * compilers still recognize this as a rotation */
+static inline uint32_t
+rotl32(uint32_t val, int times)
+{
+	return (val << times) | (val >> ((32 - times) & 31));
+}
+
+/*
+ * Move the even bits of x to the lower half and the odd bits to
+ * the upper half (unzip on Zbkb), and back. Each step swaps 2
+ * bit fields within a mask using the delta swap trick from
+ * Hacker's Delight, section 7.
+ */
+static inline uint32_t
+bi32_unzip(uint32_t x)
+{
+#if defined(__riscv_zbkb) && (__riscv_xlen == 32)
+	__asm__ ("unzip %0, %1" : "=r" (x) : "r" (x));
+#else
+	uint32_t t = 0;
+
+	t = (x ^ (x >> 1)) & 0x22222222; x ^= t ^ (t << 1);
+	t = (x ^ (x >> 2)) & 0x0C0C0C0C; x ^= t ^ (t << 2);
+	t = (x ^ (x >> 4)) & 0x00F000F0; x ^= t ^ (t << 4);
+	t = (x ^ (x >> 8)) & 0x0000FF00; x ^= t ^ (t << 8);
+#endif
+	return x;
+}
+
+static inline uint32_t
+bi32_zip(uint32_t x)
+{
+#if defined(__riscv_zbkb) && (__riscv_xlen == 32)
+	__asm__ ("zip %0, %1" : "=r" (x) : "r" (x));
+#else
+	uint32_t t = 0;
+
+	t = (x ^ (x >> 8)) & 0x0000FF00; x ^= t ^ (t << 8);
+	t = (x ^ (x >> 4)) & 0x00F000F0; x ^= t ^ (t << 4);
+	t = (x ^ (x >> 2)) & 0x0C0C0C0C; x ^= t ^ (t << 2);
+	t = (x ^ (x >> 1)) & 0x22222222; x ^= t ^ (t << 1);
+#endif
+	return x;
+}
+
+static inline k1600_bi_lane_t
+bi32_from_lane(lane_t val)
+{
+	uint32_t lo = bi32_unzip((uint32_t) val);
+	uint32_t hi = bi32_unzip((uint32_t) (val >> 32));
+	k1600_bi_lane_t out = { 0 };
+
+	out.e = (lo & 0x0000FFFF) | (hi << 16);
+	out.o = (lo >> 16) | (hi & 0xFFFF0000);
+	return out;
+}
+
+static inline lane_t
+bi32_to_lane(k1600_bi_lane_t val)
+{
+	uint32_t lo = bi32_zip((val.e & 0x0000FFFF) | (val.o << 16));
+	uint32_t hi = bi32_zip((val.e >> 16) | (val.o & 0xFFFF0000));
+
+	return ((lane_t) hi << 32) | lo;
+}
+
+static inline void
+bi32_import(const k1600_state_t *st, k1600_bi_lane_t *B)
+{
+	int i = 0;
+
+	for (i = 0; i < KECCAK_NUM_LANES; i++)
+		B[i] = bi32_from_lane(st->A[i]);
+}
+
+static inline void
+bi32_export(const k1600_bi_lane_t *B, k1600_state_t *st)
+{
+	int i = 0;
+
+	for (i = 0; i < KECCAK_NUM_LANES; i++)
+		st->A[i] = bi32_to_lane(B[i]);
+}
+
+
+/*********************\
+* TEMPLATE OPERATIONS *
+\*********************/
+
+static inline k1600_bi_lane_t
+bi32_xor(k1600_bi_lane_t a, k1600_bi_lane_t b)
+{
+	k1600_bi_lane_t out = { a.e ^ b.e, a.o ^ b.o };
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_and(k1600_bi_lane_t a, k1600_bi_lane_t b)
+{
+	k1600_bi_lane_t out = { a.e & b.e, a.o & b.o };
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_or(k1600_bi_lane_t a, k1600_bi_lane_t b)
+{
+	k1600_bi_lane_t out = { a.e | b.e, a.o | b.o };
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_not(k1600_bi_lane_t a)
+{
+	k1600_bi_lane_t out = { ~a.e, ~a.o };
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_andn(k1600_bi_lane_t a, k1600_bi_lane_t b)
+{
+	k1600_bi_lane_t out = { ~a.e & b.e, ~a.o & b.o };
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_rotl(k1600_bi_lane_t val, int times)
+{
+	k1600_bi_lane_t out = { 0 };
+
+	if (times & 1) {
+		out.e = rotl32(val.o, (times + 1) >> 1);
+		out.o = rotl32(val.e, times >> 1);
+	} else {
+		out.e = rotl32(val.e, times >> 1);
+		out.o = rotl32(val.o, times >> 1);
+	}
+	return out;
+}
+
+static inline k1600_bi_lane_t
+bi32_iota(k1600_bi_lane_t a, int r_idx)
+{
+	a.e ^= bi32_round_constants[r_idx][0];
+	a.o ^= bi32_round_constants[r_idx][1];
+	return a;
+}
+
+#define TPL_XOR(_a, _b)			bi32_xor(_a, _b)
+#define TPL_AND(_a, _b)			bi32_and(_a, _b)
+#define TPL_OR(_a, _b)			bi32_or(_a, _b)
+#define TPL_NOT(_a)			bi32_not(_a)
+#define TPL_ANDN(_a, _b)		bi32_andn(_a, _b)
+#define TPL_ROTL(_val, _times)		bi32_rotl(_val, _times)
+#define TPL_IOTA(_a, _r_idx)		bi32_iota(_a, _r_idx)
+
+#define KECCAK_TPL_ATTRS
+#define KECCAK_TPL_WAYS		1
+#define KECCAK_TPL_LANE_T	k1600_bi_lane_t
+#define KECCAK_TPL_INTERNAL
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	0
+#define KECCAK_TPL_UNROLL	2
+
+#define KECCAK_TPL_NAME		bi32
+#define KECCAK_TPL_LC		0
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LC
+
+/* Without andn it saves most NOTs, same as intermediateur_lc */
+#define KECCAK_TPL_NAME		bi32_lc
+#define KECCAK_TPL_LC		1
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LC
+
+/* Keep a single copy of each, the wrappers below
+ * pass them around */
+static void
+bi32_permute(k1600_bi_lane_t *B, unsigned int nr)
+{
+	keccakf1600_permute_bi32(B, nr);
+}
+
+static void
+bi32_permute_lc(k1600_bi_lane_t *B, unsigned int nr)
+{
+	keccakf1600_permute_bi32_lc(B, nr);
+}
+
+
+/*****************************\
+* STATE CONVERSION / WRAPPERS *
+\*****************************/
+
+static inline void
+bi32_state_permute(k1600_state_t *st, unsigned int nr, bi32_permf permute)
+{
+	k1600_bi_lane_t B[KECCAK_NUM_LANES];
+
+	bi32_import(st, B);
+	permute(B, nr);
+	bi32_export(B, st);
+}
+
+static inline void
+bi32_absorb(k1600_state_t *st, const uint8_t *msg, size_t num_blocks,
+	    unsigned int rate_lanes, unsigned int nr, bi32_permf permute)
+{
+	k1600_bi_lane_t B[KECCAK_NUM_LANES];
+	unsigned int i = 0;
+
+	msg = KECCAK1600_ASSUME_ALIGNED(msg);
+	bi32_import(st, B);
+	for (; num_blocks > 0; num_blocks--) {
+		for (i = 0; i < rate_lanes; i++, msg += KECCAK1600_LANE_BYTES)
+			B[i] = bi32_xor(B[i], bi32_from_lane(load_lane(msg)));
+		permute(B, nr);
+	}
+	bi32_export(B, st);
+}
+
+static inline void
+bi32_squeeze(k1600_state_t *st, uint8_t *out, size_t num_blocks,
+	     unsigned int rate_lanes, unsigned int nr, bi32_permf permute)
+{
+	k1600_bi_lane_t B[KECCAK_NUM_LANES];
+	unsigned int i = 0;
+
+	bi32_import(st, B);
+	for (; num_blocks > 0; num_blocks--) {
+		permute(B, nr);
+		for (i = 0; i < rate_lanes; i++, out += KECCAK1600_LANE_BYTES)
+			store_lane(out, bi32_to_lane(B[i]));
+	}
+	bi32_export(B, st);
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+void
+keccakf1600_state_permute_bi32(k1600_state_t *st)
+{
+	bi32_state_permute(st, KECCAK1600_NUM_ROUNDS, bi32_permute);
+}
+
+void
+keccakp1600_state_permute_bi32(k1600_state_t *st, unsigned int nr)
+{
+	bi32_state_permute(st, nr, bi32_permute);
+}
+
+void
+keccakf1600_absorb_bi32(k1600_state_t *st, const void *msg,
+			size_t num_blocks, unsigned int rate_lanes,
+			unsigned int nr)
+{
+	bi32_absorb(st, msg, num_blocks, rate_lanes, nr, bi32_permute);
+}
+
+void
+keccakf1600_squeeze_bi32(k1600_state_t *st, void *out,
+			 size_t num_blocks, unsigned int rate_lanes,
+			 unsigned int nr)
+{
+	bi32_squeeze(st, out, num_blocks, rate_lanes, nr, bi32_permute);
+}
+
+void
+keccakf1600_state_permute_bi32_lc(k1600_state_t *st)
+{
+	bi32_state_permute(st, KECCAK1600_NUM_ROUNDS, bi32_permute_lc);
+}
+
+void
+keccakp1600_state_permute_bi32_lc(k1600_state_t *st, unsigned int nr)
+{
+	bi32_state_permute(st, nr, bi32_permute_lc);
+}
+
+/* The message xor doesn't care about lane complementing */
+void
+keccakf1600_absorb_bi32_lc(k1600_state_t *st, const void *msg,
+			   size_t num_blocks, unsigned int rate_lanes,
+			   unsigned int nr)
+{
+	bi32_absorb(st, msg, num_blocks, rate_lanes, nr, bi32_permute_lc);
+}
+
+#ifdef RV32ASM_IMPL
+/* Same as above, with the permutation from keccak1600_bi32_rv32.S */
+void
+keccakf1600_state_permute_bi32_rv32(k1600_state_t *st)
+{
+	bi32_state_permute(st, KECCAK1600_NUM_ROUNDS, keccakp1600_bi32_permute_rv32);
+}
+
+void
+keccakp1600_state_permute_bi32_rv32(k1600_state_t *st, unsigned int nr)
+{
+	bi32_state_permute(st, nr, keccakp1600_bi32_permute_rv32);
+}
+
+void
+keccakf1600_absorb_bi32_rv32(k1600_state_t *st, const void *msg,
+			     size_t num_blocks, unsigned int rate_lanes,
+			     unsigned int nr)
+{
+	bi32_absorb(st, msg, num_blocks, rate_lanes, nr,
+		    keccakp1600_bi32_permute_rv32);
+}
+
+void
+keccakf1600_squeeze_bi32_rv32(k1600_state_t *st, void *out,
+			      size_t num_blocks, unsigned int rate_lanes,
+			      unsigned int nr)
+{
+	bi32_squeeze(st, out, num_blocks, rate_lanes, nr,
+		     keccakp1600_bi32_permute_rv32);
+}
+#endif /* RV32ASM_IMPL */
@@ -0,0 +1,464 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Runtime backend selection
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+#include <stdio.h>		/* For fopen() / fgets() */
+#include <stdlib.h>		/* For getenv() */
+#include <string.h>		/* For strcmp() / strstr() */
+#include <time.h>		/* For clock_gettime() */
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>		/* For __get_cpuid_count() */
+#endif
+
+#if defined(__riscv) && defined(__linux__)
+#include <unistd.h>		/* For syscall() */
+#include <sys/syscall.h>	/* For __NR_riscv_hwprobe */
+#endif
+
+/*
+ * The goal here is to ship a single binary and pick the
+ * best backend on the target at runtime. We first check
+ * what the CPU supports, and filter out any backends we
+ * can't run. From the rest we either pick the one with the
+ * highest priority, or if asked to calibrate, we run each
+ * one for a while and pick the fastest. In both cases we
+ * verify the selected engine against the reference
+ * implementation before installing it, and fall back to
+ * the reference implementation if that fails.
+ */
+
+/*****************\
+* FEATURE PROBING *
+\*****************/
+
+#if defined(__x86_64__) || defined(__i386__)
+static unsigned int
+probe_hwcaps(void)
+{
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	unsigned int hwcaps = 0;
+	unsigned int xcr0 = 0;
+	unsigned int xcr0_hi = 0;
+
+	if (!__get_cpuid_count(1, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	/* Check that the OS saves/restores the extended
+	 * state (OSXSAVE), and which parts of it */
+	if (ecx & (1 << 27))
+		__asm__ volatile ("xgetbv" : "=a" (xcr0), "=d" (xcr0_hi) : "c" (0));
+
+	if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+		return 0;
+
+	/* XMM / YMM state */
+	if ((xcr0 & 0x6) != 0x6)
+		return hwcaps;
+
+	if (ebx & (1 << 5))
+		hwcaps |= K1600_HWCAP_X86_AVX2;
+
+	/* Opmask / ZMM state */
+	if ((xcr0 & 0xE0) != 0xE0)
+		return hwcaps;
+
+	if (ebx & (1 << 16))
+		hwcaps |= K1600_HWCAP_X86_AVX512F;
+
+	return hwcaps;
+}
+#elif defined(__riscv) && defined(__linux__)
+/* From arch/riscv/include/uapi/asm/hwprobe.h, so that we
+ * don't depend on recent kernel headers */
+#ifndef __NR_riscv_hwprobe
+#define __NR_riscv_hwprobe		258
+#endif
+#define RISCV_HWPROBE_KEY_IMA_EXT_0	4
+#define RISCV_HWPROBE_IMA_V		(1 << 2)
+#define RISCV_HWPROBE_EXT_ZBB		(1 << 4)
+#define RISCV_HWPROBE_EXT_ZBKB		(1 << 8)
+#define RISCV_HWPROBE_EXT_ZVBB		(1 << 17)
+
+struct riscv_hwprobe_pair {
+	int64_t key;
+	uint64_t value;
+};
+
+/* For older kernels without riscv_hwprobe, check the
+ * isa string, e.g. "isa : rv64imafdcv_zicsr_zba_zbb" */
+static unsigned int
+probe_hwcaps_cpuinfo(void)
+{
+	unsigned int hwcaps = 0;
+	char line[512] = { 0 };
+	FILE *cpuinfo = NULL;
+	char *isa = NULL;
+	char *c = NULL;
+
+	cpuinfo = fopen("/proc/cpuinfo", "r");
+	if (!cpuinfo)
+		return 0;
+
+	while (fgets(line, sizeof(line), cpuinfo)) {
+		if (strncmp(line, "isa", 3))
+			continue;
+		isa = strstr(line, "rv64");
+		if (!isa)
+			isa = strstr(line, "rv32");
+		if (!isa)
+			continue;
+
+		/* Single letter extensions, up to the
+		 * first multi-letter one */
+		for (c = isa + 4; *c && *c != '_' && *c != '\n'; c++)
+			if (*c == 'v')
+				hwcaps |= K1600_HWCAP_RV_V;
+
+		if (strstr(isa, "_zbb"))
+			hwcaps |= K1600_HWCAP_RV_ZBB;
+		if (strstr(isa, "_zbkb"))
+			hwcaps |= K1600_HWCAP_RV_ZBKB;
+		if (strstr(isa, "_zvbb"))
+			hwcaps |= K1600_HWCAP_RV_ZVBB;
+		break;
+	}
+
+	fclose(cpuinfo);
+	return hwcaps;
+}
+
+static unsigned int
+probe_hwcaps(void)
+{
+	struct riscv_hwprobe_pair pair = { .key = RISCV_HWPROBE_KEY_IMA_EXT_0 };
+	unsigned int hwcaps = 0;
+
+	/* Ask for the features common to all harts */
+	if (syscall(__NR_riscv_hwprobe, &pair, 1, 0, NULL, 0) != 0 ||
+	    pair.key < 0)
+		return probe_hwcaps_cpuinfo();
+
+	if (pair.value & RISCV_HWPROBE_IMA_V)
+		hwcaps |= K1600_HWCAP_RV_V;
+	if (pair.value & RISCV_HWPROBE_EXT_ZBB)
+		hwcaps |= K1600_HWCAP_RV_ZBB;
+	if (pair.value & RISCV_HWPROBE_EXT_ZBKB)
+		hwcaps |= K1600_HWCAP_RV_ZBKB;
+	if (pair.value & RISCV_HWPROBE_EXT_ZVBB)
+		hwcaps |= K1600_HWCAP_RV_ZVBB;
+
+	return hwcaps;
+}
+#else
+/* Bare metal or unknown target, we can only rely
+ * on what we were built for */
+static unsigned int
+probe_hwcaps(void)
+{
+	unsigned int hwcaps = 0;
+#if defined(__riscv_zbb)
+	hwcaps |= K1600_HWCAP_RV_ZBB;
+#endif
+#if defined(__riscv_zbkb)
+	hwcaps |= K1600_HWCAP_RV_ZBKB;
+#endif
+#if defined(__riscv_v)
+	hwcaps |= K1600_HWCAP_RV_V;
+#endif
+#if defined(__riscv_zvbb)
+	hwcaps |= K1600_HWCAP_RV_ZVBB;
+#endif
+	return hwcaps;
+}
+#endif
+
+static unsigned int hwcaps_cached = 0;
+static int hwcaps_probed = 0;
+
+unsigned int
+keccakf1600_get_hwcaps(void)
+{
+	/* Probing is idempotent, so a race here is harmless */
+	if (!__atomic_load_n(&hwcaps_probed, __ATOMIC_ACQUIRE)) {
+		__atomic_store_n(&hwcaps_cached, probe_hwcaps(), __ATOMIC_RELAXED);
+		__atomic_store_n(&hwcaps_probed, 1, __ATOMIC_RELEASE);
+	}
+	return __atomic_load_n(&hwcaps_cached, __ATOMIC_RELAXED);
+}
+
+int
+keccakf1600_engine_supported(const k1600_engine_t *eng)
+{
+	unsigned int hwcaps = keccakf1600_get_hwcaps();
+	return (eng->hwcaps & hwcaps) == eng->hwcaps;
+}
+
+int
+keccakf1600_mb_engine_supported(const k1600_mb_engine_t *eng)
+{
+	unsigned int hwcaps = keccakf1600_get_hwcaps();
+	return (eng->hwcaps & hwcaps) == eng->hwcaps &&
+	       eng->ways <= KECCAK1600_MAX_WAYS;
+}
+
+
+/******************************\
+* VERIFICATION / CALIBRATION *
+\******************************/
+
+#define CALIBRATION_ROUNDS	3
+#define CALIBRATION_BLOCKS	64
+
+/* Hash a message that spans a few blocks and covers
+ * a partial one, and compare against the reference */
+static int
+engine_verify(const k1600_engine_t *eng)
+{
+	uint8_t msg[3 * 136 + 17] = { 0 };
+	uint8_t md_ref[64] = { 0 };
+	uint8_t md[64] = { 0 };
+	k1600_ctx_t ctx;
+	size_t i = 0;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = (uint8_t) (i * 0x9D + 0x3B);
+
+	keccakf1600_oneshot_eng(&keccakf1600_engine_ref, msg, sizeof(msg),
+				md_ref, 32, 0x06);
+	keccakf1600_oneshot_eng(eng, msg, sizeof(msg), md, 32, 0x06);
+	if (memcmp(md, md_ref, 32))
+		return 0;
+
+	keccakf1600_oneshot_eng(&keccakf1600_engine_ref, msg, sizeof(msg),
+				md_ref, 64, 0x06);
+	keccakf1600_oneshot_eng(eng, msg, sizeof(msg), md, 64, 0x06);
+	if (memcmp(md, md_ref, 64))
+		return 0;
+
+	/* Reduced rounds, use an odd number so that we also
+	 * cover the extra round on kernels that do them in pairs */
+	if (eng->permute_rounds) {
+		keccakp1600_init(&ctx, &keccakf1600_engine_ref, 13, 136, 32,
+				 0x06);
+		keccakf1600_update(&ctx, msg, sizeof(msg));
+		keccakf1600_final(&ctx, md_ref);
+		keccakp1600_init(&ctx, eng, 13, 136, 32, 0x06);
+		keccakf1600_update(&ctx, msg, sizeof(msg));
+		keccakf1600_final(&ctx, md);
+		if (memcmp(md, md_ref, 32))
+			return 0;
+	}
+
+	return 1;
+}
+
+/* Same for a multi-buffer engine, using a different
+ * message on each way */
+static int
+mb_engine_verify(const k1600_mb_engine_t *eng)
+{
+	uint8_t msg[KECCAK1600_MAX_WAYS][2 * 136 + 5] = { 0 };
+	uint8_t md[KECCAK1600_MAX_WAYS][32] = { 0 };
+	const void *msgs[KECCAK1600_MAX_WAYS] = { 0 };
+	void *mds[KECCAK1600_MAX_WAYS] = { 0 };
+	uint8_t md_ref[32] = { 0 };
+	k1600_ctx_t ctx;
+	unsigned int j = 0;
+	size_t i = 0;
+
+	for (j = 0; j < eng->ways; j++) {
+		for (i = 0; i < sizeof(msg[j]); i++)
+			msg[j][i] = (uint8_t) (i * 0x9D + j * 0x3B);
+		msgs[j] = msg[j];
+		mds[j] = md[j];
+	}
+
+	keccakf1600_oneshot_mb(eng, msgs, sizeof(msg[0]), mds, 32, 0x06);
+
+	for (j = 0; j < eng->ways; j++) {
+		keccakf1600_oneshot_eng(&keccakf1600_engine_ref, msg[j],
+					sizeof(msg[j]), md_ref, 32, 0x06);
+		if (memcmp(md[j], md_ref, 32))
+			return 0;
+	}
+
+	if (!eng->permute_rounds)
+		return 1;
+
+	keccakp1600_oneshot_mb(eng, 13, 136, msgs, sizeof(msg[0]), mds, 32,
+			       0x06);
+
+	for (j = 0; j < eng->ways; j++) {
+		keccakp1600_init(&ctx, &keccakf1600_engine_ref, 13, 136, 32,
+				 0x06);
+		keccakf1600_update(&ctx, msg[j], sizeof(msg[j]));
+		keccakf1600_final(&ctx, md_ref);
+		if (memcmp(md[j], md_ref, 32))
+			return 0;
+	}
+
+	return 1;
+}
+
+static uint64_t
+get_time_ns(void)
+{
+	struct timespec ts = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Best time out of a few runs, to filter out noise */
+static uint64_t
+engine_time(const k1600_engine_t *eng)
+{
+	k1600_state_t st = { 0 };
+	uint64_t best = UINT64_MAX;
+	uint64_t start = 0;
+	uint64_t dur = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < CALIBRATION_ROUNDS; i++) {
+		start = get_time_ns();
+		for (j = 0; j < CALIBRATION_BLOCKS; j++)
+			eng->permute(&st);
+		dur = get_time_ns() - start;
+		if (dur < best)
+			best = dur;
+	}
+
+	return best;
+}
+
+
+static uint64_t
+mb_engine_time(const k1600_mb_engine_t *eng)
+{
+	lane_t A[KECCAK_NUM_LANES * KECCAK1600_MAX_WAYS] = { 0 };
+	uint64_t best = UINT64_MAX;
+	uint64_t start = 0;
+	uint64_t dur = 0;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i < CALIBRATION_ROUNDS; i++) {
+		start = get_time_ns();
+		for (j = 0; j < CALIBRATION_BLOCKS; j++)
+			eng->permute(A);
+		dur = get_time_ns() - start;
+		if (dur < best)
+			best = dur;
+	}
+
+	return best;
+}
+
+/* Pick the best multi-buffer engine for each number of ways */
+static const k1600_mb_engine_t *mb_default[KECCAK1600_MAX_WAYS + 1] = { 0 };
+
+static void
+mb_autoselect(int calibrate)
+{
+	const k1600_mb_engine_t *best[KECCAK1600_MAX_WAYS + 1] = { 0 };
+	uint64_t best_time[KECCAK1600_MAX_WAYS + 1] = { 0 };
+	const k1600_mb_engine_t *eng = NULL;
+	uint64_t dur = 0;
+	int i = 0;
+
+	for (i = 0; keccakf1600_mb_engines[i] != NULL; i++) {
+		eng = keccakf1600_mb_engines[i];
+		if (!keccakf1600_mb_engine_supported(eng) || !mb_engine_verify(eng))
+			continue;
+
+		if (calibrate) {
+			dur = mb_engine_time(eng);
+			if (!best[eng->ways] || dur < best_time[eng->ways]) {
+				best_time[eng->ways] = dur;
+				best[eng->ways] = eng;
+			}
+		} else if (!best[eng->ways] || eng->prio > best[eng->ways]->prio)
+			best[eng->ways] = eng;
+	}
+
+	for (i = 0; i <= KECCAK1600_MAX_WAYS; i++)
+		__atomic_store_n(&mb_default[i], best[i], __ATOMIC_RELEASE);
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+const k1600_mb_engine_t *
+keccakf1600_get_mb_engine(unsigned int ways)
+{
+	if (ways > KECCAK1600_MAX_WAYS)
+		return NULL;
+	return __atomic_load_n(&mb_default[ways], __ATOMIC_ACQUIRE);
+}
+
+const k1600_engine_t *
+keccakf1600_autoselect(int calibrate)
+{
+	const k1600_engine_t *best = NULL;
+	const k1600_engine_t *eng = NULL;
+	uint64_t best_time = UINT64_MAX;
+	uint64_t dur = 0;
+	int i = 0;
+
+	for (i = 0; keccakf1600_engines[i] != NULL; i++) {
+		eng = keccakf1600_engines[i];
+		if (!keccakf1600_engine_supported(eng))
+			continue;
+
+		if (calibrate) {
+			if (!engine_verify(eng))
+				continue;
+			dur = engine_time(eng);
+			if (dur < best_time) {
+				best_time = dur;
+				best = eng;
+			}
+		} else if (!best || eng->prio > best->prio)
+			best = eng;
+	}
+
+	/* Already verified when calibrating */
+	if (!best || (!calibrate && !engine_verify(best)))
+		best = &keccakf1600_engine_ref;
+
+	keccakf1600_set_default_engine(best);
+	mb_autoselect(calibrate);
+	return best;
+}
+
+/* Run once on startup (or when the library is loaded) */
+static void __attribute__((constructor))
+keccakf1600_dispatch_init(void)
+{
+	const k1600_engine_t *eng = NULL;
+	const char *env = getenv("KECCAK1600_ENGINE");
+
+	if (env && !strcmp(env, "calibrate")) {
+		keccakf1600_autoselect(1);
+		return;
+	}
+
+	/* Honor the user's choice, as long as it's
+	 * something we can run */
+	if (env) {
+		eng = keccakf1600_get_engine(env);
+		if (eng && keccakf1600_engine_supported(eng)) {
+			keccakf1600_set_default_engine(eng);
+			mb_autoselect(0);
+			return;
+		}
+	}
+
+	keccakf1600_autoselect(0);
+}
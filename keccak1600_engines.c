@@ -0,0 +1,454 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Backend descriptors
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+
+/*
+ * Priorities are only used when picking an engine without
+ * calibration, they are just an ordering of what should be the
+ * better choice on a typical core of each target: kernels that need
+ * an ISA extension go above the ones for the base ISA (they are only
+ * picked when the extension is there), assembly above C, and lane
+ * complementing above plain when there are no andn / orn
+ * instructions. The RV64ID variant is only useful when the state is
+ * kept on fp registers, and the template variants are only there
+ * for comparison, so they stay low. Calibration measures the engines
+ * on the actual core instead, see the comments on each
+ * implementation and keccak1600_dispatch.c.
+ */
+
+const k1600_engine_t keccakf1600_engine_ref = {
+	.name = "ref",
+	.permute = &keccakf1600_state_permute_ref,
+	.permute_rounds = &keccakp1600_state_permute_ref,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 0,
+};
+
+const k1600_engine_t keccakf1600_engine_inplaceur = {
+	.name = "inplaceur",
+	.permute = &keccakf1600_state_permute_inplaceur,
+	.permute_rounds = &keccakp1600_state_permute_inplaceur,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 20,
+};
+
+const k1600_engine_t keccakf1600_engine_intermediateur = {
+	.name = "intermediateur",
+	.permute = &keccakf1600_state_permute_intermediateur,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur,
+	.absorb = &keccakf1600_absorb_intermediateur,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 30,
+};
+
+const k1600_engine_t keccakf1600_engine_intermediateur_ep = {
+	.name = "intermediateur_ep",
+	.permute = &keccakf1600_state_permute_intermediateur_ep,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_ep,
+	.absorb = &keccakf1600_absorb_intermediateur_ep,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 35,
+};
+
+const k1600_engine_t keccakf1600_engine_intermediateur_lc = {
+	.name = "intermediateur_lc",
+	.permute = &keccakf1600_state_permute_intermediateur_lc,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_lc,
+	.state_import = &keccakf1600_state_convert_lc,
+	.state_export = &keccakf1600_state_convert_lc,
+	.lc = 1,
+	.hwcaps = 0,
+	.prio = 40,
+};
+
+/*
+ * Generated from keccak1600_template.h, those are mostly
+ * for experimenting with new variants on sha3_bench, so
+ * they only get picked when calibrating.
+ */
+
+const k1600_engine_t keccakf1600_engine_tpl_inplace = {
+	.name = "tpl_inplace",
+	.permute = &keccakf1600_state_permute_tpl_inplace,
+	.permute_rounds = &keccakp1600_state_permute_tpl_inplace,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_engine_t keccakf1600_engine_tpl_intermediate = {
+	.name = "tpl_intermediate",
+	.permute = &keccakf1600_state_permute_tpl_intermediate,
+	.permute_rounds = &keccakp1600_state_permute_tpl_intermediate,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_engine_t keccakf1600_engine_tpl_ep = {
+	.name = "tpl_ep",
+	.permute = &keccakf1600_state_permute_tpl_ep,
+	.permute_rounds = &keccakp1600_state_permute_tpl_ep,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_engine_t keccakf1600_engine_tpl_lc = {
+	.name = "tpl_lc",
+	.permute = &keccakf1600_state_permute_tpl_lc,
+	.permute_rounds = &keccakp1600_state_permute_tpl_lc,
+	.state_import = &keccakf1600_state_convert_lc,
+	.state_export = &keccakf1600_state_convert_lc,
+	.lc = 1,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_engine_t keccakf1600_engine_tpl_ep_lc = {
+	.name = "tpl_ep_lc",
+	.permute = &keccakf1600_state_permute_tpl_ep_lc,
+	.permute_rounds = &keccakp1600_state_permute_tpl_ep_lc,
+	.state_import = &keccakf1600_state_convert_lc,
+	.state_export = &keccakf1600_state_convert_lc,
+	.lc = 1,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_engine_t keccakf1600_engine_tpl_inplace_lc = {
+	.name = "tpl_inplace_lc",
+	.permute = &keccakf1600_state_permute_tpl_inplace_lc,
+	.permute_rounds = &keccakp1600_state_permute_tpl_inplace_lc,
+	.state_import = &keccakf1600_state_convert_lc,
+	.state_export = &keccakf1600_state_convert_lc,
+	.lc = 1,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+/*
+ * Bit interleaving is for targets without 64-bit registers, on
+ * 64-bit ones those are slower than the rest and only there for
+ * testing. Same as with the 64-bit ones, lane complementing helps
+ * when we don't have andn.
+ */
+#if UINTPTR_MAX == 0xFFFFFFFF
+#if defined(__riscv_zbb) || defined(__riscv_zbkb)
+#define K1600_BI32_PRIO		52
+#define K1600_BI32_LC_PRIO	50
+#else
+#define K1600_BI32_PRIO		50
+#define K1600_BI32_LC_PRIO	52
+#endif
+#else
+#define K1600_BI32_PRIO		1
+#define K1600_BI32_LC_PRIO	1
+#endif
+
+const k1600_engine_t keccakf1600_engine_bi32 = {
+	.name = "bi32",
+	.permute = &keccakf1600_state_permute_bi32,
+	.permute_rounds = &keccakp1600_state_permute_bi32,
+	.absorb = &keccakf1600_absorb_bi32,
+	.squeeze = &keccakf1600_squeeze_bi32,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = K1600_BI32_PRIO,
+};
+
+const k1600_engine_t keccakf1600_engine_bi32_lc = {
+	.name = "bi32_lc",
+	.permute = &keccakf1600_state_permute_bi32_lc,
+	.permute_rounds = &keccakp1600_state_permute_bi32_lc,
+	.absorb = &keccakf1600_absorb_bi32_lc,
+	.state_import = &keccakf1600_state_convert_lc,
+	.state_export = &keccakf1600_state_convert_lc,
+	.lc = 1,
+	.hwcaps = 0,
+	.prio = K1600_BI32_LC_PRIO,
+};
+
+#ifdef RV32ASM_IMPL
+/* The asm kernel uses rori / andn when built with Zbb
+ * (or Zbkb), see keccak1600_bi32_rv32.S */
+#if defined(__riscv_zbb)
+#define K1600_HWCAP_BI32_RV32_KERNEL	K1600_HWCAP_RV_ZBB
+#elif defined(__riscv_zbkb)
+#define K1600_HWCAP_BI32_RV32_KERNEL	K1600_HWCAP_RV_ZBKB
+#else
+#define K1600_HWCAP_BI32_RV32_KERNEL	0
+#endif
+
+const k1600_engine_t keccakf1600_engine_bi32_rv32 = {
+	.name = "bi32_rv32",
+	.permute = &keccakf1600_state_permute_bi32_rv32,
+	.permute_rounds = &keccakp1600_state_permute_bi32_rv32,
+	.absorb = &keccakf1600_absorb_bi32_rv32,
+	.squeeze = &keccakf1600_squeeze_bi32_rv32,
+	.lc = 0,
+	.hwcaps = K1600_HWCAP_BI32_RV32_KERNEL,
+	.prio = 55,
+};
+#endif /* RV32ASM_IMPL */
+
+#ifdef RVASM_IMPL
+const k1600_engine_t keccakf1600_engine_intermediateur_rv64i = {
+	.name = "intermediateur_rv64i",
+	.permute = &keccakf1600_state_permute_intermediateur_rv64i,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_rv64i,
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 45,
+};
+
+const k1600_engine_t keccakf1600_engine_inplaceur_rv64id = {
+	.name = "inplaceur_rv64id",
+	.permute = &keccakf1600_state_permute_inplaceur_rv64id,
+	.permute_rounds = &keccakp1600_state_permute_inplaceur_rv64id,
+#if !KECCAK1600_BIG_ENDIAN
+	/* Those load / store lanes as they are */
+	.absorb = &keccakf1600_absorb_inplaceur_rv64id,
+	.squeeze = &keccakf1600_squeeze_inplaceur_rv64id,
+#endif
+	.lc = 0,
+	.hwcaps = 0,
+	.prio = 10,
+};
+#endif /* RVASM_IMPL */
+
+#ifdef RVZBB_IMPL
+/*
+ * Those get built with RV_ZBB_MARCH (see the Makefile), which
+ * may also be Zbkb for cores that only have the crypto subset,
+ * in which case we get RVZBKB_IMPL. The asm ones only use rori
+ * and andn, while for the C one we only let the compiler use
+ * what the march allows.
+ */
+#ifdef RVZBKB_IMPL
+#define K1600_HWCAP_ZBB_KERNEL	K1600_HWCAP_RV_ZBKB
+#else
+#define K1600_HWCAP_ZBB_KERNEL	K1600_HWCAP_RV_ZBB
+#endif
+
+/* inplaceur built with Zbb, see keccak1600_inplaceur_zbb.c */
+const k1600_engine_t keccakf1600_engine_inplaceur_zbb = {
+	.name = "inplaceur_zbb",
+	.permute = &keccakf1600_state_permute_inplaceur_zbb,
+	.permute_rounds = &keccakp1600_state_permute_inplaceur_zbb,
+	.lc = 0,
+	.hwcaps = K1600_HWCAP_ZBB_KERNEL,
+	.prio = 50,
+};
+
+#ifdef RVASM_IMPL
+/* No lane complementing here either, with andn chi
+ * is as cheap as it gets */
+const k1600_engine_t keccakf1600_engine_intermediateur_rv64i_zbb = {
+	.name = "intermediateur_rv64i_zbb",
+	.permute = &keccakf1600_state_permute_intermediateur_rv64i_zbb,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_rv64i_zbb,
+	.lc = 0,
+	.hwcaps = K1600_HWCAP_ZBB_KERNEL,
+	.prio = 48,
+};
+
+const k1600_engine_t keccakf1600_engine_inplaceur_rv64id_zbb = {
+	.name = "inplaceur_rv64id_zbb",
+	.permute = &keccakf1600_state_permute_inplaceur_rv64id_zbb,
+	.permute_rounds = &keccakp1600_state_permute_inplaceur_rv64id_zbb,
+#if !KECCAK1600_BIG_ENDIAN
+	.absorb = &keccakf1600_absorb_inplaceur_rv64id_zbb,
+	.squeeze = &keccakf1600_squeeze_inplaceur_rv64id_zbb,
+#endif
+	.lc = 0,
+	.hwcaps = K1600_HWCAP_ZBB_KERNEL,
+	.prio = 15,
+};
+#endif /* RVASM_IMPL */
+#endif /* RVZBB_IMPL */
+
+#ifdef __x86_64__
+/* Only uses AVX-512F instructions (on zmm registers). It's mostly
+ * latency bound, so it's not much faster than the scalar ones (that
+ * also get all BMI/AVX tricks from the compiler with -march=native),
+ * leave it to calibration to decide. */
+const k1600_engine_t keccakf1600_engine_avx512 = {
+	.name = "avx512",
+	.permute = &keccakf1600_state_permute_avx512,
+	.permute_rounds = &keccakp1600_state_permute_avx512,
+	.lc = 0,
+	.hwcaps = K1600_HWCAP_X86_AVX512F,
+	.prio = 38,
+};
+#endif /* __x86_64__ */
+
+const k1600_engine_t *const keccakf1600_engines[] = {
+	&keccakf1600_engine_ref,
+	&keccakf1600_engine_inplaceur,
+	&keccakf1600_engine_intermediateur,
+	&keccakf1600_engine_intermediateur_ep,
+	&keccakf1600_engine_intermediateur_lc,
+	&keccakf1600_engine_tpl_inplace,
+	&keccakf1600_engine_tpl_intermediate,
+	&keccakf1600_engine_tpl_ep,
+	&keccakf1600_engine_tpl_lc,
+	&keccakf1600_engine_tpl_ep_lc,
+	&keccakf1600_engine_tpl_inplace_lc,
+	&keccakf1600_engine_bi32,
+	&keccakf1600_engine_bi32_lc,
+#ifdef RV32ASM_IMPL
+	&keccakf1600_engine_bi32_rv32,
+#endif
+#ifdef RVASM_IMPL
+	&keccakf1600_engine_intermediateur_rv64i,
+	&keccakf1600_engine_inplaceur_rv64id,
+#endif
+#ifdef RVZBB_IMPL
+	&keccakf1600_engine_inplaceur_zbb,
+#ifdef RVASM_IMPL
+	&keccakf1600_engine_intermediateur_rv64i_zbb,
+	&keccakf1600_engine_inplaceur_rv64id_zbb,
+#endif
+#endif
+#ifdef __x86_64__
+	&keccakf1600_engine_avx512,
+#endif
+	NULL
+};
+
+/* Multi-buffer engines */
+
+const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x2 = {
+	.name = "intermediateur_x2",
+	.permute = &keccakf1600_state_permute_intermediateur_x2,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_x2,
+	.ways = 2,
+	.hwcaps = 0,
+	.prio = 30,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x4 = {
+	.name = "intermediateur_x4",
+	.permute = &keccakf1600_state_permute_intermediateur_x4,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_x4,
+	.ways = 4,
+	.hwcaps = 0,
+	.prio = 30,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_intermediateur_x8 = {
+	.name = "intermediateur_x8",
+	.permute = &keccakf1600_state_permute_intermediateur_x8,
+	.permute_rounds = &keccakp1600_state_permute_intermediateur_x8,
+	.ways = 8,
+	.hwcaps = 0,
+	.prio = 30,
+};
+
+/* Generated from keccak1600_template.h, see above */
+const k1600_mb_engine_t keccakf1600_mb_engine_tpl_ep_x2 = {
+	.name = "tpl_ep_x2",
+	.permute = &keccakf1600_state_permute_tpl_ep_x2,
+	.permute_rounds = &keccakp1600_state_permute_tpl_ep_x2,
+	.ways = 2,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_tpl_ep_x4 = {
+	.name = "tpl_ep_x4",
+	.permute = &keccakf1600_state_permute_tpl_ep_x4,
+	.permute_rounds = &keccakp1600_state_permute_tpl_ep_x4,
+	.ways = 4,
+	.hwcaps = 0,
+	.prio = 1,
+};
+
+#ifdef RVASM_IMPL
+/*
+ * The RVV kernel uses vror/vandn when built with Zvbb
+ * enabled (see keccak1600_intermediateur_rvv.S), in which
+ * case we also need the core to support it. It may get its
+ * own -march (see the Makefile), in which case we get
+ * RVV_ZVBB_IMPL instead.
+ */
+#if defined(__riscv_zvbb) || defined(RVV_ZVBB_IMPL)
+#define K1600_HWCAP_RVV_KERNEL	(K1600_HWCAP_RV_V | K1600_HWCAP_RV_ZVBB)
+#else
+#define K1600_HWCAP_RVV_KERNEL	K1600_HWCAP_RV_V
+#endif
+
+const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x2 = {
+	.name = "rvv_x2",
+	.permute = &keccakf1600_state_permute_rvv_x2,
+	.permute_rounds = &keccakp1600_state_permute_rvv_x2,
+	.ways = 2,
+	.hwcaps = K1600_HWCAP_RVV_KERNEL,
+	.prio = 50,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x4 = {
+	.name = "rvv_x4",
+	.permute = &keccakf1600_state_permute_rvv_x4,
+	.permute_rounds = &keccakp1600_state_permute_rvv_x4,
+	.ways = 4,
+	.hwcaps = K1600_HWCAP_RVV_KERNEL,
+	.prio = 50,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_rvv_x8 = {
+	.name = "rvv_x8",
+	.permute = &keccakf1600_state_permute_rvv_x8,
+	.permute_rounds = &keccakp1600_state_permute_rvv_x8,
+	.ways = 8,
+	.hwcaps = K1600_HWCAP_RVV_KERNEL,
+	.prio = 50,
+};
+#endif /* RVASM_IMPL */
+
+#ifdef __x86_64__
+const k1600_mb_engine_t keccakf1600_mb_engine_avx2_x4 = {
+	.name = "avx2_x4",
+	.permute = &keccakf1600_state_permute_avx2_x4,
+	.permute_rounds = &keccakp1600_state_permute_avx2_x4,
+	.ways = 4,
+	.hwcaps = K1600_HWCAP_X86_AVX2,
+	.prio = 50,
+};
+
+const k1600_mb_engine_t keccakf1600_mb_engine_avx512_x8 = {
+	.name = "avx512_x8",
+	.permute = &keccakf1600_state_permute_avx512_x8,
+	.permute_rounds = &keccakp1600_state_permute_avx512_x8,
+	.ways = 8,
+	.hwcaps = K1600_HWCAP_X86_AVX512F,
+	.prio = 50,
+};
+#endif /* __x86_64__ */
+
+const k1600_mb_engine_t *const keccakf1600_mb_engines[] = {
+	&keccakf1600_mb_engine_intermediateur_x2,
+	&keccakf1600_mb_engine_intermediateur_x4,
+	&keccakf1600_mb_engine_intermediateur_x8,
+	&keccakf1600_mb_engine_tpl_ep_x2,
+	&keccakf1600_mb_engine_tpl_ep_x4,
+#ifdef RVASM_IMPL
+	&keccakf1600_mb_engine_rvv_x2,
+	&keccakf1600_mb_engine_rvv_x4,
+	&keccakf1600_mb_engine_rvv_x8,
+#endif
+#ifdef __x86_64__
+	&keccakf1600_mb_engine_avx2_x4,
+	&keccakf1600_mb_engine_avx512_x8,
+#endif
+	NULL
+};
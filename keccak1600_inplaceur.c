@@ -129,10 +129,17 @@ keccakf1600_round_inplace_unrolled(lane_t * A, int r_idx)
 	A[0] ^= round_constants[r_idx];
 }
 
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
 void
-keccakf1600_state_permute_inplaceur(k1600_state_t *st)
+keccakp1600_state_permute_inplaceur(k1600_state_t *st, unsigned int nr)
 {
 	int i = 0;
-	for (i = 0; i < KECCAK1600_NUM_ROUNDS; i++)
+	for (i = KECCAK1600_NUM_ROUNDS - nr; i < KECCAK1600_NUM_ROUNDS; i++)
 		keccakf1600_round_inplace_unrolled(st->A, i);
+}
+
+void
+keccakf1600_state_permute_inplaceur(k1600_state_t *st)
+{
+	keccakp1600_state_permute_inplaceur(st, KECCAK1600_NUM_ROUNDS);
 }
\ No newline at end of file
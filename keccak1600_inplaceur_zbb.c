@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - State permutation, Zbb build
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+/*
+ * Same as keccak1600_inplaceur.c, but this file gets its own -march
+ * with Zbb enabled (see the Makefile), so that the compiler can use
+ * rori for the rotations and andn for chi. The dispatcher only picks
+ * it on cores that have Zbb, so the rest of the library can still be
+ * built for the base ISA.
+ */
+
+#ifdef RVZBB_IMPL
+
+#define keccakf1600_state_permute_inplaceur	keccakf1600_state_permute_inplaceur_zbb
+#define keccakp1600_state_permute_inplaceur	keccakp1600_state_permute_inplaceur_zbb
+#include "keccak1600_inplaceur.c"
+
+#endif /* RVZBB_IMPL */
@@ -5,6 +5,7 @@
  */
 
 #include "keccak1600.h"
+#include <string.h>	/* For memcpy() */
 
 /*
  * When working in-place, we go back and forth accessing lanes
@@ -30,19 +31,26 @@ static const lane_t round_constants[KECCAK1600_NUM_ROUNDS] =
 	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
 	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
 
-static inline void
-keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
+/* Lane _k of the round's input, for the first round of an
+ * absorbed block that's the state xored with the message
+ * (m_lanes is a constant so this folds to A[_k] otherwise) */
+#define LANE_IN(_k)	(A[_k] ^ (((_k) < m_lanes) ? \
+			 load_lane(M + (_k) * KECCAK1600_LANE_BYTES) : 0))
+
+static inline __attribute__((always_inline)) void
+keccakf1600_round_intermediate_unrolled_in(lane_t *A, const uint8_t *M,
+					   const int m_lanes, lane_t *N, int r_idx)
 {
 	lane_t C[5] = { 0 };
 	lane_t D[5] = { 0 };
 	lane_t T[5] = { 0 };
 
 	/* Compute parity of columns */
-	C[0] = A[0] ^ A[5] ^ A[10] ^ A[15] ^ A[20];
-	C[1] = A[1] ^ A[6] ^ A[11] ^ A[16] ^ A[21];
-	C[2] = A[2] ^ A[7] ^ A[12] ^ A[17] ^ A[22];
-	C[3] = A[3] ^ A[8] ^ A[13] ^ A[18] ^ A[23];
-	C[4] = A[4] ^ A[9] ^ A[14] ^ A[19] ^ A[24];
+	C[0] = LANE_IN(0) ^ LANE_IN(5) ^ LANE_IN(10) ^ LANE_IN(15) ^ LANE_IN(20);
+	C[1] = LANE_IN(1) ^ LANE_IN(6) ^ LANE_IN(11) ^ LANE_IN(16) ^ LANE_IN(21);
+	C[2] = LANE_IN(2) ^ LANE_IN(7) ^ LANE_IN(12) ^ LANE_IN(17) ^ LANE_IN(22);
+	C[3] = LANE_IN(3) ^ LANE_IN(8) ^ LANE_IN(13) ^ LANE_IN(18) ^ LANE_IN(23);
+	C[4] = LANE_IN(4) ^ LANE_IN(9) ^ LANE_IN(14) ^ LANE_IN(19) ^ LANE_IN(24);
 
 	/* Compute theta for each column */
 	D[0] = C[4] ^ rotl_lane(C[1], 1);
@@ -54,11 +62,11 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 	/* 1st plane */
 
 	/* Apply theta-rho-pi */
-	T[0] = A[0] ^ D[0];
-	T[1] = rotl_lane(A[6]  ^ D[1], 44);
-	T[2] = rotl_lane(A[12] ^ D[2], 43);
-	T[3] = rotl_lane(A[18] ^ D[3], 21);
-	T[4] = rotl_lane(A[24] ^ D[4], 14);
+	T[0] = LANE_IN(0) ^ D[0];
+	T[1] = rotl_lane(LANE_IN(6)  ^ D[1], 44);
+	T[2] = rotl_lane(LANE_IN(12) ^ D[2], 43);
+	T[3] = rotl_lane(LANE_IN(18) ^ D[3], 21);
+	T[4] = rotl_lane(LANE_IN(24) ^ D[4], 14);
 
 	/* Apply chi */
 	/* Also apply iota since we are here */
@@ -70,11 +78,11 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 
 	/* 2nd plane */
 
-	T[0] = rotl_lane(A[3]  ^ D[3], 28);
-	T[1] = rotl_lane(A[9]  ^ D[4], 20);
-	T[2] = rotl_lane(A[10] ^ D[0], 3);
-	T[3] = rotl_lane(A[16] ^ D[1], 45);
-	T[4] = rotl_lane(A[22] ^ D[2], 61);
+	T[0] = rotl_lane(LANE_IN(3)  ^ D[3], 28);
+	T[1] = rotl_lane(LANE_IN(9)  ^ D[4], 20);
+	T[2] = rotl_lane(LANE_IN(10) ^ D[0], 3);
+	T[3] = rotl_lane(LANE_IN(16) ^ D[1], 45);
+	T[4] = rotl_lane(LANE_IN(22) ^ D[2], 61);
 
 	N[5] = T[0] ^ (~T[1] & T[2]);
 	N[6] = T[1] ^ (~T[2] & T[3]);
@@ -84,11 +92,11 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 
 	/* 3rd plane */
 
-	T[0] = rotl_lane(A[1]  ^ D[1], 1);
-	T[1] = rotl_lane(A[7]  ^ D[2], 6);
-	T[2] = rotl_lane(A[13] ^ D[3], 25);
-	T[3] = rotl_lane(A[19] ^ D[4], 8);
-	T[4] = rotl_lane(A[20] ^ D[0], 18);
+	T[0] = rotl_lane(LANE_IN(1)  ^ D[1], 1);
+	T[1] = rotl_lane(LANE_IN(7)  ^ D[2], 6);
+	T[2] = rotl_lane(LANE_IN(13) ^ D[3], 25);
+	T[3] = rotl_lane(LANE_IN(19) ^ D[4], 8);
+	T[4] = rotl_lane(LANE_IN(20) ^ D[0], 18);
 
 	N[10] = T[0] ^ (~T[1] & T[2]);
 	N[11] = T[1] ^ (~T[2] & T[3]);
@@ -98,11 +106,11 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 
 	/* 4th plane */
 
-	T[0] = rotl_lane(A[4]  ^ D[4], 27);
-	T[1] = rotl_lane(A[5]  ^ D[0], 36);
-	T[2] = rotl_lane(A[11] ^ D[1], 10);
-	T[3] = rotl_lane(A[17] ^ D[2], 15);
-	T[4] = rotl_lane(A[23] ^ D[3], 56);
+	T[0] = rotl_lane(LANE_IN(4)  ^ D[4], 27);
+	T[1] = rotl_lane(LANE_IN(5)  ^ D[0], 36);
+	T[2] = rotl_lane(LANE_IN(11) ^ D[1], 10);
+	T[3] = rotl_lane(LANE_IN(17) ^ D[2], 15);
+	T[4] = rotl_lane(LANE_IN(23) ^ D[3], 56);
 
 	N[15] = T[0] ^ (~T[1] & T[2]);
 	N[16] = T[1] ^ (~T[2] & T[3]);
@@ -112,11 +120,11 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 
 	/* 5th plane */
 
-	T[0] = rotl_lane(A[2]  ^ D[2], 62);
-	T[1] = rotl_lane(A[8]  ^ D[3], 55);
-	T[2] = rotl_lane(A[14] ^ D[4], 39);
-	T[3] = rotl_lane(A[15] ^ D[0], 41);
-	T[4] = rotl_lane(A[21] ^ D[1], 2);
+	T[0] = rotl_lane(LANE_IN(2)  ^ D[2], 62);
+	T[1] = rotl_lane(LANE_IN(8)  ^ D[3], 55);
+	T[2] = rotl_lane(LANE_IN(14) ^ D[4], 39);
+	T[3] = rotl_lane(LANE_IN(15) ^ D[0], 41);
+	T[4] = rotl_lane(LANE_IN(21) ^ D[1], 2);
 
 	N[20] = T[0] ^ (~T[1] & T[2]);
 	N[21] = T[1] ^ (~T[2] & T[3]);
@@ -125,6 +133,33 @@ keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
 	N[24] = T[4] ^ (~T[0] & T[1]);
 }
 
+static inline void
+keccakf1600_round_intermediate_unrolled(lane_t *A, lane_t *N, int r_idx)
+{
+	keccakf1600_round_intermediate_unrolled_in(A, NULL, 0, N, r_idx);
+}
+
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
+void
+keccakp1600_state_permute_intermediateur(k1600_state_t *st, unsigned int nr)
+{
+	lane_t N[KECCAK_NUM_LANES] = { 0 };
+	int i = KECCAK1600_NUM_ROUNDS - nr;
+
+	/* Rounds go in pairs so that we end up with the
+	 * result on A, for an odd number of rounds do
+	 * the first one separately and copy it back */
+	if (nr & 1) {
+		keccakf1600_round_intermediate_unrolled(st->A, N, i++);
+		memcpy(st->A, N, sizeof(N));
+	}
+
+	for (; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+		keccakf1600_round_intermediate_unrolled(st->A, N, i);
+		keccakf1600_round_intermediate_unrolled(N, st->A, i + 1);
+	}
+}
+
 void
 keccakf1600_state_permute_intermediateur(k1600_state_t *st)
 {
@@ -135,4 +170,63 @@ keccakf1600_state_permute_intermediateur(k1600_state_t *st)
 		keccakf1600_round_intermediate_unrolled(st->A, N, i);
 		keccakf1600_round_intermediate_unrolled(N, st->A, i + 1);
 	}
-}
\ No newline at end of file
+}
+
+/*
+ * Absorb num_blocks blocks of rate_lanes lanes, the message is
+ * xored in while computing the first round of each block, so it
+ * doesn't need to go through the state in memory first. Odd round
+ * counts don't end up on A, so for those xor and permute as usual.
+ */
+static inline __attribute__((always_inline)) void
+keccakf1600_absorb_intermediateur_blocks(k1600_state_t *st, const uint8_t *msg,
+					 size_t num_blocks, const int rate_lanes,
+					 unsigned int nr)
+{
+	lane_t N[KECCAK_NUM_LANES] = { 0 };
+	int i = 0;
+	int j = 0;
+
+	msg = KECCAK1600_ASSUME_ALIGNED(msg);
+	for (; num_blocks > 0; num_blocks--, msg += rate_lanes * KECCAK1600_LANE_BYTES) {
+		if (!nr || (nr & 1)) {
+			for (j = 0; j < rate_lanes; j++)
+				st->A[j] ^= load_lane(msg + j * KECCAK1600_LANE_BYTES);
+			keccakp1600_state_permute_intermediateur(st, nr);
+			continue;
+		}
+
+		i = KECCAK1600_NUM_ROUNDS - nr;
+		keccakf1600_round_intermediate_unrolled_in(st->A, msg, rate_lanes, N, i);
+		keccakf1600_round_intermediate_unrolled(N, st->A, i + 1);
+
+		for (i += 2; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+			keccakf1600_round_intermediate_unrolled(st->A, N, i);
+			keccakf1600_round_intermediate_unrolled(N, st->A, i + 1);
+		}
+	}
+}
+
+/* Specialize for the common rates, so that the message
+ * xor is unrolled and the rest gets optimized away */
+void
+keccakf1600_absorb_intermediateur(k1600_state_t *st, const void *msg,
+				  size_t num_blocks, unsigned int rate_lanes,
+				  unsigned int nr)
+{
+	switch (rate_lanes) {
+	case 17:	/* SHA3-256, SHAKE256 */
+		keccakf1600_absorb_intermediateur_blocks(st, msg, num_blocks, 17, nr);
+		break;
+	case 9:		/* SHA3-512 */
+		keccakf1600_absorb_intermediateur_blocks(st, msg, num_blocks, 9, nr);
+		break;
+	case 21:	/* SHAKE128, TurboSHAKE128 */
+		keccakf1600_absorb_intermediateur_blocks(st, msg, num_blocks, 21, nr);
+		break;
+	default:
+		keccakf1600_absorb_intermediateur_blocks(st, msg, num_blocks,
+							 rate_lanes, nr);
+		break;
+	}
+}
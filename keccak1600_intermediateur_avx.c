@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - AVX2 / AVX-512 multi-buffer permutation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+#include "keccak1600.h"
+
+/*
+ * These are the multi-buffer round (keccak1600_intermediateur_mb.h)
+ * using x86 intrinsics, with 4 states (one ymm register per lane) for
+ * AVX2 and 8 states (one zmm register per lane) for AVX-512. Each
+ * function is built for its target ISA through the target attribute,
+ * so that we don't depend on -march and can pick them at runtime.
+ *
+ * AVX2 doesn't have a vector rotate, so we use two shifts and an or,
+ * except for rotations by 8 and 56 where a byte shuffle does the job
+ * with a single instruction. On AVX-512 we have vprolq for rotations,
+ * and vpternlogq for combining the 3-way xors of the column parity and
+ * the ~b & c ^ a of chi into single instructions.
+ */
+
+static const lane_t round_constants[KECCAK1600_NUM_ROUNDS] =
+	{ 0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
+
+
+/****************\
+* AVX2, 4 states *
+\****************/
+
+#define KECCAK_AVX2_ATTRS	__attribute__((target("avx2")))
+
+static inline __attribute__((always_inline)) KECCAK_AVX2_ATTRS __m256i
+avx2_rotl(__m256i val, int times)
+{
+	/* Byte-sized rotations within each 64bit lane */
+	if (times == 8)
+		return _mm256_shuffle_epi8(val,
+			_mm256_set_epi8(14, 13, 12, 11, 10, 9, 8, 15,
+					6, 5, 4, 3, 2, 1, 0, 7,
+					14, 13, 12, 11, 10, 9, 8, 15,
+					6, 5, 4, 3, 2, 1, 0, 7));
+	if (times == 56)
+		return _mm256_shuffle_epi8(val,
+			_mm256_set_epi8(8, 15, 14, 13, 12, 11, 10, 9,
+					0, 7, 6, 5, 4, 3, 2, 1,
+					8, 15, 14, 13, 12, 11, 10, 9,
+					0, 7, 6, 5, 4, 3, 2, 1));
+	return _mm256_or_si256(_mm256_slli_epi64(val, times),
+			       _mm256_srli_epi64(val, KECCAK1600_LANE_BITS - times));
+}
+
+#define MB_XOR(_a, _b)			_mm256_xor_si256(_a, _b)
+#define MB_XOR5(_a, _b, _c, _d, _e)	MB_XOR(MB_XOR(MB_XOR(_a, _b), \
+						      MB_XOR(_c, _d)), _e)
+#define MB_ROTL(_val, _times)		avx2_rotl(_val, _times)
+#define MB_CHI(_a, _b, _c)		MB_XOR(_a, _mm256_andnot_si256(_b, _c))
+#define MB_IOTA(_a, _rc)		MB_XOR(_a, _mm256_set1_epi64x(_rc))
+
+#define KECCAK_MB_NAME		avx2
+#define KECCAK_MB_ATTRS		KECCAK_AVX2_ATTRS
+#define KECCAK_MB_LANE_T	__m256i_u
+#define KECCAK_MB_WAYS		4
+#include "keccak1600_intermediateur_mb.h"
+#undef KECCAK_MB_WAYS
+#undef KECCAK_MB_LANE_T
+#undef KECCAK_MB_ATTRS
+#undef KECCAK_MB_NAME
+
+#undef MB_IOTA
+#undef MB_CHI
+#undef MB_ROTL
+#undef MB_XOR5
+#undef MB_XOR
+
+
+/*******************\
+* AVX-512, 8 states *
+\*******************/
+
+/*
+ * For vpternlogq the truth table is indexed by the bits of
+ * the three inputs, with a = 0xF0, b = 0xCC and c = 0xAA
+ */
+#define TERNLOG_XOR3	0x96	/* a ^ b ^ c */
+#define TERNLOG_CHI	0xD2	/* a ^ (~b & c) */
+
+#define MB_XOR(_a, _b)			_mm512_xor_si512(_a, _b)
+#define MB_XOR5(_a, _b, _c, _d, _e)	_mm512_ternarylogic_epi64( \
+					_mm512_ternarylogic_epi64(_a, _b, _c, \
+								  TERNLOG_XOR3), \
+					_d, _e, TERNLOG_XOR3)
+#define MB_ROTL(_val, _times)		_mm512_rol_epi64(_val, _times)
+#define MB_CHI(_a, _b, _c)		_mm512_ternarylogic_epi64(_a, _b, _c, \
+								  TERNLOG_CHI)
+#define MB_IOTA(_a, _rc)		MB_XOR(_a, _mm512_set1_epi64(_rc))
+
+#define KECCAK_MB_NAME		avx512
+#define KECCAK_MB_ATTRS		__attribute__((target("avx512f")))
+#define KECCAK_MB_LANE_T	__m512i_u
+#define KECCAK_MB_WAYS		8
+#include "keccak1600_intermediateur_mb.h"
+#undef KECCAK_MB_WAYS
+#undef KECCAK_MB_LANE_T
+#undef KECCAK_MB_ATTRS
+#undef KECCAK_MB_NAME
+
+#endif /* __x86_64__ */
@@ -5,6 +5,7 @@
  */
 
 #include "keccak1600.h"
+#include <string.h>	/* For memcpy() */
 
 /*
  * This is the intermediate_unrolled implementation using
@@ -126,6 +127,27 @@ keccakf1600_round_intermediate_unrolled_lc(lane_t *A, lane_t *N, int r_idx)
 	N[24] =  T[4] ^ ( T[0] & T[1]);
 }
 
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
+void
+keccakp1600_state_permute_intermediateur_lc(k1600_state_t *st, unsigned int nr)
+{
+	lane_t N[KECCAK_NUM_LANES] = { 0 };
+	int i = KECCAK1600_NUM_ROUNDS - nr;
+
+	/* Rounds go in pairs so that we end up with the
+	 * result on A, for an odd number of rounds do
+	 * the first one separately and copy it back */
+	if (nr & 1) {
+		keccakf1600_round_intermediate_unrolled_lc(st->A, N, i++);
+		memcpy(st->A, N, sizeof(N));
+	}
+
+	for (; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+		keccakf1600_round_intermediate_unrolled_lc(st->A, N, i);
+		keccakf1600_round_intermediate_unrolled_lc(N, st->A, i + 1);
+	}
+}
+
 void
 keccakf1600_state_permute_intermediateur_lc(k1600_state_t *st)
 {
@@ -0,0 +1,59 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Multi-buffer state permutation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+
+/*
+ * This is intermediate_unrolled working on 2, 4 or 8 independent
+ * states at once. The states are interleaved lane by lane, so that
+ * lane i of state j is at A[i * ways + j], and each lane of the
+ * round is a vector holding that lane for all states (using the
+ * compiler's vector extensions).
+ *
+ * When the target has SIMD registers wide enough, the compiler maps
+ * each step to a single SIMD instruction. When it doesn't, it splits
+ * each vector operation into scalar operations that are independent
+ * of each other, so a single state's rotate/xor dependency chain is
+ * interleaved with the others and a superscalar core has something
+ * to issue while waiting for the previous result. The 2-way variant
+ * is the one to use in that case, since each state needs its own
+ * set of registers.
+ */
+
+static const lane_t round_constants[KECCAK1600_NUM_ROUNDS] =
+	{ 0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
+
+/* Operations on vectors of lanes, using the compiler's
+ * vector extensions. MB_ROTL is the same as rotl_lane, it's a
+ * macro to avoid passing vectors around as function arguments. */
+#define MB_XOR(_a, _b)			((_a) ^ (_b))
+#define MB_XOR5(_a, _b, _c, _d, _e)	((_a) ^ (_b) ^ (_c) ^ (_d) ^ (_e))
+#define MB_ROTL(_val, _times)		(((_val) << (_times)) | \
+					 ((_val) >> (KECCAK1600_LANE_BITS - (_times))))
+#define MB_CHI(_a, _b, _c)		((_a) ^ (~(_b) & (_c)))
+#define MB_IOTA(_a, _rc)		((_a) ^ (_rc))
+
+#define KECCAK_MB_NAME	intermediateur
+#define KECCAK_MB_ATTRS
+
+#define KECCAK_MB_WAYS	2
+#include "keccak1600_intermediateur_mb.h"
+#undef KECCAK_MB_WAYS
+
+#define KECCAK_MB_WAYS	4
+#include "keccak1600_intermediateur_mb.h"
+#undef KECCAK_MB_WAYS
+
+#define KECCAK_MB_WAYS	8
+#include "keccak1600_intermediateur_mb.h"
+#undef KECCAK_MB_WAYS
@@ -0,0 +1,175 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Multi-buffer round template
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+/*
+ * This is included once for each number of ways, with KECCAK_MB_WAYS
+ * set accordingly. It's the same as keccakf1600_round_intermediate_unrolled,
+ * using a vector of KECCAK_MB_WAYS lanes instead of a single lane, so
+ * each statement operates on the same lane of all states. The includer
+ * also provides:
+ *
+ * KECCAK_MB_NAME -> The implementation's name, the permutation function
+ *		     is keccakf1600_state_permute_<name>_x<ways>
+ * KECCAK_MB_LANE_T (optional) -> The vector type to use, by default it's
+ *		     a vector of KECCAK_MB_WAYS lanes using the compiler's
+ *		     vector extensions
+ * KECCAK_MB_ATTRS -> Extra function attributes (e.g. target ISA)
+ * MB_XOR, MB_XOR5, MB_ROTL, MB_CHI, MB_IOTA -> The operations used by
+ *		     the round function, see keccak1600_intermediateur_mb.c
+ */
+
+#define MB_CONCAT_(_a, _b, _c, _d)	_a##_b##_c##_d
+#define MB_CONCAT(_a, _b, _c, _d)	MB_CONCAT_(_a, _b, _c, _d)
+#define MB_SYM(_name)		MB_CONCAT(_name, KECCAK_MB_NAME, _x, KECCAK_MB_WAYS)
+
+#ifdef KECCAK_MB_LANE_T
+#define mb_lane_t		KECCAK_MB_LANE_T
+#else
+/* The vector's alignment is limited to a lane so
+ * that callers don't need to over-align the states */
+typedef lane_t MB_SYM(mb_lane_) __attribute__((
+	vector_size(KECCAK_MB_WAYS * KECCAK1600_LANE_BYTES),
+	aligned(KECCAK1600_LANE_BYTES)));
+
+#define mb_lane_t		MB_SYM(mb_lane_)
+#endif
+
+static inline __attribute__((always_inline)) KECCAK_MB_ATTRS void
+MB_SYM(keccakf1600_round_)(const mb_lane_t *A, mb_lane_t *N, int r_idx)
+{
+	mb_lane_t C[5];
+	mb_lane_t D[5];
+	mb_lane_t T[5];
+
+	/* Compute parity of columns */
+	C[0] = MB_XOR5(A[0], A[5], A[10], A[15], A[20]);
+	C[1] = MB_XOR5(A[1], A[6], A[11], A[16], A[21]);
+	C[2] = MB_XOR5(A[2], A[7], A[12], A[17], A[22]);
+	C[3] = MB_XOR5(A[3], A[8], A[13], A[18], A[23]);
+	C[4] = MB_XOR5(A[4], A[9], A[14], A[19], A[24]);
+
+	/* Compute theta for each column */
+	D[0] = MB_XOR(C[4], MB_ROTL(C[1], 1));
+	D[1] = MB_XOR(C[0], MB_ROTL(C[2], 1));
+	D[2] = MB_XOR(C[1], MB_ROTL(C[3], 1));
+	D[3] = MB_XOR(C[2], MB_ROTL(C[4], 1));
+	D[4] = MB_XOR(C[3], MB_ROTL(C[0], 1));
+
+	/* 1st plane */
+
+	/* Apply theta-rho-pi */
+	T[0] = MB_XOR(A[0], D[0]);
+	T[1] = MB_ROTL(MB_XOR(A[6], D[1]), 44);
+	T[2] = MB_ROTL(MB_XOR(A[12], D[2]), 43);
+	T[3] = MB_ROTL(MB_XOR(A[18], D[3]), 21);
+	T[4] = MB_ROTL(MB_XOR(A[24], D[4]), 14);
+
+	/* Apply chi */
+	/* Also apply iota since we are here */
+	N[0] = MB_IOTA(MB_CHI(T[0], T[1], T[2]), round_constants[r_idx]);
+	N[1] = MB_CHI(T[1], T[2], T[3]);
+	N[2] = MB_CHI(T[2], T[3], T[4]);
+	N[3] = MB_CHI(T[3], T[4], T[0]);
+	N[4] = MB_CHI(T[4], T[0], T[1]);
+
+	/* 2nd plane */
+
+	T[0] = MB_ROTL(MB_XOR(A[3], D[3]), 28);
+	T[1] = MB_ROTL(MB_XOR(A[9], D[4]), 20);
+	T[2] = MB_ROTL(MB_XOR(A[10], D[0]), 3);
+	T[3] = MB_ROTL(MB_XOR(A[16], D[1]), 45);
+	T[4] = MB_ROTL(MB_XOR(A[22], D[2]), 61);
+
+	N[5] = MB_CHI(T[0], T[1], T[2]);
+	N[6] = MB_CHI(T[1], T[2], T[3]);
+	N[7] = MB_CHI(T[2], T[3], T[4]);
+	N[8] = MB_CHI(T[3], T[4], T[0]);
+	N[9] = MB_CHI(T[4], T[0], T[1]);
+
+	/* 3rd plane */
+
+	T[0] = MB_ROTL(MB_XOR(A[1], D[1]), 1);
+	T[1] = MB_ROTL(MB_XOR(A[7], D[2]), 6);
+	T[2] = MB_ROTL(MB_XOR(A[13], D[3]), 25);
+	T[3] = MB_ROTL(MB_XOR(A[19], D[4]), 8);
+	T[4] = MB_ROTL(MB_XOR(A[20], D[0]), 18);
+
+	N[10] = MB_CHI(T[0], T[1], T[2]);
+	N[11] = MB_CHI(T[1], T[2], T[3]);
+	N[12] = MB_CHI(T[2], T[3], T[4]);
+	N[13] = MB_CHI(T[3], T[4], T[0]);
+	N[14] = MB_CHI(T[4], T[0], T[1]);
+
+	/* 4th plane */
+
+	T[0] = MB_ROTL(MB_XOR(A[4], D[4]), 27);
+	T[1] = MB_ROTL(MB_XOR(A[5], D[0]), 36);
+	T[2] = MB_ROTL(MB_XOR(A[11], D[1]), 10);
+	T[3] = MB_ROTL(MB_XOR(A[17], D[2]), 15);
+	T[4] = MB_ROTL(MB_XOR(A[23], D[3]), 56);
+
+	N[15] = MB_CHI(T[0], T[1], T[2]);
+	N[16] = MB_CHI(T[1], T[2], T[3]);
+	N[17] = MB_CHI(T[2], T[3], T[4]);
+	N[18] = MB_CHI(T[3], T[4], T[0]);
+	N[19] = MB_CHI(T[4], T[0], T[1]);
+
+	/* 5th plane */
+
+	T[0] = MB_ROTL(MB_XOR(A[2], D[2]), 62);
+	T[1] = MB_ROTL(MB_XOR(A[8], D[3]), 55);
+	T[2] = MB_ROTL(MB_XOR(A[14], D[4]), 39);
+	T[3] = MB_ROTL(MB_XOR(A[15], D[0]), 41);
+	T[4] = MB_ROTL(MB_XOR(A[21], D[1]), 2);
+
+	N[20] = MB_CHI(T[0], T[1], T[2]);
+	N[21] = MB_CHI(T[1], T[2], T[3]);
+	N[22] = MB_CHI(T[2], T[3], T[4]);
+	N[23] = MB_CHI(T[3], T[4], T[0]);
+	N[24] = MB_CHI(T[4], T[0], T[1]);
+}
+
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
+KECCAK_MB_ATTRS void
+MB_SYM(keccakp1600_state_permute_)(lane_t *A, unsigned int nr)
+{
+	mb_lane_t *A_mb = (mb_lane_t *) A;
+	mb_lane_t N[KECCAK_NUM_LANES];
+	int i = KECCAK1600_NUM_ROUNDS - nr;
+	int j = 0;
+
+	/* Rounds go in pairs so that we end up with the
+	 * result on A, for an odd number of rounds do
+	 * the first one separately and copy it back */
+	if (nr & 1) {
+		MB_SYM(keccakf1600_round_)(A_mb, N, i++);
+		for (j = 0; j < KECCAK_NUM_LANES; j++)
+			A_mb[j] = N[j];
+	}
+
+	for (; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+		MB_SYM(keccakf1600_round_)(A_mb, N, i);
+		MB_SYM(keccakf1600_round_)(N, A_mb, i + 1);
+	}
+}
+
+KECCAK_MB_ATTRS void
+MB_SYM(keccakf1600_state_permute_)(lane_t *A)
+{
+	mb_lane_t *A_mb = (mb_lane_t *) A;
+	mb_lane_t N[KECCAK_NUM_LANES];
+	int i = 0;
+
+	for (i = 0; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+		MB_SYM(keccakf1600_round_)(A_mb, N, i);
+		MB_SYM(keccakf1600_round_)(N, A_mb, i + 1);
+	}
+}
+
+#undef mb_lane_t
+#undef MB_SYM
+#undef MB_CONCAT
+#undef MB_CONCAT_
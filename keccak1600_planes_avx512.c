@@ -0,0 +1,144 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - AVX-512 single state permutation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+#include "keccak1600.h"
+
+/*
+ * Here we keep each plane (the 5 lanes of a row, for the same y) on
+ * the lower 5 lanes of a zmm register, so the whole state fits in 5
+ * registers and each step works on a whole plane at once. The upper
+ * 3 lanes of each register are don't care, we never move them into
+ * the lower 5 lanes and we don't store them back.
+ *
+ * Theta: The column parity is the xor of the 5 planes, and D is
+ * C rotated by one lane on each direction (vpermq), with the second
+ * one also rotated by one bit, same as C[x - 1] ^ rotl(C[x + 1], 1).
+ *
+ * Rho: Each lane has a different rotation offset, vprolvq does that
+ * for a whole plane.
+ *
+ * Pi: This is the expensive one since lanes move to other planes,
+ * plane y of the output gets lane (x + 3y) % 5 from each input plane
+ * x, so a diagonal of the 5x5 matrix. We gather that diagonal with
+ * masked blends, so that lane x + 3y comes from plane x, and then
+ * rotate it into place with a vpermq.
+ *
+ * Chi: Same as theta we rotate the plane by one and two lanes
+ * and do a ^ (~b & c) with a single vpternlogq.
+ *
+ * Iota: A xor with the round constant on lane 0 of the first plane.
+ */
+
+static const lane_t round_constants[KECCAK1600_NUM_ROUNDS] =
+	{ 0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
+
+/* Rotation offsets for each plane, indexed by x */
+static const lane_t rho_offsets[KECCAK_NUM_ROWS][KECCAK_NUM_COLS] =
+	{ {  0,  1, 62, 28, 27 },
+	  { 36, 44,  6, 55, 20 },
+	  {  3, 10, 43, 25, 39 },
+	  { 41, 45, 15, 21,  8 },
+	  { 18,  2, 61, 56, 14 } };
+
+#define PLANE_MASK	0x1F
+#define TERNLOG_XOR3	0x96	/* a ^ b ^ c */
+#define TERNLOG_CHI	0xD2	/* a ^ (~b & c) */
+
+/* Indices for vpermq, to rotate a plane by _n lanes
+ * (lane x gets lane (x + _n) % 5) */
+#define PLANE_ROT_IDX(_n)	_mm512_setr_epi64((0 + (_n)) % 5, (1 + (_n)) % 5, \
+						  (2 + (_n)) % 5, (3 + (_n)) % 5, \
+						  (4 + (_n)) % 5, 5, 6, 7)
+
+/*
+ * Gather the diagonal for the output plane y, with
+ * _k = 3y % 5, lane (x + _k) % 5 comes from plane x.
+ */
+#define PI_DIAG(_P, _k)									\
+	_mm512_mask_blend_epi64(1 << ((4 + (_k)) % 5),					\
+	_mm512_mask_blend_epi64(1 << ((3 + (_k)) % 5),					\
+	_mm512_mask_blend_epi64(1 << ((2 + (_k)) % 5),					\
+	_mm512_mask_blend_epi64(1 << ((1 + (_k)) % 5), _P[0], _P[1]),			\
+	_P[2]), _P[3]), _P[4])
+
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
+__attribute__((target("avx512f"))) void
+keccakp1600_state_permute_avx512(k1600_state_t *st, unsigned int nr)
+{
+	const __m512i rot_m1 = PLANE_ROT_IDX(4);
+	const __m512i rot_p1 = PLANE_ROT_IDX(1);
+	const __m512i rot_p2 = PLANE_ROT_IDX(2);
+	__m512i rho[KECCAK_NUM_ROWS];
+	__m512i P[KECCAK_NUM_ROWS];
+	__m512i B[KECCAK_NUM_ROWS];
+	__m512i C;
+	__m512i D;
+	int i = 0;
+
+	for (i = 0; i < KECCAK_NUM_ROWS; i++) {
+		P[i] = _mm512_maskz_loadu_epi64(PLANE_MASK, &st->A[i * KECCAK_NUM_COLS]);
+		rho[i] = _mm512_maskz_loadu_epi64(PLANE_MASK, rho_offsets[i]);
+	}
+
+	for (i = KECCAK1600_NUM_ROUNDS - nr; i < KECCAK1600_NUM_ROUNDS; i++) {
+		/* Theta */
+		C = _mm512_ternarylogic_epi64(P[0], P[1], P[2], TERNLOG_XOR3);
+		C = _mm512_ternarylogic_epi64(C, P[3], P[4], TERNLOG_XOR3);
+		D = _mm512_xor_si512(_mm512_permutexvar_epi64(rot_m1, C),
+				     _mm512_rol_epi64(_mm512_permutexvar_epi64(rot_p1, C), 1));
+
+		/* Theta - Rho */
+		P[0] = _mm512_rolv_epi64(_mm512_xor_si512(P[0], D), rho[0]);
+		P[1] = _mm512_rolv_epi64(_mm512_xor_si512(P[1], D), rho[1]);
+		P[2] = _mm512_rolv_epi64(_mm512_xor_si512(P[2], D), rho[2]);
+		P[3] = _mm512_rolv_epi64(_mm512_xor_si512(P[3], D), rho[3]);
+		P[4] = _mm512_rolv_epi64(_mm512_xor_si512(P[4], D), rho[4]);
+
+		/* Pi */
+		B[0] = PI_DIAG(P, 0);
+		B[1] = _mm512_permutexvar_epi64(PLANE_ROT_IDX(3), PI_DIAG(P, 3));
+		B[2] = _mm512_permutexvar_epi64(PLANE_ROT_IDX(1), PI_DIAG(P, 1));
+		B[3] = _mm512_permutexvar_epi64(PLANE_ROT_IDX(4), PI_DIAG(P, 4));
+		B[4] = _mm512_permutexvar_epi64(PLANE_ROT_IDX(2), PI_DIAG(P, 2));
+
+		/* Chi */
+		P[0] = _mm512_ternarylogic_epi64(B[0], _mm512_permutexvar_epi64(rot_p1, B[0]),
+						 _mm512_permutexvar_epi64(rot_p2, B[0]), TERNLOG_CHI);
+		P[1] = _mm512_ternarylogic_epi64(B[1], _mm512_permutexvar_epi64(rot_p1, B[1]),
+						 _mm512_permutexvar_epi64(rot_p2, B[1]), TERNLOG_CHI);
+		P[2] = _mm512_ternarylogic_epi64(B[2], _mm512_permutexvar_epi64(rot_p1, B[2]),
+						 _mm512_permutexvar_epi64(rot_p2, B[2]), TERNLOG_CHI);
+		P[3] = _mm512_ternarylogic_epi64(B[3], _mm512_permutexvar_epi64(rot_p1, B[3]),
+						 _mm512_permutexvar_epi64(rot_p2, B[3]), TERNLOG_CHI);
+		P[4] = _mm512_ternarylogic_epi64(B[4], _mm512_permutexvar_epi64(rot_p1, B[4]),
+						 _mm512_permutexvar_epi64(rot_p2, B[4]), TERNLOG_CHI);
+
+		/* Iota */
+		P[0] = _mm512_mask_xor_epi64(P[0], 1, P[0],
+					     _mm512_set1_epi64(round_constants[i]));
+	}
+
+	for (i = 0; i < KECCAK_NUM_ROWS; i++)
+		_mm512_mask_storeu_epi64(&st->A[i * KECCAK_NUM_COLS], PLANE_MASK, P[i]);
+}
+
+__attribute__((target("avx512f"))) void
+keccakf1600_state_permute_avx512(k1600_state_t *st)
+{
+	keccakp1600_state_permute_avx512(st, KECCAK1600_NUM_ROUNDS);
+}
+
+#endif /* __x86_64__ */
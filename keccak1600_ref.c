@@ -5,6 +5,7 @@
  */
 
 #include "keccak1600.h"
+#include "keccak1600_tables.h"
 
 
 /**********************\
@@ -84,14 +85,9 @@ static inline void theta(lane_t *A)
  * from section 2.5 of "Keccak implementation overview".
  *
  * With the above in mind, here is the final array of indices for the Pi mapping
- * excluding 0 (since pi mapping doesn't modify 0,0).
+ * excluding 0 (since pi mapping doesn't modify 0,0), it's on keccak1600_tables.h
+ * (keccak1600_pi_lane_idxes) since the permutation template also uses it.
  */
-static const uint_fast8_t pi_lane_idxes[KECCAK_NUM_LANES - 1] =
-	{ 10,  7, 11, 17, 18,
-	   3,  5, 16,  8, 21,
-	  24,  4, 15, 23, 19,
-	  13, 12,  2, 20, 14,
-	  22,  9,  6,  1};
 
 /*
  * Rho step, Section 2.3.4
@@ -116,18 +112,13 @@ static const uint_fast8_t pi_lane_idxes[KECCAK_NUM_LANES - 1] =
  * (comes from https://keccak.team/keccak_specs_summary.html)
  *
  * However since we follow the pi mapping anyway, we can apply rho together with pi,
- * and this array just becomes the same as the sequence, we keep it here for convenience:
+ * and this array just becomes the same as the sequence, we keep it on
+ * keccak1600_tables.h for convenience (keccak1600_rho_pi_offsets).
  */
  #if !defined(__OPTIMIZE_SIZE__)
-static const uint_fast8_t rho_offsets[KECCAK_NUM_LANES - 1] =
-	{ 1,  3,  6, 10, 15,
-	 21, 28, 36, 45, 55,
-	  2, 14, 27, 41, 56,
-	  8, 25, 43, 62, 18,
-	 39, 61, 20, 44};
 static inline int get_rho_for_idx(int idx)
 {
-	return rho_offsets[idx];
+	return keccak1600_rho_pi_offsets[idx];
 }
 #else
  /* This will return the rotation constants for each index
@@ -146,11 +137,11 @@ static inline void rho_pi(lane_t *A)
 	uint_fast8_t i = 0;
 	lane_t first = A[1]; /* Save (1,0) for the last step */
 	for (i = KECCAK_NUM_LANES - 2; i > 0; i--) {
-		lane_t next = A[pi_lane_idxes[i - 1]];
-		A[pi_lane_idxes[i]] = rotl_lane(next, get_rho_for_idx(i));
+		lane_t next = A[keccak1600_pi_lane_idxes[i - 1]];
+		A[keccak1600_pi_lane_idxes[i]] = rotl_lane(next, get_rho_for_idx(i));
 	}
 	/* Reached (0,2), move to (1,0) */
-	A[pi_lane_idxes[0]] = rotl_lane(first, get_rho_for_idx(0));
+	A[keccak1600_pi_lane_idxes[0]] = rotl_lane(first, get_rho_for_idx(0));
 }
 
 /*
@@ -195,22 +186,13 @@ static inline void chi(lane_t *A)
  * can be easily compressed. We'll use that property for the
  * size-optimized implementation. Here we'll just store the round
  * constants to be xored as the authors intended, the table comes from
- * https://keccak.team/keccak_specs_summary.html
+ * https://keccak.team/keccak_specs_summary.html (keccak1600_round_constants
+ * on keccak1600_tables.h).
  */
  #if !defined(__OPTIMIZE_SIZE__)
- static const lane_t round_constants[KECCAK1600_NUM_ROUNDS] =
- 	{ 0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
-	  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
-	  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
-	  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
-	  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
-	  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
-	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
-	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
-
 static inline void iota(lane_t *A, unsigned int round)
 {
-	A[0] ^= round_constants[round];
+	A[0] ^= keccak1600_round_constants[round];
 }
 #else
 /* Storing round constants in 64bit format takes a lot of space, calculating them
@@ -243,14 +225,25 @@ static inline void iota(lane_t *A, unsigned int round)
 * KECCAK-F1600 STATE PERMUTATION / ENTRY POINT *
 \**********************************************/
 
+/*
+ * Keccak-p[1600, nr] is Keccak-f[1600] with only the last nr
+ * rounds, so that we always end with round index 23 (e.g.
+ * KangarooTwelve uses rounds 12 - 23).
+ */
 void
-keccakf1600_state_permute_ref(k1600_state_t *st)
+keccakp1600_state_permute_ref(k1600_state_t *st, unsigned int nr)
 {
 	int i = 0;
-	for (i = 0; i < KECCAK1600_NUM_ROUNDS; i++) {
+	for (i = KECCAK1600_NUM_ROUNDS - nr; i < KECCAK1600_NUM_ROUNDS; i++) {
 		theta(st->A);
 		rho_pi(st->A);
 		chi(st->A);
 		iota(st->A, i);
 	}
+}
+
+void
+keccakf1600_state_permute_ref(k1600_state_t *st)
+{
+	keccakp1600_state_permute_ref(st, KECCAK1600_NUM_ROUNDS);
 }
\ No newline at end of file
@@ -5,149 +5,785 @@
  */
 
 #include "keccak1600.h"
-#include <string.h>		/* For memcpy() */
-#include <stdbool.h>		/* For bool */
+#include <stdlib.h>		/* For aligned_alloc() / free() */
+#include <string.h>		/* For memcpy() / strcmp() */
 
-/*******************************\
-* WRAPPER FOR STATE PERMUTATION *
-\*******************************/
-/* Stub function so that we don't check for NULL every time */
-static void stub_state_permute(k1600_state_t * st)  { return; }
-static keccak1600_spf keccakf1600_state_permute = &stub_state_permute;
-static bool use_lc = false;
+/******************\
+* ENGINE SELECTION *
+\******************/
+/* The default engine is only read once when initializing a
+ * context, so switching it while other threads are hashing
+ * won't affect them. Engines are immutable, so we only need
+ * the pointer itself to be updated atomically. */
+static const k1600_engine_t *default_engine = &keccakf1600_engine_intermediateur;
+
+/* Used by keccakf1600_set_permutation_function() for functions
+ * we don't have a descriptor for */
+static k1600_engine_t custom_engine = { .name = "custom" };
 
 /******************\
 * SPONGE FUNCTIONS *
 \******************/
 
+/* Keccak-f[1600], unless the context asked for fewer rounds */
 static inline void
-keccakf1600_absorb_lanes(k1600_state_t * st, const void *msg,
-			 int num_lanes, int *msg_off)
+keccakf1600_permute(k1600_ctx_t *ctx)
 {
-	int i = 0;
-
-	for (i = 0; i < num_lanes; i++, (*msg_off) += KECCAK1600_LANE_BYTES)
-		st->A[i] ^= (*((lane_t *) (msg + (*msg_off))));
-
-	keccakf1600_state_permute(st);
+	if (ctx->rounds == KECCAK1600_NUM_ROUNDS)
+		ctx->eng->permute(&ctx->st);
+	else
+		ctx->eng->permute_rounds(&ctx->st, ctx->rounds);
 }
 
+/* Absorb num_blocks full blocks, msg is lane aligned unless
+ * the target handles misaligned loads (KECCAK1600_FAST_UNALIGNED) */
 static void
-keccakf1600_absorb(k1600_state_t * st, const void *msg, size_t msg_len,
-		   size_t md_len, uint8_t delim_suffix)
-{
-	int capacity_bytes = 2 * md_len;
-	int rate_bytes = KECCAK1600_STATE_SIZE - capacity_bytes;
-	int num_blocks = msg_len / rate_bytes;
-	int lanes_per_block = rate_bytes / KECCAK1600_LANE_BYTES;
-	int msg_off = 0;
-	int block_off = 0;
-	int i = 0;
+keccakf1600_absorb_blocks(k1600_ctx_t *ctx, const uint8_t *msg,
+			  size_t num_blocks)
+{
+	k1600_state_t *st = &ctx->st;
+	size_t lanes_per_block = ctx->rate_bytes / KECCAK1600_LANE_BYTES;
+	size_t i = 0;
 
-	/* Absorb message */
+	/* Let the engine absorb all blocks in one go if it can */
+	if (ctx->eng->absorb) {
+		ctx->eng->absorb(st, msg, num_blocks, lanes_per_block,
+				 ctx->rounds);
+		return;
+	}
 
 	/* Blocks are multiples of lane size
 	 * so absorb a lane at a time (instead of
 	 * a byte at a time) to speed things up */
-	for (i = 0; i < num_blocks; i++)
-		keccakf1600_absorb_lanes(st, msg, lanes_per_block, &msg_off);
+	msg = KECCAK1600_ASSUME_ALIGNED(msg);
+	for (; num_blocks > 0; num_blocks--) {
+		for (i = 0; i < lanes_per_block; i++, msg += KECCAK1600_LANE_BYTES)
+			st->A[i] ^= load_lane(msg);
+		keccakf1600_permute(ctx);
+	}
+}
 
-	/* Handle any remaining bytes */
-	for (i = msg_off; i < msg_len; i++) {
-		st->A_bytes[block_off++] ^= ((const uint8_t *)msg)[i];
-		if (block_off == rate_bytes) {
-			keccakf1600_state_permute(st);
-			block_off = 0;
+static void
+keccakf1600_absorb(k1600_ctx_t *ctx, const void *msg, size_t msg_len)
+{
+	k1600_state_t *st = &ctx->st;
+	const uint8_t *msg_off = msg;
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t block_off = ctx->block_off;
+	size_t num_blocks = 0;
+#ifndef KECCAK1600_FAST_UNALIGNED
+	lane_t bounce[KECCAK1600_BOUNCE_BLOCKS * KECCAK_NUM_LANES];
+	size_t bounce_blocks = 0;
+#endif
+
+	/* Complete any partial block left over
+	 * from a previous call */
+	if (block_off > 0) {
+		while (msg_len > 0 && block_off < rate_bytes) {
+			xor_state_byte(st, block_off++, *msg_off++);
+			msg_len--;
+		}
+		if (block_off < rate_bytes) {
+			ctx->block_off = block_off;
+			return;
 		}
+		keccakf1600_permute(ctx);
+		block_off = 0;
+	}
+
+	num_blocks = msg_len / rate_bytes;
+
+#ifndef KECCAK1600_FAST_UNALIGNED
+	/* Misaligned loads are slow here (or trap), so copy
+	 * misaligned blocks to an aligned buffer first, a few
+	 * at a time, memcpy() knows how to do that efficiently.
+	 * Since the rate is a multiple of the lane size this
+	 * applies to either all of the blocks or none of them. */
+	while (num_blocks > 0 && !KECCAK1600_LANE_ALIGNED(msg_off)) {
+		bounce_blocks = sizeof(bounce) / rate_bytes;
+		if (bounce_blocks > num_blocks)
+			bounce_blocks = num_blocks;
+		memcpy(bounce, msg_off, bounce_blocks * rate_bytes);
+		keccakf1600_absorb_blocks(ctx, (const uint8_t *) bounce,
+					  bounce_blocks);
+		msg_off += bounce_blocks * rate_bytes;
+		msg_len -= bounce_blocks * rate_bytes;
+		num_blocks -= bounce_blocks;
+	}
+#endif
+
+	/* Absorb directly from the caller's buffer */
+	if (num_blocks > 0) {
+		keccakf1600_absorb_blocks(ctx, msg_off, num_blocks);
+		msg_off += num_blocks * rate_bytes;
+		msg_len -= num_blocks * rate_bytes;
 	}
 
+	/* Handle any remaining bytes, those are
+	 * less than a block so we won't permute
+	 * here, we'll do it on the next call or
+	 * when padding. */
+	while (msg_len > 0) {
+		xor_state_byte(st, block_off++, *msg_off++);
+		msg_len--;
+	}
+
+	ctx->block_off = block_off;
+}
+
+static void
+keccakf1600_pad(k1600_ctx_t *ctx)
+{
+	k1600_state_t *st = &ctx->st;
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t block_off = ctx->block_off;
+	uint8_t delim_suffix = ctx->delim_suffix;
+
 	/* Absorb padding */
 	/* For delim_suffix check out
 	 * https://keccak.team/keccak_specs_summary.html */
-	st->A_bytes[block_off] ^= delim_suffix;
+	xor_state_byte(st, block_off, delim_suffix);
 
 	/* The delimiter is at the end of the block, we need
 	 * another block for the second bit of padding, absorb
 	 * this one and work on the next */
 	if ((delim_suffix & 0x80) && (block_off == (rate_bytes - 1)))
-		keccakf1600_state_permute(st);
+		keccakf1600_permute(ctx);
+
+	xor_state_byte(st, rate_bytes - 1, 0x80);
+	keccakf1600_permute(ctx);
+
+	/* From now on block_off tracks the squeezed bytes */
+	ctx->block_off = 0;
+	ctx->squeezing = 1;
+}
 
-	st->A_bytes[rate_bytes - 1] ^= 0x80;
-	keccakf1600_state_permute(st);
+/* Copy len bytes of the current block to out, starting from block
+ * offset off, st is in the standard encoding (see keccakf1600_squeeze) */
+static void
+keccakf1600_extract(const k1600_state_t *st, uint8_t *out, size_t off,
+		    size_t len)
+{
+#if KECCAK1600_BIG_ENDIAN
+	size_t i = 0;
+
+	/* Byte-swap whole lanes while storing them, and go
+	 * byte by byte for the partial ones at the edges */
+	for (i = off; i < off + len; ) {
+		if (!(i % KECCAK1600_LANE_BYTES) &&
+		    i + KECCAK1600_LANE_BYTES <= off + len) {
+			store_lane(out + i - off,
+				   st->A[i / KECCAK1600_LANE_BYTES]);
+			i += KECCAK1600_LANE_BYTES;
+		} else {
+			out[i - off] = get_state_byte(st, i);
+			i++;
+		}
+	}
+#else
+	memcpy(out, st->A_bytes + off, len);
+#endif
 }
 
+/*
+ * Squeeze out_len bytes, this may be called more than once and
+ * continues from where the previous call stopped, block_off is
+ * the number of bytes already squeezed out of the current block.
+ * We only permute when we need more output, so that we don't
+ * pay for a block that nobody asked for. For engines with their
+ * own state encoding we export each block once to out_st and
+ * copy from there, instead of fixing up the output bytes.
+ */
 static void
-keccakf1600_squeeze(k1600_state_t *st, void *md, size_t md_len)
-{
-	int capacity_bytes = 2 * md_len;
-	int rate_bytes = KECCAK1600_STATE_SIZE - capacity_bytes;
-	int block_len = 0;
-	char *md_off = md;
-	int i = md_len;
-	int c = 0;
-
-	while (i > 0) {
-		block_len = (i < rate_bytes) ? i : rate_bytes;
-		memcpy(md_off, st->A_bytes, block_len);
-
-		if (use_lc) {
-			/* Apply P mask to output */
-			int lanes_out = block_len / 8;
-			lane_t *md_lanes = (lane_t *) md_off;
-			if (lanes_out > 1)
-				md_lanes[1] = ~md_lanes[1];
-			if (lanes_out > 2)
-				md_lanes[2] = ~md_lanes[2];
-			if (lanes_out > 8)
-				md_lanes[8] = ~md_lanes[8];
-			if (lanes_out > 12)
-				md_lanes[12] = ~md_lanes[12];
-			if (lanes_out > 17)
-				md_lanes[17] = ~md_lanes[17];
-			if (lanes_out > 20)
-				md_lanes[20] = ~md_lanes[20];
+keccakf1600_squeeze(k1600_ctx_t *ctx, void *out, size_t out_len)
+{
+	keccak1600_convf state_export = ctx->eng->state_export;
+	const k1600_state_t *out_st = &ctx->st;
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t block_off = ctx->block_off;
+	uint8_t *out_off = out;
+	size_t num_blocks = 0;
+	size_t block_len = 0;
+	k1600_state_t tmp;
+#ifndef KECCAK1600_FAST_UNALIGNED
+	lane_t bounce[KECCAK1600_BOUNCE_BLOCKS * KECCAK_NUM_LANES];
+#endif
+
+	if (state_export && block_off < rate_bytes && out_len > 0) {
+		state_export(&tmp, &ctx->st);
+		out_st = &tmp;
+	}
+
+	while (out_len > 0) {
+		/* Same as with absorb, let the engine
+		 * squeeze out all full blocks at once */
+		if (block_off == rate_bytes && ctx->eng->squeeze &&
+		    out_len >= rate_bytes) {
+			num_blocks = out_len / rate_bytes;
+#ifndef KECCAK1600_FAST_UNALIGNED
+			/* Same as on absorb, squeeze misaligned
+			 * blocks to an aligned buffer first */
+			if (!KECCAK1600_LANE_ALIGNED(out_off)) {
+				if (num_blocks > sizeof(bounce) / rate_bytes)
+					num_blocks = sizeof(bounce) / rate_bytes;
+				ctx->eng->squeeze(&ctx->st, bounce, num_blocks,
+						  rate_bytes / KECCAK1600_LANE_BYTES,
+						  ctx->rounds);
+				memcpy(out_off, bounce, num_blocks * rate_bytes);
+				out_off += num_blocks * rate_bytes;
+				out_len -= num_blocks * rate_bytes;
+				continue;
+			}
+#endif
+			ctx->eng->squeeze(&ctx->st, out_off, num_blocks,
+					  rate_bytes / KECCAK1600_LANE_BYTES,
+					  ctx->rounds);
+			out_off += num_blocks * rate_bytes;
+			out_len -= num_blocks * rate_bytes;
+			continue;
 		}
-		
-		md_off += block_len;
-		i -= block_len;
 
 		/* Squeeze another block out of the state */
-		if (i > 0)
-			keccakf1600_state_permute(st);
+		if (block_off == rate_bytes) {
+			keccakf1600_permute(ctx);
+			block_off = 0;
+			if (state_export) {
+				state_export(&tmp, &ctx->st);
+				out_st = &tmp;
+			}
+		}
+
+		block_len = rate_bytes - block_off;
+		if (block_len > out_len)
+			block_len = out_len;
+		keccakf1600_extract(out_st, out_off, block_off, block_len);
+
+		block_off += block_len;
+		out_off += block_len;
+		out_len -= block_len;
+	}
+
+	ctx->block_off = block_off;
+}
+
+/* Whether msg_len bytes, together with the padding, fit in a single
+ * block, so that keccakf1600_oneshot_block() can handle them */
+static inline int
+keccakf1600_fits_block(size_t rate_bytes, size_t msg_len, size_t md_len,
+		       uint8_t delim_suffix)
+{
+	if (md_len > rate_bytes || msg_len >= rate_bytes)
+		return 0;
+	/* Same as in keccakf1600_pad() */
+	if ((delim_suffix & 0x80) && msg_len == rate_bytes - 1)
+		return 0;
+	return 1;
+}
+
+/*
+ * Single block fast path, for messages that fit in a block together
+ * with the padding, and output that fits in a block. Instead of zeroing
+ * the state and xoring the message / padding bytes in, we build the
+ * padded block lane by lane (only the last, partial lane is assembled
+ * from bytes, together with the delimiter), permute once and store the
+ * output lanes straight from the state. This is always inlined so that
+ * callers with a constant msg_len get the loops unrolled.
+ */
+static inline __attribute__((always_inline)) void
+keccakf1600_oneshot_block(const k1600_engine_t *eng, unsigned int nr,
+			  size_t rate_bytes, const uint8_t *msg,
+			  size_t msg_len, uint8_t *md, size_t md_len,
+			  uint8_t delim_suffix)
+{
+	size_t full_lanes = msg_len / KECCAK1600_LANE_BYTES;
+	size_t tail = msg_len % KECCAK1600_LANE_BYTES;
+	size_t last_off = rate_bytes - 1;
+	lane_t last = 0;
+	size_t i = 0;
+	k1600_state_t st;
+
+	for (i = 0; i < full_lanes; i++)
+		st.A[i] = load_lane(msg + i * KECCAK1600_LANE_BYTES);
+
+	msg += full_lanes * KECCAK1600_LANE_BYTES;
+	last = ((lane_t) delim_suffix) << (8 * tail);
+	for (i = 0; i < tail; i++)
+		last |= ((lane_t) msg[i]) << (8 * i);
+	st.A[full_lanes] = last;
+
+	for (i = full_lanes + 1; i < KECCAK_NUM_LANES; i++)
+		st.A[i] = 0;
+	st.A[last_off / KECCAK1600_LANE_BYTES] ^=
+		((lane_t) 0x80) << (8 * (last_off % KECCAK1600_LANE_BYTES));
+
+	if (eng->state_import)
+		eng->state_import(&st, &st);
+	if (nr == KECCAK1600_NUM_ROUNDS)
+		eng->permute(&st);
+	else
+		eng->permute_rounds(&st, nr);
+	if (eng->state_export)
+		eng->state_export(&st, &st);
+
+	for (i = 0; i + KECCAK1600_LANE_BYTES <= md_len;
+	     i += KECCAK1600_LANE_BYTES)
+		store_lane(md + i, st.A[i / KECCAK1600_LANE_BYTES]);
+	for (; i < md_len; i++)
+		md[i] = get_state_byte(&st, i);
+}
+
+
+/*******************************\
+* MULTI-BUFFER SPONGE FUNCTIONS *
+\*******************************/
+
+static inline void
+keccakf1600_permute_mb(const k1600_mb_engine_t *eng, lane_t *A, unsigned int nr)
+{
+	if (nr == KECCAK1600_NUM_ROUNDS)
+		eng->permute(A);
+	else
+		eng->permute_rounds(A, nr);
+}
+
+/* Xor a byte to lane i of state j, this doesn't depend on
+ * the host's endianess since we never go through A_bytes
+ * (and load_lane() takes care of the full lanes) */
+static inline void
+keccakf1600_mb_xor_byte(lane_t *A, unsigned int ways, unsigned int j,
+			size_t byte_off, uint8_t val)
+{
+	A[(byte_off / KECCAK1600_LANE_BYTES) * ways + j] ^=
+		((lane_t) val) << (8 * (byte_off % KECCAK1600_LANE_BYTES));
+}
+
+/* Xor len bytes of each message to the interleaved states starting
+ * from block offset off, full lanes are loaded in one go */
+static void
+keccakf1600_mb_xor_bytes(lane_t *A, unsigned int ways,
+			 const void *const msgs[], size_t msg_off,
+			 size_t off, size_t len)
+{
+	const uint8_t *msg = NULL;
+	unsigned int j = 0;
+	size_t i = 0;
+
+	for (j = 0; j < ways; j++) {
+		msg = (const uint8_t *) msgs[j] + msg_off;
+		for (i = 0; i < len; ) {
+			if (!((off + i) % KECCAK1600_LANE_BYTES) &&
+			    len - i >= KECCAK1600_LANE_BYTES) {
+				A[((off + i) / KECCAK1600_LANE_BYTES) * ways + j] ^=
+					load_lane(msg + i);
+				i += KECCAK1600_LANE_BYTES;
+			} else {
+				keccakf1600_mb_xor_byte(A, ways, j, off + i,
+							msg[i]);
+				i++;
+			}
+		}
+	}
+}
+
+/* Store len bytes of each state to each output, starting from
+ * block offset off, same as above full lanes go in one go */
+static void
+keccakf1600_mb_extract(const lane_t *A, unsigned int ways,
+		       void *const outs[], size_t out_off, size_t off,
+		       size_t len)
+{
+	uint8_t *out = NULL;
+	unsigned int j = 0;
+	size_t i = 0;
+	size_t lane = 0;
+
+	for (j = 0; j < ways; j++) {
+		out = (uint8_t *) outs[j] + out_off;
+		for (i = 0; i < len; ) {
+			lane = (off + i) / KECCAK1600_LANE_BYTES;
+			if (!((off + i) % KECCAK1600_LANE_BYTES) &&
+			    len - i >= KECCAK1600_LANE_BYTES) {
+				store_lane(out + i, A[lane * ways + j]);
+				i += KECCAK1600_LANE_BYTES;
+			} else {
+				out[i] = A[lane * ways + j] >>
+					 (8 * ((off + i) % KECCAK1600_LANE_BYTES));
+				i++;
+			}
+		}
+	}
+}
+
+static void
+keccakf1600_absorb_mb(k1600_mb_ctx_t *ctx, const void *const msgs[],
+		      size_t msg_len)
+{
+	const k1600_mb_engine_t *eng = ctx->eng;
+	unsigned int ways = eng->ways;
+	lane_t *A = ctx->A;
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t lanes_per_block = rate_bytes / KECCAK1600_LANE_BYTES;
+	size_t block_off = ctx->block_off;
+	size_t msg_off = 0;
+	size_t len = 0;
+	unsigned int j = 0;
+	size_t i = 0;
+
+	/* Complete any partial block left over
+	 * from a previous call */
+	if (block_off > 0) {
+		len = rate_bytes - block_off;
+		if (len > msg_len)
+			len = msg_len;
+		keccakf1600_mb_xor_bytes(A, ways, msgs, 0, block_off, len);
+		block_off += len;
+		msg_off = len;
+		if (block_off < rate_bytes) {
+			ctx->block_off = block_off;
+			return;
+		}
+		keccakf1600_permute_mb(eng, A, ctx->rounds);
+		block_off = 0;
+	}
+
+	/* Absorb full blocks, a lane at a time, one
+	 * lane of all states before moving on to the
+	 * next to match the interleaved layout */
+	for (; msg_len - msg_off >= rate_bytes; msg_off += rate_bytes) {
+		for (i = 0; i < lanes_per_block; i++)
+			for (j = 0; j < ways; j++)
+				A[i * ways + j] ^= load_lane(
+					(const uint8_t *) msgs[j] + msg_off +
+					i * KECCAK1600_LANE_BYTES);
+		keccakf1600_permute_mb(eng, A, ctx->rounds);
+	}
+
+	/* Handle any remaining bytes, we'll
+	 * permute on the next call or when
+	 * padding */
+	len = msg_len - msg_off;
+	keccakf1600_mb_xor_bytes(A, ways, msgs, msg_off, 0, len);
+	ctx->block_off = len;
+}
+
+/* Same as keccakf1600_pad() */
+static void
+keccakf1600_pad_mb(k1600_mb_ctx_t *ctx)
+{
+	const k1600_mb_engine_t *eng = ctx->eng;
+	unsigned int ways = eng->ways;
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t block_off = ctx->block_off;
+	uint8_t delim_suffix = ctx->delim_suffix;
+	unsigned int j = 0;
+
+	for (j = 0; j < ways; j++)
+		keccakf1600_mb_xor_byte(ctx->A, ways, j, block_off,
+					delim_suffix);
+
+	if ((delim_suffix & 0x80) && (block_off == (rate_bytes - 1)))
+		keccakf1600_permute_mb(eng, ctx->A, ctx->rounds);
+
+	for (j = 0; j < ways; j++)
+		keccakf1600_mb_xor_byte(ctx->A, ways, j, rate_bytes - 1, 0x80);
+	keccakf1600_permute_mb(eng, ctx->A, ctx->rounds);
+
+	ctx->block_off = 0;
+	ctx->squeezing = 1;
+}
+
+/* Same as keccakf1600_squeeze() */
+static void
+keccakf1600_squeeze_mb(k1600_mb_ctx_t *ctx, void *const outs[],
+		       size_t out_len)
+{
+	size_t rate_bytes = ctx->rate_bytes;
+	size_t block_off = ctx->block_off;
+	size_t out_off = 0;
+	size_t block_len = 0;
+
+	while (out_off < out_len) {
+		/* Squeeze another block out of the states */
+		if (block_off == rate_bytes) {
+			keccakf1600_permute_mb(ctx->eng, ctx->A, ctx->rounds);
+			block_off = 0;
+		}
+
+		block_len = rate_bytes - block_off;
+		if (block_len > out_len - out_off)
+			block_len = out_len - out_off;
+		keccakf1600_mb_extract(ctx->A, ctx->eng->ways, outs, out_off,
+				       block_off, block_len);
+
+		block_off += block_len;
+		out_off += block_len;
 	}
+
+	ctx->block_off = block_off;
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+void
+keccakf1600_set_default_engine(const k1600_engine_t *eng)
+{
+	__atomic_store_n(&default_engine, eng, __ATOMIC_RELEASE);
+}
+
+const k1600_engine_t *
+keccakf1600_get_default_engine(void)
+{
+	return __atomic_load_n(&default_engine, __ATOMIC_ACQUIRE);
+}
+
+const k1600_engine_t *
+keccakf1600_get_engine(const char *name)
+{
+	int i = 0;
+
+	for (i = 0; keccakf1600_engines[i] != NULL; i++)
+		if (!strcmp(keccakf1600_engines[i]->name, name))
+			return keccakf1600_engines[i];
+
+	return NULL;
 }
 
+void
+keccakf1600_state_convert_lc(k1600_state_t *dst, const k1600_state_t *src)
+{
+	int i = 0;
 
-/*************\
-* ENTRY POINT *
-\*************/
+	for (i = 0; i < KECCAK_NUM_LANES; i++)
+		dst->A[i] = src->A[i];
+
+	dst->A[1] = ~dst->A[1];
+	dst->A[2] = ~dst->A[2];
+	dst->A[8] = ~dst->A[8];
+	dst->A[12] = ~dst->A[12];
+	dst->A[17] = ~dst->A[17];
+	dst->A[20] = ~dst->A[20];
+}
 
 void
 keccakf1600_set_permutation_function(keccak1600_spf func, int lc)
 {
-	keccakf1600_state_permute = func;
-	if (lc)
-		use_lc = true;
+	int i = 0;
+
+	/* Prefer one of the registered (immutable) descriptors */
+	for (i = 0; keccakf1600_engines[i] != NULL; i++) {
+		if (keccakf1600_engines[i]->permute == func &&
+		    keccakf1600_engines[i]->lc == !!lc) {
+			keccakf1600_set_default_engine(keccakf1600_engines[i]);
+			return;
+		}
+	}
+
+	/* Note that this one is shared, so it's not safe to
+	 * call this with an unregistered function while
+	 * other threads are hashing. */
+	custom_engine.permute = func;
+	custom_engine.state_import = lc ? &keccakf1600_state_convert_lc : NULL;
+	custom_engine.state_export = lc ? &keccakf1600_state_convert_lc : NULL;
+	custom_engine.lc = !!lc;
+	keccakf1600_set_default_engine(&custom_engine);
+}
+
+void
+keccakp1600_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+		 unsigned int nr, size_t rate_bytes, size_t md_len,
+		 uint8_t delim_suffix)
+{
+	memset(ctx, 0, sizeof(k1600_ctx_t));
+	ctx->eng = eng ? eng : keccakf1600_get_default_engine();
+	if (nr != KECCAK1600_NUM_ROUNDS && !ctx->eng->permute_rounds)
+		ctx->eng = &keccakf1600_engine_ref;
+	ctx->rate_bytes = rate_bytes;
+	ctx->md_len = md_len;
+	ctx->rounds = nr;
+	ctx->delim_suffix = delim_suffix;
+
+	/* Switch to the engine's encoding, e.g. when doing lane
+	 * complementing, operate on a partialy inverted state. */
+	if (ctx->eng->state_import)
+		ctx->eng->state_import(&ctx->st, &ctx->st);
+}
+
+void
+keccakf1600_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+		 size_t md_len, uint8_t delim_suffix)
+{
+	keccakp1600_init(ctx, eng, KECCAK1600_NUM_ROUNDS,
+			 KECCAK1600_STATE_SIZE - (2 * md_len), md_len,
+			 delim_suffix);
+}
+
+void
+keccakf1600_update(k1600_ctx_t *ctx, const void *msg, size_t msg_len)
+{
+	keccakf1600_absorb(ctx, msg, msg_len);
+}
+
+void
+keccakf1600_final(k1600_ctx_t *ctx, void *md)
+{
+	if (!ctx->squeezing)
+		keccakf1600_pad(ctx);
+	keccakf1600_squeeze(ctx, md, ctx->md_len);
+}
+
+void
+keccakf1600_xof_init(k1600_ctx_t *ctx, const k1600_engine_t *eng,
+		     size_t rate_bytes, uint8_t delim_suffix)
+{
+	keccakp1600_init(ctx, eng, KECCAK1600_NUM_ROUNDS, rate_bytes, 0,
+			 delim_suffix);
+}
+
+void
+keccakf1600_xof_squeeze(k1600_ctx_t *ctx, void *out, size_t out_len)
+{
+	if (!ctx->squeezing)
+		keccakf1600_pad(ctx);
+	keccakf1600_squeeze(ctx, out, out_len);
+}
+
+void
+keccakf1600_clone(k1600_ctx_t *dst, const k1600_ctx_t *src)
+{
+	memcpy(dst, src, sizeof(k1600_ctx_t));
+}
+
+void
+keccakp1600_oneshot(const k1600_engine_t *eng, unsigned int nr,
+		    size_t rate_bytes, const void *msg, size_t msg_len,
+		    void *md, size_t md_len, uint8_t delim_suffix)
+{
+	k1600_ctx_t ctx;
+
+	if (!eng)
+		eng = keccakf1600_get_default_engine();
+	if (nr != KECCAK1600_NUM_ROUNDS && !eng->permute_rounds)
+		eng = &keccakf1600_engine_ref;
+
+	if (!keccakf1600_fits_block(rate_bytes, msg_len, md_len,
+				    delim_suffix)) {
+		keccakp1600_init(&ctx, eng, nr, rate_bytes, md_len,
+				 delim_suffix);
+		keccakf1600_absorb(&ctx, msg, msg_len);
+		keccakf1600_pad(&ctx);
+		keccakf1600_squeeze(&ctx, md, md_len);
+		return;
+	}
+
+	/* Hash-based signatures (e.g. SPHINCS+ / XMSS) hash n = 32
+	 * byte values, or pairs of them, millions of times, Merkle
+	 * tree nodes are also pairs of 32 byte hashes */
+	if (msg_len == 32)
+		keccakf1600_oneshot_block(eng, nr, rate_bytes, msg, 32, md,
+					  md_len, delim_suffix);
+	else if (msg_len == 64)
+		keccakf1600_oneshot_block(eng, nr, rate_bytes, msg, 64, md,
+					  md_len, delim_suffix);
 	else
-		use_lc = false;
+		keccakf1600_oneshot_block(eng, nr, rate_bytes, msg, msg_len,
+					  md, md_len, delim_suffix);
+}
+
+void
+keccakf1600_oneshot_eng(const k1600_engine_t *eng, const void *msg,
+			size_t msg_len, void *md, size_t md_len,
+			uint8_t delim_suffix)
+{
+	keccakp1600_oneshot(eng, KECCAK1600_NUM_ROUNDS,
+			    KECCAK1600_STATE_SIZE - (2 * md_len), msg, msg_len,
+			    md, md_len, delim_suffix);
 }
 
 void
 keccakf1600_oneshot(const void *msg, size_t msg_len, void *md,
 		    size_t md_len, uint8_t delim_suffix)
 {
-	k1600_state_t st = { 0 };
+	keccakf1600_oneshot_eng(NULL, msg, msg_len, md, md_len, delim_suffix);
+}
 
-	/* When doing lane complementing, operate on a
-	 * partialy inverted state. */
-	if (use_lc) {
-		st.A[1] = ~0ULL;
-		st.A[2] = ~0ULL;
-		st.A[8] = ~0ULL;
-		st.A[12] = ~0ULL;
-		st.A[17] = ~0ULL;
-		st.A[20] = ~0ULL;
-	}
-	keccakf1600_absorb(&st, msg, msg_len, md_len, delim_suffix);
-	keccakf1600_squeeze(&st, md, md_len);
+void
+keccakp1600_oneshot_mb(const k1600_mb_engine_t *eng, unsigned int nr,
+		       size_t rate_bytes, const void *const msgs[],
+		       size_t msg_len, void *const mds[], size_t md_len,
+		       uint8_t delim_suffix)
+{
+	k1600_mb_ctx_t ctx;
+
+	keccakp1600_mb_init(&ctx, eng, nr, rate_bytes, md_len, delim_suffix);
+	keccakf1600_absorb_mb(&ctx, msgs, msg_len);
+	keccakf1600_pad_mb(&ctx);
+	keccakf1600_squeeze_mb(&ctx, mds, md_len);
+}
+
+void
+keccakf1600_oneshot_mb(const k1600_mb_engine_t *eng,
+		       const void *const msgs[], size_t msg_len,
+		       void *const mds[], size_t md_len,
+		       uint8_t delim_suffix)
+{
+	keccakp1600_oneshot_mb(eng, KECCAK1600_NUM_ROUNDS,
+			       KECCAK1600_STATE_SIZE - (2 * md_len),
+			       msgs, msg_len, mds, md_len, delim_suffix);
+}
+
+k1600_mb_ctx_t *
+keccakf1600_mb_ctx_new(void)
+{
+	/* The size is a multiple of the alignment */
+	return aligned_alloc(__alignof__(k1600_mb_ctx_t),
+			     sizeof(k1600_mb_ctx_t));
+}
+
+void
+keccakf1600_mb_ctx_free(k1600_mb_ctx_t *ctx)
+{
+	free(ctx);
+}
+
+void
+keccakp1600_mb_init(k1600_mb_ctx_t *ctx, const k1600_mb_engine_t *eng,
+		    unsigned int nr, size_t rate_bytes, size_t md_len,
+		    uint8_t delim_suffix)
+{
+	/* Only clear the lanes we'll use */
+	memset(ctx->A, 0, KECCAK_NUM_LANES * eng->ways * sizeof(lane_t));
+	ctx->eng = eng;
+	ctx->rate_bytes = rate_bytes;
+	ctx->md_len = md_len;
+	ctx->block_off = 0;
+	ctx->rounds = nr;
+	ctx->squeezing = 0;
+	ctx->delim_suffix = delim_suffix;
+}
+
+void
+keccakf1600_mb_update(k1600_mb_ctx_t *ctx, const void *const msgs[],
+		      size_t msg_len)
+{
+	keccakf1600_absorb_mb(ctx, msgs, msg_len);
+}
+
+void
+keccakf1600_mb_final(k1600_mb_ctx_t *ctx, void *const mds[])
+{
+	if (!ctx->squeezing)
+		keccakf1600_pad_mb(ctx);
+	keccakf1600_squeeze_mb(ctx, mds, ctx->md_len);
+}
+
+void
+keccakf1600_mb_xof_squeeze(k1600_mb_ctx_t *ctx, void *const outs[],
+			   size_t out_len)
+{
+	if (!ctx->squeezing)
+		keccakf1600_pad_mb(ctx);
+	keccakf1600_squeeze_mb(ctx, outs, out_len);
 }
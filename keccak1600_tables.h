@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Step mapping tables
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _KECCAK1600_TABLES_H
+#define _KECCAK1600_TABLES_H
+
+#include "keccak1600.h"
+
+/*
+ * Those are the tables used by keccak1600_ref.c, see there for
+ * how they come up, they are also used by the permutation template
+ * (keccak1600_template.h) to generate the unrolled variants.
+ */
+
+/* Pi mapping, in the order we follow it (excluding lane 0) */
+static const uint_fast8_t keccak1600_pi_lane_idxes[KECCAK_NUM_LANES - 1] =
+	{ 10,  7, 11, 17, 18,
+	   3,  5, 16,  8, 21,
+	  24,  4, 15, 23, 19,
+	  13, 12,  2, 20, 14,
+	  22,  9,  6,  1};
+
+/* Rho offsets for each step of the above */
+static const uint_fast8_t keccak1600_rho_pi_offsets[KECCAK_NUM_LANES - 1] =
+	{ 1,  3,  6, 10, 15,
+	 21, 28, 36, 45, 55,
+	  2, 14, 27, 41, 56,
+	  8, 25, 43, 62, 18,
+	 39, 61, 20, 44};
+
+/* Rho offsets for each lane of A, for when we don't follow the pi
+ * mapping (same as the ones above, on the pi mapping's source lanes) */
+static const uint_fast8_t keccak1600_rho_offsets[KECCAK_NUM_LANES] =
+	{  0,  1, 62, 28, 27,
+	  36, 44,  6, 55, 20,
+	   3, 10, 43, 25, 39,
+	  41, 45, 15, 21,  8,
+	  18,  2, 61, 56, 14 };
+
+static const lane_t keccak1600_round_constants[KECCAK1600_NUM_ROUNDS] =
+	{ 0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL,
+	  0x8000000080008000ULL, 0x000000000000808bULL, 0x0000000080000001ULL,
+	  0x8000000080008081ULL, 0x8000000000008009ULL, 0x000000000000008aULL,
+	  0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+	  0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL,
+	  0x8000000000008003ULL, 0x8000000000008002ULL, 0x8000000000000080ULL,
+	  0x000000000000800aULL, 0x800000008000000aULL, 0x8000000080008081ULL,
+	  0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL };
+
+/*
+ * Chi with lane complementing, for each output lane x of a plane
+ * it's a ^ (b op c), with a = lane x, b = lane x + 1, c = lane x + 2,
+ * where op is either AND or OR and any of a, b, c may be inverted.
+ * That's the same as in keccak1600_intermediateur_lc.c, (e.g. for
+ * lane 1 it's T[1] ^ (~T[2] | T[3]) -> KECCAK1600_LC_OR | KECCAK1600_LC_NOT_B).
+ */
+#define KECCAK1600_LC_OR	(1 << 0)
+#define KECCAK1600_LC_NOT_A	(1 << 1)
+#define KECCAK1600_LC_NOT_B	(1 << 2)
+#define KECCAK1600_LC_NOT_C	(1 << 3)
+
+static const uint_fast8_t keccak1600_lc_chi[KECCAK_NUM_LANES] =
+	{ KECCAK1600_LC_OR, KECCAK1600_LC_OR | KECCAK1600_LC_NOT_B, 0,
+	  KECCAK1600_LC_OR, 0,
+	  KECCAK1600_LC_OR, 0, KECCAK1600_LC_OR | KECCAK1600_LC_NOT_C,
+	  KECCAK1600_LC_OR, 0,
+	  KECCAK1600_LC_OR, 0, KECCAK1600_LC_NOT_B,
+	  KECCAK1600_LC_OR | KECCAK1600_LC_NOT_A, 0,
+	  0, KECCAK1600_LC_OR, KECCAK1600_LC_OR | KECCAK1600_LC_NOT_B,
+	  KECCAK1600_LC_NOT_A, KECCAK1600_LC_OR,
+	  KECCAK1600_LC_NOT_B, KECCAK1600_LC_OR | KECCAK1600_LC_NOT_A, 0,
+	  KECCAK1600_LC_OR, 0 };
+
+#endif /* _KECCAK1600_TABLES_H */
@@ -0,0 +1,132 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - Template generated permutations
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+
+/*
+ * Variants generated from keccak1600_template.h, the first ones are
+ * the same as the hand-written implementations, so that we can check
+ * the template against them on bench and make sure they're on par.
+ * The rest are combinations we don't have a hand-written version of,
+ * to add a new one just pick a name and the strategy, add it to
+ * keccak1600.h and keccak1600_engines.c and it'll show up on
+ * sha3_bench / sha3_kat.
+ */
+
+/* Operations on lanes, those work for both lane_t and vectors
+ * of lanes (using the compiler's vector extensions). TPL_ROTL
+ * is the same as rotl_lane, it's a macro to avoid passing vectors
+ * around as function arguments, it's never called with 0. */
+#define TPL_XOR(_a, _b)			((_a) ^ (_b))
+#define TPL_AND(_a, _b)			((_a) & (_b))
+#define TPL_OR(_a, _b)			((_a) | (_b))
+#define TPL_NOT(_a)			(~(_a))
+#define TPL_ANDN(_a, _b)		(~(_a) & (_b))
+#define TPL_ROTL(_val, _times)		(((_val) << (_times)) | \
+					 ((_val) >> (KECCAK1600_LANE_BITS - (_times))))
+#define TPL_IOTA(_a, _r_idx)		((_a) ^ keccak1600_round_constants[_r_idx])
+
+#define KECCAK_TPL_ATTRS
+#define KECCAK_TPL_WAYS		1
+
+/* Same as keccak1600_inplaceur.c */
+#define KECCAK_TPL_NAME		tpl_inplace
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INPLACE
+#define KECCAK_TPL_EARLY_PARITY	0
+#define KECCAK_TPL_LC		0
+#define KECCAK_TPL_UNROLL	1
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+/* Same as keccak1600_intermediateur.c */
+#define KECCAK_TPL_NAME		tpl_intermediate
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	0
+#define KECCAK_TPL_LC		0
+#define KECCAK_TPL_UNROLL	2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+/* Same as keccak1600_intermediateur_ep.c */
+#define KECCAK_TPL_NAME		tpl_ep
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	1
+#define KECCAK_TPL_LC		0
+#define KECCAK_TPL_UNROLL	2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+/* Same as keccak1600_intermediateur_lc.c */
+#define KECCAK_TPL_NAME		tpl_lc
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	0
+#define KECCAK_TPL_LC		1
+#define KECCAK_TPL_UNROLL	2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+/* Early parity together with lane complementing */
+#define KECCAK_TPL_NAME		tpl_ep_lc
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	1
+#define KECCAK_TPL_LC		1
+#define KECCAK_TPL_UNROLL	2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+/* In-place with lane complementing, two rounds per iteration */
+#define KECCAK_TPL_NAME		tpl_inplace_lc
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INPLACE
+#define KECCAK_TPL_EARLY_PARITY	0
+#define KECCAK_TPL_LC		1
+#define KECCAK_TPL_UNROLL	2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_LAYOUT
+#undef KECCAK_TPL_EARLY_PARITY
+#undef KECCAK_TPL_LC
+#undef KECCAK_TPL_UNROLL
+
+#undef KECCAK_TPL_WAYS
+
+/* Multi-buffer, same as keccak1600_intermediateur_mb.c
+ * but with early parity */
+#define KECCAK_TPL_LAYOUT	KECCAK_TPL_INTERMEDIATE
+#define KECCAK_TPL_EARLY_PARITY	1
+#define KECCAK_TPL_LC		0
+#define KECCAK_TPL_UNROLL	2
+
+#define KECCAK_TPL_NAME		tpl_ep_x2
+#define KECCAK_TPL_WAYS		2
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_WAYS
+
+#define KECCAK_TPL_NAME		tpl_ep_x4
+#define KECCAK_TPL_WAYS		4
+#include "keccak1600_template.h"
+#undef KECCAK_TPL_NAME
+#undef KECCAK_TPL_WAYS
@@ -0,0 +1,272 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Keccak-f[1600] C Implementation - State permutation template
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+/*
+ * Instead of hand-unrolling yet another copy of the round, this
+ * generates it from the tables in keccak1600_tables.h (the same ones
+ * keccak1600_ref.c uses). All loops below are over constants and get
+ * fully unrolled, so after constant propagation the table lookups
+ * go away and we get the same straight-line code as the hand-written
+ * implementations. It's included once for each variant, with the
+ * following set by the includer:
+ *
+ * KECCAK_TPL_NAME -> The variant's name, the permutation functions are
+ *		      keccakf1600_state_permute_<name> and
+ *		      keccakp1600_state_permute_<name>
+ * KECCAK_TPL_LAYOUT -> KECCAK_TPL_INPLACE to apply each round on the
+ *		      state itself (following the pi mapping as in
+ *		      keccak1600_ref.c), or KECCAK_TPL_INTERMEDIATE to go
+ *		      from the state to an intermediate one and back
+ * KECCAK_TPL_EARLY_PARITY -> Compute the column parity for the next
+ *		      round as planes become available, see
+ *		      keccak1600_intermediateur_ep.c
+ * KECCAK_TPL_LC -> Use lane complementing on chi, see
+ *		      keccak1600_intermediateur_lc.c, the engine
+ *		      descriptor needs .lc set
+ * KECCAK_TPL_UNROLL -> Rounds per loop iteration (1 or 2), for the
+ *		      intermediate layout 2 means we don't copy the
+ *		      intermediate state back on each round
+ * KECCAK_TPL_WAYS -> Number of interleaved states, when more than 1
+ *		      the functions take a lane_t pointer like the
+ *		      multi-buffer ones do (lane i of state j at
+ *		      A[i * ways + j])
+ * KECCAK_TPL_LANE_T (optional) -> The type of each lane, by default it's
+ *		      lane_t for a single state, or a vector of
+ *		      KECCAK_TPL_WAYS lanes using the compiler's vector
+ *		      extensions
+ * KECCAK_TPL_ATTRS -> Extra function attributes (e.g. target ISA)
+ * KECCAK_TPL_INTERNAL (optional) -> Don't emit the entry points, only
+ *		      keccakf1600_permute_<name>(tpl_lane_t *A, nr), for
+ *		      when the includer needs to convert the state first
+ *		      (e.g. keccak1600_bi32.c)
+ * TPL_XOR, TPL_AND, TPL_OR, TPL_NOT, TPL_ANDN, TPL_ROTL, TPL_IOTA ->
+ *		      The operations used by the round, see
+ *		      keccak1600_template.c
+ */
+
+#include "keccak1600_tables.h"
+
+#ifndef KECCAK_TPL_INPLACE
+#define KECCAK_TPL_INPLACE		1
+#define KECCAK_TPL_INTERMEDIATE		2
+#endif
+
+#define TPL_CONCAT_(_a, _b)	_a##_b
+#define TPL_CONCAT(_a, _b)	TPL_CONCAT_(_a, _b)
+#define TPL_SYM(_name)		TPL_CONCAT(_name, KECCAK_TPL_NAME)
+
+#define TPL_UNROLL		_Pragma("GCC unroll 25")
+
+#if KECCAK_TPL_WAYS > 1
+#define TPL_STATE_T		lane_t
+#define TPL_STATE_LANES(_st)	(_st)
+#else
+#define TPL_STATE_T		k1600_state_t
+#define TPL_STATE_LANES(_st)	((_st)->A)
+#endif
+
+#ifdef KECCAK_TPL_LANE_T
+#define tpl_lane_t		KECCAK_TPL_LANE_T
+#elif KECCAK_TPL_WAYS > 1
+/* Same as in keccak1600_intermediateur_mb.h */
+typedef lane_t TPL_SYM(tpl_lane_) __attribute__((
+	vector_size(KECCAK_TPL_WAYS * KECCAK1600_LANE_BYTES),
+	aligned(KECCAK1600_LANE_BYTES)));
+
+#define tpl_lane_t		TPL_SYM(tpl_lane_)
+#else
+#define tpl_lane_t		lane_t
+#endif
+
+/* Compute parity of columns */
+static inline __attribute__((always_inline)) KECCAK_TPL_ATTRS void
+TPL_SYM(keccakf1600_parity_)(const tpl_lane_t *A, tpl_lane_t *C)
+{
+	int x = 0;
+
+	TPL_UNROLL
+	for (x = 0; x < KECCAK_NUM_COLS; x++)
+		C[x] = TPL_XOR(TPL_XOR(TPL_XOR(TPL_XOR(A[x], A[x + 5]),
+				A[x + 10]), A[x + 15]), A[x + 20]);
+}
+
+/*
+ * A single round from A to N (for the in-place layout N is A), with C
+ * holding the parity of A's columns when using early parity, in which
+ * case it gets updated with the parity of N's columns.
+ */
+static inline __attribute__((always_inline)) KECCAK_TPL_ATTRS void
+TPL_SYM(keccakf1600_round_)(tpl_lane_t *A, tpl_lane_t *N, tpl_lane_t *C,
+			    int r_idx)
+{
+	tpl_lane_t D[KECCAK_NUM_COLS];
+	tpl_lane_t T[KECCAK_NUM_COLS];
+	tpl_lane_t a, b, c;
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INPLACE
+	tpl_lane_t first;
+#endif
+	int x = 0;
+	int y = 0;
+	int i = 0;
+
+#if !KECCAK_TPL_EARLY_PARITY
+	TPL_SYM(keccakf1600_parity_)(A, C);
+#endif
+
+	/* Compute theta for each column */
+	TPL_UNROLL
+	for (x = 0; x < KECCAK_NUM_COLS; x++)
+		D[x] = TPL_XOR(C[(x + 4) % 5], TPL_ROTL(C[(x + 1) % 5], 1));
+
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INPLACE
+	/* Apply theta-rho-pi following the pi mapping
+	 * backwards, same as rho_pi in keccak1600_ref.c */
+	first = TPL_XOR(A[1], D[1]);
+	TPL_UNROLL
+	for (i = KECCAK_NUM_LANES - 2; i > 0; i--)
+		A[keccak1600_pi_lane_idxes[i]] =
+			TPL_ROTL(TPL_XOR(A[keccak1600_pi_lane_idxes[i - 1]],
+					 D[keccak1600_pi_lane_idxes[i - 1] % 5]),
+				 keccak1600_rho_pi_offsets[i]);
+	A[keccak1600_pi_lane_idxes[0]] = TPL_ROTL(first,
+						  keccak1600_rho_pi_offsets[0]);
+	A[0] = TPL_XOR(A[0], D[0]);
+#endif
+
+	TPL_UNROLL
+	for (y = 0; y < KECCAK_NUM_ROWS; y++) {
+		TPL_UNROLL
+		for (x = 0; x < KECCAK_NUM_COLS; x++) {
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INPLACE
+			T[x] = A[x + 5 * y];
+#else
+			/* Apply theta-rho-pi, lane x of plane y
+			 * comes from lane (x + 3y) % 5 of plane x */
+			i = (x + 3 * y) % 5 + 5 * x;
+			T[x] = TPL_XOR(A[i], D[i % 5]);
+			if (keccak1600_rho_offsets[i])
+				T[x] = TPL_ROTL(T[x], keccak1600_rho_offsets[i]);
+#endif
+		}
+
+		/* Apply chi */
+		TPL_UNROLL
+		for (x = 0; x < KECCAK_NUM_COLS; x++) {
+			a = T[x];
+			b = T[(x + 1) % 5];
+			c = T[(x + 2) % 5];
+#if KECCAK_TPL_LC
+			i = x + 5 * y;
+			if (keccak1600_lc_chi[i] & KECCAK1600_LC_NOT_A)
+				a = TPL_NOT(a);
+			if (keccak1600_lc_chi[i] & KECCAK1600_LC_NOT_B)
+				b = TPL_NOT(b);
+			if (keccak1600_lc_chi[i] & KECCAK1600_LC_NOT_C)
+				c = TPL_NOT(c);
+			if (keccak1600_lc_chi[i] & KECCAK1600_LC_OR)
+				N[i] = TPL_XOR(a, TPL_OR(b, c));
+			else
+				N[i] = TPL_XOR(a, TPL_AND(b, c));
+#else
+			N[x + 5 * y] = TPL_XOR(a, TPL_ANDN(b, c));
+#endif
+		}
+
+		/* Also apply iota since we are here */
+		if (y == 0)
+			N[0] = TPL_IOTA(N[0], r_idx);
+
+#if KECCAK_TPL_EARLY_PARITY
+		/* Update C */
+		TPL_UNROLL
+		for (x = 0; x < KECCAK_NUM_COLS; x++) {
+			if (y == 0)
+				C[x] = N[x];
+			else
+				C[x] = TPL_XOR(C[x], N[x + 5 * y]);
+		}
+#endif
+	}
+}
+
+/* Single round on A, for the intermediate layout
+ * copy the result back from N (for the in-place
+ * one N is A) */
+static inline __attribute__((always_inline)) KECCAK_TPL_ATTRS void
+TPL_SYM(keccakf1600_round_step_)(tpl_lane_t *A, tpl_lane_t *N, tpl_lane_t *C,
+				 int r_idx)
+{
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INTERMEDIATE
+	int j = 0;
+#endif
+
+	TPL_SYM(keccakf1600_round_)(A, N, C, r_idx);
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INTERMEDIATE
+	for (j = 0; j < KECCAK_NUM_LANES; j++)
+		A[j] = N[j];
+#endif
+}
+
+static inline __attribute__((always_inline)) KECCAK_TPL_ATTRS void
+TPL_SYM(keccakf1600_permute_)(tpl_lane_t *A, unsigned int nr)
+{
+#if KECCAK_TPL_LAYOUT == KECCAK_TPL_INTERMEDIATE
+	tpl_lane_t N_buf[KECCAK_NUM_LANES];
+	tpl_lane_t *N = N_buf;
+#else
+	tpl_lane_t *N = A;
+#endif
+	tpl_lane_t C[KECCAK_NUM_COLS];
+	int i = KECCAK1600_NUM_ROUNDS - nr;
+
+#if KECCAK_TPL_EARLY_PARITY
+	/* Only the first round needs this, the rest get it from
+	 * the previous round (the last one also updates C for
+	 * nothing, but that's cheaper than another copy of the
+	 * round just for that) */
+	TPL_SYM(keccakf1600_parity_)(A, C);
+#endif
+
+#if KECCAK_TPL_UNROLL == 2
+	/* Rounds go in pairs so that we end up with the
+	 * result on A, for an odd number of rounds do
+	 * the first one separately */
+	if (nr & 1)
+		TPL_SYM(keccakf1600_round_step_)(A, N, C, i++);
+
+	for (; i < KECCAK1600_NUM_ROUNDS; i += 2) {
+		TPL_SYM(keccakf1600_round_)(A, N, C, i);
+		TPL_SYM(keccakf1600_round_)(N, A, C, i + 1);
+	}
+#else
+	for (; i < KECCAK1600_NUM_ROUNDS; i++)
+		TPL_SYM(keccakf1600_round_step_)(A, N, C, i);
+#endif
+}
+
+#ifndef KECCAK_TPL_INTERNAL
+/* Keccak-p[1600, nr], the last nr rounds of Keccak-f[1600] */
+KECCAK_TPL_ATTRS void
+TPL_SYM(keccakp1600_state_permute_)(TPL_STATE_T *st, unsigned int nr)
+{
+	TPL_SYM(keccakf1600_permute_)((tpl_lane_t *) TPL_STATE_LANES(st), nr);
+}
+
+KECCAK_TPL_ATTRS void
+TPL_SYM(keccakf1600_state_permute_)(TPL_STATE_T *st)
+{
+	TPL_SYM(keccakf1600_permute_)((tpl_lane_t *) TPL_STATE_LANES(st),
+				      KECCAK1600_NUM_ROUNDS);
+}
+#endif
+
+#undef tpl_lane_t
+#undef TPL_STATE_LANES
+#undef TPL_STATE_T
+#undef TPL_UNROLL
+#undef TPL_SYM
+#undef TPL_CONCAT
+#undef TPL_CONCAT_
@@ -0,0 +1,219 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * cSHAKE / KMAC C Implementation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+#include "kmac.h"
+
+#define CSHAKE128_RATE		168
+#define CSHAKE256_RATE		136
+
+/* Domain separation, cSHAKE appends 00 to the message (SHAKE's
+ * 1111 when N and S are empty) */
+#define CSHAKE_DELIM		0x04
+#define SHAKE_DELIM		0x1F
+
+static const uint8_t kmac_name[4] = { 'K', 'M', 'A', 'C' };
+static const uint8_t sp800_185_zeroes[CSHAKE128_RATE] = { 0 };
+
+
+/*********\
+* HELPERS *
+\*********/
+
+/* Big endian encoding of x with no leading zeroes (but at least
+ * one byte), left_encode puts the number of bytes used before it
+ * and right_encode after it */
+static size_t
+sp800_185_encode(uint64_t x, uint8_t *out, int left)
+{
+	size_t len = 0;
+	size_t i = 0;
+	uint64_t tmp = 0;
+
+	for (tmp = x, len = 1; tmp > 0xFF; tmp >>= 8)
+		len++;
+
+	for (i = 0; i < len; i++)
+		out[i + left] = x >> (8 * (len - i - 1));
+	out[left ? 0 : len] = len;
+
+	return len + 1;
+}
+
+/* Absorb encode_string(str), returns the number of bytes absorbed */
+static size_t
+sp800_185_encode_string(k1600_ctx_t *ctx, const void *str, size_t len)
+{
+	uint8_t enc[9] = { 0 };
+	size_t enc_len = 0;
+
+	enc_len = sp800_185_encode((uint64_t) len * 8, enc, 1);
+	keccakf1600_update(ctx, enc, enc_len);
+	keccakf1600_update(ctx, str, len);
+
+	return enc_len + len;
+}
+
+/* Complete bytepad() after absorbed bytes */
+static void
+sp800_185_bytepad_end(k1600_ctx_t *ctx, size_t absorbed)
+{
+	size_t rem = absorbed % ctx->rate_bytes;
+
+	if (rem)
+		keccakf1600_update(ctx, sp800_185_zeroes,
+				   ctx->rate_bytes - rem);
+}
+
+/* Absorb left_encode(rate), the start of bytepad() */
+static size_t
+sp800_185_bytepad_start(k1600_ctx_t *ctx)
+{
+	uint8_t enc[9] = { 0 };
+	size_t enc_len = 0;
+
+	enc_len = sp800_185_encode(ctx->rate_bytes, enc, 1);
+	keccakf1600_update(ctx, enc, enc_len);
+
+	return enc_len;
+}
+
+static void
+cshake_init(k1600_ctx_t *ctx, size_t rate_bytes, const void *name,
+	    size_t name_len, const void *custom, size_t custom_len)
+{
+	size_t absorbed = 0;
+
+	if (!name_len && !custom_len) {
+		keccakf1600_xof_init(ctx, NULL, rate_bytes, SHAKE_DELIM);
+		return;
+	}
+
+	/* bytepad(encode_string(N) || encode_string(S), rate) */
+	keccakf1600_xof_init(ctx, NULL, rate_bytes, CSHAKE_DELIM);
+	absorbed = sp800_185_bytepad_start(ctx);
+	absorbed += sp800_185_encode_string(ctx, name, name_len);
+	absorbed += sp800_185_encode_string(ctx, custom, custom_len);
+	sp800_185_bytepad_end(ctx, absorbed);
+}
+
+static void
+kmac_init(k1600_ctx_t *ctx, size_t rate_bytes, const void *key,
+	  size_t key_len, const void *custom, size_t custom_len)
+{
+	size_t absorbed = 0;
+
+	cshake_init(ctx, rate_bytes, kmac_name, sizeof(kmac_name),
+		    custom, custom_len);
+
+	/* bytepad(encode_string(K), rate) */
+	absorbed = sp800_185_bytepad_start(ctx);
+	absorbed += sp800_185_encode_string(ctx, key, key_len);
+	sp800_185_bytepad_end(ctx, absorbed);
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+void
+cshake128_init(k1600_ctx_t *ctx, const void *name, size_t name_len,
+	       const void *custom, size_t custom_len)
+{
+	cshake_init(ctx, CSHAKE128_RATE, name, name_len, custom, custom_len);
+}
+
+void
+cshake256_init(k1600_ctx_t *ctx, const void *name, size_t name_len,
+	       const void *custom, size_t custom_len)
+{
+	cshake_init(ctx, CSHAKE256_RATE, name, name_len, custom, custom_len);
+}
+
+void
+cshake128_oneshot(const void *msg, size_t msg_len, const void *name,
+		  size_t name_len, const void *custom, size_t custom_len,
+		  void *out, size_t out_len)
+{
+	k1600_ctx_t ctx;
+
+	cshake128_init(&ctx, name, name_len, custom, custom_len);
+	keccakf1600_update(&ctx, msg, msg_len);
+	keccakf1600_xof_squeeze(&ctx, out, out_len);
+}
+
+void
+cshake256_oneshot(const void *msg, size_t msg_len, const void *name,
+		  size_t name_len, const void *custom, size_t custom_len,
+		  void *out, size_t out_len)
+{
+	k1600_ctx_t ctx;
+
+	cshake256_init(&ctx, name, name_len, custom, custom_len);
+	keccakf1600_update(&ctx, msg, msg_len);
+	keccakf1600_xof_squeeze(&ctx, out, out_len);
+}
+
+void
+kmac128_init(k1600_ctx_t *ctx, const void *key, size_t key_len,
+	     const void *custom, size_t custom_len)
+{
+	kmac_init(ctx, CSHAKE128_RATE, key, key_len, custom, custom_len);
+}
+
+void
+kmac256_init(k1600_ctx_t *ctx, const void *key, size_t key_len,
+	     const void *custom, size_t custom_len)
+{
+	kmac_init(ctx, CSHAKE256_RATE, key, key_len, custom, custom_len);
+}
+
+void
+kmac_final(k1600_ctx_t *ctx, void *mac, size_t mac_len)
+{
+	uint8_t enc[9] = { 0 };
+	size_t enc_len = 0;
+
+	enc_len = sp800_185_encode((uint64_t) mac_len * 8, enc, 0);
+	keccakf1600_update(ctx, enc, enc_len);
+	keccakf1600_xof_squeeze(ctx, mac, mac_len);
+}
+
+void
+kmac_xof_squeeze(k1600_ctx_t *ctx, void *out, size_t out_len)
+{
+	/* right_encode(0) before the first squeeze */
+	static const uint8_t enc[2] = { 0x00, 0x01 };
+
+	if (!ctx->squeezing)
+		keccakf1600_update(ctx, enc, sizeof(enc));
+	keccakf1600_xof_squeeze(ctx, out, out_len);
+}
+
+void
+kmac128_oneshot(const void *key, size_t key_len, const void *msg,
+		size_t msg_len, const void *custom, size_t custom_len,
+		void *mac, size_t mac_len)
+{
+	k1600_ctx_t ctx;
+
+	kmac128_init(&ctx, key, key_len, custom, custom_len);
+	keccakf1600_update(&ctx, msg, msg_len);
+	kmac_final(&ctx, mac, mac_len);
+}
+
+void
+kmac256_oneshot(const void *key, size_t key_len, const void *msg,
+		size_t msg_len, const void *custom, size_t custom_len,
+		void *mac, size_t mac_len)
+{
+	k1600_ctx_t ctx;
+
+	kmac256_init(&ctx, key, key_len, custom, custom_len);
+	keccakf1600_update(&ctx, msg, msg_len);
+	kmac_final(&ctx, mac, mac_len);
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * cSHAKE / KMAC C Implementation
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _KMAC_H
+#define _KMAC_H
+
+/*
+ * cSHAKE and KMAC from NIST SP 800-185. cSHAKE is SHAKE with a
+ * function name (N) and a customization string (S) absorbed first,
+ * padded to a full block, and KMAC is cSHAKE with N = "KMAC" and
+ * the key absorbed on the next block(s). Since those prefixes only
+ * depend on N / S / the key, init does them once and the context
+ * can then be cloned (keccakf1600_clone) for each message, so the
+ * prefix permutations aren't repeated.
+ */
+
+#include "keccak1600.h"
+
+/* With both N and S empty this is the same as SHAKE, output
+ * is squeezed with keccakf1600_xof_squeeze() */
+void cshake128_init(k1600_ctx_t *ctx, const void *name, size_t name_len,
+		    const void *custom, size_t custom_len);
+void cshake256_init(k1600_ctx_t *ctx, const void *name, size_t name_len,
+		    const void *custom, size_t custom_len);
+void cshake128_oneshot(const void *msg, size_t msg_len, const void *name,
+		       size_t name_len, const void *custom, size_t custom_len,
+		       void *out, size_t out_len);
+void cshake256_oneshot(const void *msg, size_t msg_len, const void *name,
+		       size_t name_len, const void *custom, size_t custom_len,
+		       void *out, size_t out_len);
+
+/* The message goes through keccakf1600_update(), final produces
+ * a MAC of mac_len bytes (the length is part of the input, so a
+ * shorter MAC isn't a prefix of a longer one). For KMACXOF use
+ * kmac_xof_squeeze() instead, it can be called repeatedly. */
+void kmac128_init(k1600_ctx_t *ctx, const void *key, size_t key_len,
+		  const void *custom, size_t custom_len);
+void kmac256_init(k1600_ctx_t *ctx, const void *key, size_t key_len,
+		  const void *custom, size_t custom_len);
+void kmac_final(k1600_ctx_t *ctx, void *mac, size_t mac_len);
+void kmac_xof_squeeze(k1600_ctx_t *ctx, void *out, size_t out_len);
+void kmac128_oneshot(const void *key, size_t key_len, const void *msg,
+		     size_t msg_len, const void *custom, size_t custom_len,
+		     void *mac, size_t mac_len);
+void kmac256_oneshot(const void *key, size_t key_len, const void *msg,
+		     size_t msg_len, const void *custom, size_t custom_len,
+		     void *mac, size_t mac_len);
+
+#endif /* _KMAC_H */
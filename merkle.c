@@ -0,0 +1,316 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3-256 Merkle tree
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "keccak1600.h"
+#include "sha3.h"
+#include "merkle.h"
+#include "sha3_pool.h"
+#include <stdlib.h>	/* For aligned_alloc() / free() */
+#include <string.h>	/* For memcpy() / memset() */
+
+/* Enough for a level count that fits in a size_t */
+#define MERKLE_MAX_LEVELS	(8 * sizeof(size_t) + 1)
+/* Leaves / nodes handed out to each thread at a time, leaf groups
+ * go through sha3_256_batch() so they should have enough messages
+ * of the same length to fill the multi-buffer engines */
+#define MERKLE_LEAF_GROUP	64
+#define MERKLE_NODE_GROUP	512
+
+/*
+ * A node's input is its two children, 64 bytes, so it fits in a single
+ * SHA3-256 block (136 bytes / 17 lanes) and the padded block is known
+ * in advance: 8 lanes of input, the domain separation bits with the
+ * first padding bit on the lane after that, and the last padding bit
+ * on the top byte of the last rate lane. The rest is zero.
+ *
+ * Leaves are plain SHA3-256 (suffix bits 01), nodes use the same
+ * sponge with suffix bits 11 instead, so that a 64 byte chunk
+ * never hashes to the same leaf as the node over the same bytes.
+ */
+#define MERKLE_NODE_LEN		(2 * MERKLE_HASH_LEN)
+#define MERKLE_NODE_LANES	(MERKLE_NODE_LEN / KECCAK1600_LANE_BYTES)
+#define MERKLE_HASH_LANES	(MERKLE_HASH_LEN / KECCAK1600_LANE_BYTES)
+#define MERKLE_RATE_LANES	17
+#define MERKLE_DELIM		0x07
+#define MERKLE_PAD_FIRST	((lane_t) MERKLE_DELIM)
+#define MERKLE_PAD_LAST		(0x80ULL << 56)
+
+struct merkle_tree {
+	/* Level l starts at nodes[level_off[l]] */
+	uint8_t (*nodes)[MERKLE_HASH_LEN];
+	size_t level_off[MERKLE_MAX_LEVELS];
+	size_t level_len[MERKLE_MAX_LEVELS];
+	unsigned int num_levels;
+};
+
+/* Hashing work for one level, shared between the pool's workers */
+struct merkle_job {
+	merkle_tree_t *tree;
+	const void *const *chunks;
+	const size_t *lens;
+	unsigned int level;
+	size_t num_groups;
+	size_t group_len;
+	const k1600_engine_t *eng;
+	/* Multi-buffer engine to use for each number of ways */
+	const k1600_mb_engine_t *mb_eng[KECCAK1600_MAX_WAYS + 1];
+};
+
+
+/**************\
+* NODE HASHING *
+\**************/
+
+static void
+merkle_hash_node(const k1600_engine_t *eng, const uint8_t *in, uint8_t *out)
+{
+	keccakp1600_oneshot(eng, KECCAK1600_NUM_ROUNDS, MERKLE_RATE_LANES *
+			    KECCAK1600_LANE_BYTES, in, MERKLE_NODE_LEN, out,
+			    MERKLE_HASH_LEN, MERKLE_DELIM);
+}
+
+/* Same for eng->ways consecutive nodes, the single state one
+ * goes through the sponge's single block path, this one builds
+ * the padded blocks straight on the interleaved state */
+static void
+merkle_hash_node_mb(const k1600_mb_engine_t *eng, const uint8_t *in,
+		    uint8_t *out)
+{
+	lane_t A[KECCAK_NUM_LANES * KECCAK1600_MAX_WAYS]
+		__attribute__((aligned(64)));
+	unsigned int ways = eng->ways;
+	unsigned int i = 0;
+	unsigned int j = 0;
+
+	memset(A, 0, KECCAK_NUM_LANES * ways * sizeof(lane_t));
+	for (i = 0; i < MERKLE_NODE_LANES; i++)
+		for (j = 0; j < ways; j++)
+			A[i * ways + j] = load_lane(in + j * MERKLE_NODE_LEN +
+						    i * KECCAK1600_LANE_BYTES);
+	for (j = 0; j < ways; j++) {
+		A[MERKLE_NODE_LANES * ways + j] = MERKLE_PAD_FIRST;
+		A[(MERKLE_RATE_LANES - 1) * ways + j] = MERKLE_PAD_LAST;
+	}
+
+	eng->permute(A);
+
+	for (j = 0; j < ways; j++)
+		for (i = 0; i < MERKLE_HASH_LANES; i++)
+			store_lane(out + j * MERKLE_HASH_LEN +
+				   i * KECCAK1600_LANE_BYTES, A[i * ways + j]);
+}
+
+/* Hash count nodes whose children are consecutive on in, through
+ * the widest multi-buffer engine that fits and the default engine
+ * for what's left */
+static void
+merkle_hash_nodes(const struct merkle_job *job, const uint8_t *in,
+		  uint8_t *out, size_t count)
+{
+	unsigned int ways = KECCAK1600_MAX_WAYS;
+
+	while (count > 0) {
+		while (ways > 1 && (count < ways || !job->mb_eng[ways]))
+			ways >>= 1;
+
+		if (ways == 1)
+			merkle_hash_node(job->eng, in, out);
+		else
+			merkle_hash_node_mb(job->mb_eng[ways], in, out);
+		in += ways * MERKLE_NODE_LEN;
+		out += ways * MERKLE_HASH_LEN;
+		count -= ways;
+	}
+}
+
+
+/***************\
+* LEVEL HASHING *
+\***************/
+
+/* Hash count nodes of the job's level starting from first,
+ * for the leaves that's hashing their chunks */
+static void
+merkle_hash_range(const struct merkle_job *job, size_t first, size_t count)
+{
+	const merkle_tree_t *tree = job->tree;
+	void *mds[MERKLE_LEAF_GROUP];
+	const uint8_t *in = NULL;
+	uint8_t *out = NULL;
+	unsigned int level = job->level;
+	size_t i = 0;
+
+	if (level == 0) {
+		for (i = 0; i < count; i++)
+			mds[i] = tree->nodes[first + i];
+		sha3_256_batch(job->chunks + first, job->lens + first, mds,
+			       count);
+		return;
+	}
+
+	in = tree->nodes[tree->level_off[level - 1] + 2 * first];
+	out = tree->nodes[tree->level_off[level] + first];
+
+	/* The last node of an odd level goes up as is */
+	if (first + count == tree->level_len[level] &&
+	    tree->level_len[level - 1] % 2) {
+		count--;
+		memcpy(out + count * MERKLE_HASH_LEN,
+		       in + count * MERKLE_NODE_LEN, MERKLE_HASH_LEN);
+	}
+
+	merkle_hash_nodes(job, in, out, count);
+}
+
+/* One group of the job's level, for the pool's workers */
+static void
+merkle_hash_group(void *arg, size_t group)
+{
+	const struct merkle_job *job = arg;
+	size_t first = group * job->group_len;
+	size_t count = job->tree->level_len[job->level] - first;
+
+	if (count > job->group_len)
+		count = job->group_len;
+	merkle_hash_range(job, first, count);
+}
+
+static void
+merkle_hash_level(struct merkle_job *job, unsigned int level,
+		  unsigned int nthreads)
+{
+	job->level = level;
+	job->group_len = level ? MERKLE_NODE_GROUP : MERKLE_LEAF_GROUP;
+	job->num_groups = (job->tree->level_len[level] + job->group_len - 1) /
+			  job->group_len;
+
+	sha3_pool_run(nthreads, job->num_groups, merkle_hash_group, job);
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+merkle_tree_t *
+merkle_new(size_t num_leaves)
+{
+	merkle_tree_t *tree = NULL;
+	size_t num_nodes = 0;
+	size_t alloc_len = 0;
+	size_t len = num_leaves;
+
+	/* There are less than 2 * num_leaves nodes */
+	if (!num_leaves || num_leaves > SIZE_MAX / (2 * MERKLE_HASH_LEN) - 1)
+		return NULL;
+
+	tree = calloc(1, sizeof(*tree));
+	if (!tree)
+		return NULL;
+
+	for (;;) {
+		tree->level_off[tree->num_levels] = num_nodes;
+		tree->level_len[tree->num_levels] = len;
+		tree->num_levels++;
+		num_nodes += len;
+		if (len == 1)
+			break;
+		len = (len + 1) / 2;
+	}
+
+	/* Cache line aligned, aligned_alloc wants
+	 * a multiple of the alignment */
+	alloc_len = (num_nodes * MERKLE_HASH_LEN + 63) & ~((size_t) 63);
+	tree->nodes = aligned_alloc(64, alloc_len);
+	if (!tree->nodes) {
+		free(tree);
+		return NULL;
+	}
+	memset(tree->nodes, 0, alloc_len);
+
+	return tree;
+}
+
+void
+merkle_free(merkle_tree_t *tree)
+{
+	if (!tree)
+		return;
+	free(tree->nodes);
+	free(tree);
+}
+
+void
+merkle_build(merkle_tree_t *tree, const void *const chunks[],
+	     const size_t lens[], unsigned int nthreads)
+{
+	struct merkle_job job;
+	unsigned int level = 0;
+	unsigned int i = 0;
+
+	memset(&job, 0, sizeof(job));
+	job.tree = tree;
+	job.chunks = chunks;
+	job.lens = lens;
+	job.eng = keccakf1600_get_default_engine();
+	for (i = 2; i <= KECCAK1600_MAX_WAYS; i <<= 1)
+		job.mb_eng[i] = keccakf1600_get_mb_engine(i);
+
+	for (level = 0; level < tree->num_levels; level++)
+		merkle_hash_level(&job, level, nthreads);
+}
+
+void
+merkle_update(merkle_tree_t *tree, size_t idx, const void *chunk, size_t len)
+{
+	const k1600_engine_t *eng = keccakf1600_get_default_engine();
+	uint8_t *parent = NULL;
+	uint8_t *child = NULL;
+	unsigned int level = 0;
+
+	if (idx >= tree->level_len[0])
+		return;
+
+	sha3_256_oneshot(chunk, len, tree->nodes[idx]);
+
+	for (level = 1; level < tree->num_levels; level++) {
+		/* Left child, its sibling is next to it */
+		child = tree->nodes[tree->level_off[level - 1] + (idx & ~((size_t) 1))];
+		idx /= 2;
+		parent = tree->nodes[tree->level_off[level] + idx];
+
+		if (2 * idx + 1 < tree->level_len[level - 1])
+			merkle_hash_node(eng, child, parent);
+		else
+			memcpy(parent, child, MERKLE_HASH_LEN);
+	}
+}
+
+size_t
+merkle_num_leaves(const merkle_tree_t *tree)
+{
+	return tree->level_len[0];
+}
+
+unsigned int
+merkle_num_levels(const merkle_tree_t *tree)
+{
+	return tree->num_levels;
+}
+
+const uint8_t *
+merkle_node(const merkle_tree_t *tree, unsigned int level, size_t idx)
+{
+	if (level >= tree->num_levels || idx >= tree->level_len[level])
+		return NULL;
+	return tree->nodes[tree->level_off[level] + idx];
+}
+
+const uint8_t *
+merkle_root(const merkle_tree_t *tree)
+{
+	return tree->nodes[tree->level_off[tree->num_levels - 1]];
+}
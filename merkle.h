@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3-256 Merkle tree
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _MERKLE_H
+#define _MERKLE_H
+
+/*
+ * A binary Merkle tree of SHA3-256 hashes, each leaf is the SHA3-256
+ * hash of a chunk and each node the hash of its two children
+ * concatenated (a fixed 64 byte input), through the SHA3-256 sponge
+ * but with the domain separation suffix bits set to 11 instead of 01,
+ * so that a chunk can't be passed off as a pair of hashes. When a
+ * level has an odd number of nodes the last one is carried up
+ * unchanged, so the root of a single chunk is its SHA3-256 hash.
+ *
+ * The whole tree is kept in one flat array, level by level starting
+ * from the leaves, so each node's children are next to each other and
+ * each level is hashed in one sequential pass. Building hashes the
+ * leaves in multi-buffer batches and then each level from the bottom
+ * up, each level spread over nthreads threads from the same worker
+ * pool as k12_oneshot().
+ * Updating a leaf only rehashes the nodes on its path to the root.
+ */
+
+#include <stddef.h>	/* For size_t */
+#include <stdint.h>	/* For typed integers */
+
+#define MERKLE_HASH_LEN		32
+
+typedef struct merkle_tree merkle_tree_t;
+
+/* Allocate a tree for num_leaves (> 0) chunks, returns NULL on
+ * failure. Nodes are all zeroes until the tree is built. */
+merkle_tree_t *merkle_new(size_t num_leaves);
+void merkle_free(merkle_tree_t *tree);
+
+/* Hash all chunks (num_leaves of them) and the tree on top of them,
+ * nthreads as in k12_oneshot(), 0 means one for each online cpu and
+ * 1 means only the calling thread. */
+void merkle_build(merkle_tree_t *tree, const void *const chunks[],
+		  const size_t lens[], unsigned int nthreads);
+/* Replace the chunk of leaf idx and update its path to the root,
+ * does nothing if idx is out of range */
+void merkle_update(merkle_tree_t *tree, size_t idx, const void *chunk,
+		   size_t len);
+
+size_t merkle_num_leaves(const merkle_tree_t *tree);
+unsigned int merkle_num_levels(const merkle_tree_t *tree);
+/* Node idx of the given level (0 for the leaves), or
+ * NULL if there's no such node */
+const uint8_t *merkle_node(const merkle_tree_t *tree, unsigned int level,
+			   size_t idx);
+const uint8_t *merkle_root(const merkle_tree_t *tree);
+
+#endif /* _MERKLE_H */
@@ -6,23 +6,274 @@
 
 #include "keccak1600.h"
 #include "sha3.h"
+#include <stdlib.h>	/* For qsort() */
 
+/* How many messages to look at when grouping them by length,
+ * this bounds the stack usage and keeps the grouping local. */
+#define SHA3_BATCH_WINDOW	256
+
+/* Domain separation, SHA3 appends 01 to the message, SHAKE
+ * 1111 and original Keccak (before FIPS 202) nothing */
+#define SHA3_DELIM		0x06
+#define SHAKE_DELIM		0x1F
+#define KECCAK_DELIM		0x01
+
+/* SHA3 / Keccak use a capacity of twice the digest length */
+#define SHA3_RATE(_md_len)	(KECCAK1600_STATE_SIZE - 2 * (_md_len))
+
+static const struct sha3_alg_info sha3_algs[SHA3_NUM_ALGS] = {
+	[SHA3_ALG_SHA3_224] = { 28, SHA3_RATE(28), SHA3_DELIM },
+	[SHA3_ALG_SHA3_256] = { 32, SHA3_RATE(32), SHA3_DELIM },
+	[SHA3_ALG_SHA3_384] = { 48, SHA3_RATE(48), SHA3_DELIM },
+	[SHA3_ALG_SHA3_512] = { 64, SHA3_RATE(64), SHA3_DELIM },
+	[SHA3_ALG_SHAKE128] = { 0, SHAKE128_RATE, SHAKE_DELIM },
+	[SHA3_ALG_SHAKE256] = { 0, SHAKE256_RATE, SHAKE_DELIM },
+	[SHA3_ALG_KECCAK_256] = { 32, SHA3_RATE(32), KECCAK_DELIM },
+	[SHA3_ALG_KECCAK_512] = { 64, SHA3_RATE(64), KECCAK_DELIM },
+};
+
+struct sha3_batch_entry {
+	size_t len;
+	size_t idx;
+};
+
+static int
+sha3_batch_entry_cmp(const void *a, const void *b)
+{
+	const struct sha3_batch_entry *ea = a;
+	const struct sha3_batch_entry *eb = b;
+
+	if (ea->len != eb->len)
+		return (ea->len < eb->len) ? -1 : 1;
+	/* Keep the original order to be cache friendly */
+	return (ea->idx < eb->idx) ? -1 : (ea->idx > eb->idx);
+}
+
+/*
+ * Sort each window of messages by length and feed runs of equal
+ * length messages to the widest multi-buffer engine available,
+ * falling back to narrower ones (and eventually to the default
+ * single-state engine) for what's left of each run.
+ */
 static void
-sha3_oneshot(const void *msg, size_t msg_len, void *md, size_t md_len)
+sha3_batch(const void *const msgs[], const size_t lens[],
+	   void *const mds[], size_t n, enum sha3_alg alg_id)
 {
-	keccakf1600_oneshot(msg, msg_len, md, md_len, 0x06);
+	const struct sha3_alg_info *alg = &sha3_algs[alg_id];
+	struct sha3_batch_entry win[SHA3_BATCH_WINDOW];
+	const void *mb_msgs[KECCAK1600_MAX_WAYS];
+	void *mb_mds[KECCAK1600_MAX_WAYS];
+	const k1600_mb_engine_t *eng = NULL;
+	size_t win_len = 0;
+	size_t base = 0;
+	size_t run = 0;
+	size_t i = 0;
+	unsigned int ways = 0;
+	size_t j = 0;
+	unsigned int k = 0;
+
+	for (base = 0; base < n; base += win_len) {
+		win_len = (n - base < SHA3_BATCH_WINDOW) ? (n - base) :
+			  SHA3_BATCH_WINDOW;
+
+		for (i = 0; i < win_len; i++) {
+			win[i].len = lens[base + i];
+			win[i].idx = base + i;
+		}
+		qsort(win, win_len, sizeof(win[0]), sha3_batch_entry_cmp);
+
+		for (i = 0; i < win_len; i += run) {
+			/* Find the length of this run */
+			for (run = 1; i + run < win_len &&
+			     win[i + run].len == win[i].len; run++);
+
+			ways = KECCAK1600_MAX_WAYS;
+			for (j = 0; j < run; j += ways) {
+				/* Pick the widest engine that fits */
+				while (ways > 1 && (run - j < ways ||
+				       !keccakf1600_get_mb_engine(ways)))
+					ways >>= 1;
+
+				if (ways == 1) {
+					keccakf1600_oneshot(msgs[win[i + j].idx],
+							    win[i + j].len,
+							    mds[win[i + j].idx],
+							    alg->md_len,
+							    alg->delim);
+					continue;
+				}
+
+				for (k = 0; k < ways; k++) {
+					mb_msgs[k] = msgs[win[i + j + k].idx];
+					mb_mds[k] = mds[win[i + j + k].idx];
+				}
+				eng = keccakf1600_get_mb_engine(ways);
+				keccakp1600_oneshot_mb(eng, KECCAK1600_NUM_ROUNDS,
+						       alg->rate_bytes, mb_msgs,
+						       win[i].len, mb_mds,
+						       alg->md_len, alg->delim);
+			}
+		}
+	}
+}
+
+static void
+sha3_init(sha3_ctx_t *ctx, enum sha3_alg alg_id)
+{
+	const struct sha3_alg_info *alg = &sha3_algs[alg_id];
+
+	keccakp1600_init(ctx, NULL, KECCAK1600_NUM_ROUNDS, alg->rate_bytes,
+			 alg->md_len, alg->delim);
+}
+
+static void
+shake_init(sha3_ctx_t *ctx, enum sha3_alg alg_id)
+{
+	const struct sha3_alg_info *alg = &sha3_algs[alg_id];
+
+	keccakf1600_xof_init(ctx, NULL, alg->rate_bytes, alg->delim);
+}
+
+/* For SHAKE out_len is the caller's, for the rest it's the digest
+ * length, the table lookups fold to constants on each entry point */
+static void
+sha3_oneshot(const void *msg, size_t msg_len, void *md, size_t md_len,
+	     enum sha3_alg alg_id)
+{
+	const struct sha3_alg_info *alg = &sha3_algs[alg_id];
+
+	keccakp1600_oneshot(NULL, KECCAK1600_NUM_ROUNDS, alg->rate_bytes,
+			    msg, msg_len, md, md_len, alg->delim);
 }
 
 /**************\
 * ENTRY POINTS *
 \**************/
 
+void sha3_224_oneshot(const void *msg, size_t msg_len, void *md)
+{
+	sha3_oneshot(msg, msg_len, md, 28, SHA3_ALG_SHA3_224);
+}
+
 void sha3_256_oneshot(const void *msg, size_t msg_len, void *md)
 {
-	sha3_oneshot(msg, msg_len, md, 32);
+	sha3_oneshot(msg, msg_len, md, 32, SHA3_ALG_SHA3_256);
+}
+
+void sha3_384_oneshot(const void *msg, size_t msg_len, void *md)
+{
+	sha3_oneshot(msg, msg_len, md, 48, SHA3_ALG_SHA3_384);
 }
 
 void sha3_512_oneshot(const void *msg, size_t msg_len, void *md)
 {
-	sha3_oneshot(msg, msg_len, md, 64);
+	sha3_oneshot(msg, msg_len, md, 64, SHA3_ALG_SHA3_512);
+}
+
+void keccak_256_oneshot(const void *msg, size_t msg_len, void *md)
+{
+	sha3_oneshot(msg, msg_len, md, 32, SHA3_ALG_KECCAK_256);
+}
+
+void keccak_512_oneshot(const void *msg, size_t msg_len, void *md)
+{
+	sha3_oneshot(msg, msg_len, md, 64, SHA3_ALG_KECCAK_512);
+}
+
+void shake128_oneshot(const void *msg, size_t msg_len, void *out,
+		      size_t out_len)
+{
+	sha3_oneshot(msg, msg_len, out, out_len, SHA3_ALG_SHAKE128);
+}
+
+void shake256_oneshot(const void *msg, size_t msg_len, void *out,
+		      size_t out_len)
+{
+	sha3_oneshot(msg, msg_len, out, out_len, SHA3_ALG_SHAKE256);
+}
+
+void sha3_224_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n)
+{
+	sha3_batch(msgs, lens, mds, n, SHA3_ALG_SHA3_224);
+}
+
+void sha3_256_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n)
+{
+	sha3_batch(msgs, lens, mds, n, SHA3_ALG_SHA3_256);
+}
+
+void sha3_384_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n)
+{
+	sha3_batch(msgs, lens, mds, n, SHA3_ALG_SHA3_384);
+}
+
+void sha3_512_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n)
+{
+	sha3_batch(msgs, lens, mds, n, SHA3_ALG_SHA3_512);
+}
+
+void sha3_224_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_SHA3_224);
+}
+
+void sha3_256_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_SHA3_256);
+}
+
+void sha3_384_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_SHA3_384);
+}
+
+void sha3_512_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_SHA3_512);
+}
+
+void keccak_256_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_KECCAK_256);
+}
+
+void keccak_512_init(sha3_ctx_t *ctx)
+{
+	sha3_init(ctx, SHA3_ALG_KECCAK_512);
+}
+
+void sha3_update(sha3_ctx_t *ctx, const void *msg, size_t msg_len)
+{
+	keccakf1600_update(ctx, msg, msg_len);
+}
+
+void sha3_final(sha3_ctx_t *ctx, void *md)
+{
+	keccakf1600_final(ctx, md);
+}
+
+void shake128_init(sha3_ctx_t *ctx)
+{
+	shake_init(ctx, SHA3_ALG_SHAKE128);
+}
+
+void shake256_init(sha3_ctx_t *ctx)
+{
+	shake_init(ctx, SHA3_ALG_SHAKE256);
+}
+
+void shake_squeeze(sha3_ctx_t *ctx, void *out, size_t out_len)
+{
+	keccakf1600_xof_squeeze(ctx, out, out_len);
+}
+
+const struct sha3_alg_info *sha3_get_alg_info(enum sha3_alg alg)
+{
+	if ((unsigned int) alg >= SHA3_NUM_ALGS)
+		return NULL;
+	return &sha3_algs[alg];
 }
@@ -4,7 +4,83 @@
  * Copyright (C) 2019 Nick Kossifidis <mick@ics.forth.gr>
  */
 
+#ifndef _SHA3_H
+#define _SHA3_H
+
 #include <stddef.h>	/* For size_t */
 
+void sha3_224_oneshot(const void *msg, size_t msg_len, void* md);
 void sha3_256_oneshot(const void *msg, size_t msg_len, void* md);
+void sha3_384_oneshot(const void *msg, size_t msg_len, void* md);
 void sha3_512_oneshot(const void *msg, size_t msg_len, void* md);
+void shake128_oneshot(const void *msg, size_t msg_len, void *out,
+		      size_t out_len);
+void shake256_oneshot(const void *msg, size_t msg_len, void *out,
+		      size_t out_len);
+
+#ifndef OSSL_BUILD
+#include "keccak1600.h"
+
+/* Incremental API, for hashing streams in fixed memory */
+typedef k1600_ctx_t sha3_ctx_t;
+
+void sha3_224_init(sha3_ctx_t *ctx);
+void sha3_256_init(sha3_ctx_t *ctx);
+void sha3_384_init(sha3_ctx_t *ctx);
+void sha3_512_init(sha3_ctx_t *ctx);
+void sha3_update(sha3_ctx_t *ctx, const void *msg, size_t msg_len);
+void sha3_final(sha3_ctx_t *ctx, void *md);
+
+/* SHAKE128/256, output can be squeezed in chunks of any size
+ * and each call continues from where the previous one stopped,
+ * using sha3_update() for input (before the first squeeze) */
+#define SHAKE128_RATE	168
+#define SHAKE256_RATE	136
+void shake128_init(sha3_ctx_t *ctx);
+void shake256_init(sha3_ctx_t *ctx);
+void shake_squeeze(sha3_ctx_t *ctx, void *out, size_t out_len);
+
+/* Hash n independent messages, messages of the same length
+ * are grouped together and hashed using the multi-buffer
+ * engines */
+void sha3_224_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n);
+void sha3_256_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n);
+void sha3_384_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n);
+void sha3_512_batch(const void *const msgs[], const size_t lens[],
+		    void *const mds[], size_t n);
+
+/* Original Keccak padding (before FIPS 202), as used by
+ * Ethereum's Keccak-256, with the same incremental API */
+void keccak_256_oneshot(const void *msg, size_t msg_len, void *md);
+void keccak_512_oneshot(const void *msg, size_t msg_len, void *md);
+void keccak_256_init(sha3_ctx_t *ctx);
+void keccak_512_init(sha3_ctx_t *ctx);
+
+/* Parameters of each of the above, for code that picks
+ * the algorithm at run time (e.g. the hashing service) */
+enum sha3_alg {
+	SHA3_ALG_SHA3_224 = 0,
+	SHA3_ALG_SHA3_256,
+	SHA3_ALG_SHA3_384,
+	SHA3_ALG_SHA3_512,
+	SHA3_ALG_SHAKE128,
+	SHA3_ALG_SHAKE256,
+	SHA3_ALG_KECCAK_256,
+	SHA3_ALG_KECCAK_512,
+	SHA3_NUM_ALGS
+};
+
+struct sha3_alg_info {
+	size_t md_len;	/* 0 for SHAKE, it's up to the caller */
+	size_t rate_bytes;
+	uint8_t delim;
+};
+
+/* Returns NULL for an invalid algorithm */
+const struct sha3_alg_info *sha3_get_alg_info(enum sha3_alg alg);
+#endif /* OSSL_BUILD */
+
+#endif /* _SHA3_H */
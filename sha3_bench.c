@@ -0,0 +1,1127 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 C / RV64 Implementation - Benchmark
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#define _GNU_SOURCE		/* For sched_setaffinity() / sched_getcpu() */
+#include <stdio.h>		/* For printf() */
+#include <stdlib.h>		/* For malloc() / qsort() / strtoul() */
+#include <string.h>		/* For strcmp() */
+#include <math.h>		/* For sqrt() / fabs() */
+#include <time.h>		/* For clock_gettime() */
+#include <unistd.h>		/* For getopt() */
+#include <sched.h>		/* For sched_setaffinity() */
+#include <signal.h>		/* For sigaction() */
+#include <setjmp.h>		/* For sigsetjmp() */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>		/* For __rdtsc() */
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>	/* For SYS_perf_event_open */
+#include <linux/perf_event.h>	/* For struct perf_event_attr */
+#endif
+#include "keccak1600.h"
+
+/*
+ * For each backend and algorithm we hash messages of increasing
+ * size, from 0 bytes up to max_size (64MB by default) in steps of
+ * 4x. Each sample hashes the message enough times to take at least
+ * BENCH_MIN_SAMPLE_NS, and after a few warm-up samples we keep the
+ * median and the 10th / 90th percentiles of the time per hash.
+ *
+ * Time comes from CLOCK_MONOTONIC, cycles from rdtsc on x86 (note
+ * that this is the constant rate TSC, not core cycles, so turbo /
+ * frequency scaling will show up) and rdcycle on RISC-V, when the
+ * kernel allows it from user space.
+ *
+ * With -p we also open a set of hardware counters through
+ * perf_event_open, as one group with cycles as the leader so that
+ * they are all counting over the same time slices (the ones the cpu /
+ * kernel don't have, or that don't fit on the PMU together with the
+ * rest, are skipped). We sum them over all non warm-up samples, scale
+ * them by the group's enabled / running time in case the kernel
+ * multiplexed it with someone else's events, and report them per
+ * permutation and per byte. When built with -DBENCH_HPM on RV64 we
+ * instead read the cycle / instret / hpmcounter3-6 CSRs directly,
+ * for bare metal or for kernels that let us, it's up to the firmware
+ * to program mhpmevent3-6 with something useful.
+ *
+ * With -l size we switch to latency mode, where instead of averaging
+ * many hashes per sample we time each call separately (in cycles
+ * when we have them, ns otherwise) for a fixed message size, and
+ * report the min / median / p99 / max, and jitter (p99 - min) over
+ * all runs. This is what matters when the worst case is what we
+ * care about, e.g. on a boot path with a deadline. Each run uses
+ * either a fixed message or a fresh random one, picked at random
+ * (dudect style), and we run Welch's t-test on the two classes (over
+ * the runs below the p99, to leave interrupts etc out). A |t| above
+ * BENCH_LAT_T_MAX means the timing likely depends on the input.
+ */
+
+#define BENCH_WARMUP_SAMPLES	3
+#define BENCH_DEFAULT_SAMPLES	15
+/* Fewer samples for large messages, so that a full sweep
+ * doesn't take forever, it's less noisy there anyway */
+#define BENCH_MIN_SAMPLES	5
+#define BENCH_LONG_HASH_NS	50000000ULL
+#define BENCH_MIN_SAMPLE_NS	1000000ULL
+#define BENCH_MAX_SIZE		(64UL << 20)
+#define BENCH_MAX_COUNTERS	8
+/* A counter snapshot also has the group's
+ * enabled / running time after the counters */
+#define BENCH_SNAP_ENABLED	BENCH_MAX_COUNTERS
+#define BENCH_SNAP_RUNNING	(BENCH_MAX_COUNTERS + 1)
+#define BENCH_SNAP_LEN		(BENCH_MAX_COUNTERS + 2)
+/* How long to wait for a new group member to get scheduled */
+#define BENCH_GROUP_PROBE_NS	1000000ULL
+#define BENCH_LAT_WARMUP_RUNS	1000
+#define BENCH_LAT_DEFAULT_RUNS	10000
+#define BENCH_LAT_MAX_RUNS	10000000
+#define BENCH_LAT_T_MAX		4.5
+
+enum bench_fmt {
+	BENCH_FMT_TEXT,
+	BENCH_FMT_CSV,
+	BENCH_FMT_JSON,
+};
+
+struct bench_alg {
+	const char *name;
+	size_t md_len;
+	size_t rate_bytes;
+	uint8_t delim;
+	int xof;
+};
+
+static const struct bench_alg bench_algs[] = {
+	{ "sha3-256", 32, 136, 0x06, 0 },
+	{ "sha3-512", 64, 72, 0x06, 0 },
+	{ "shake128", 32, 168, 0x1F, 1 },
+	{ "shake256", 32, 136, 0x1F, 1 },
+	{ NULL, 0, 0, 0, 0 }
+};
+
+struct bench_result {
+	size_t iters;
+	unsigned int samples;
+	double median_ns;
+	double p10_ns;
+	double p90_ns;
+	double median_cycles;
+	/* Average counter values per hash */
+	double counts[BENCH_MAX_COUNTERS];
+};
+
+struct bench_lat_result {
+	unsigned int runs;
+	double min;
+	double median;
+	double p99;
+	double max;
+	double jitter;
+	/* Welch's t between the fixed / random input runs */
+	double t;
+};
+
+struct bench_counter {
+	const char *name;
+	uint32_t type;
+	uint64_t config;
+	int fd;
+	/* Position in the group's read buffer */
+	unsigned int slot;
+};
+
+#if defined(BENCH_HPM) && defined(__riscv) && (__riscv_xlen == 64)
+#define BENCH_HPM_CSRS
+static struct bench_counter bench_counters[] = {
+	{ "cycles", 0, 0, -1, 0 },
+	{ "instructions", 0, 0, -1, 0 },
+	{ "hpm3", 0, 0, -1, 0 },
+	{ "hpm4", 0, 0, -1, 0 },
+	{ "hpm5", 0, 0, -1, 0 },
+	{ "hpm6", 0, 0, -1, 0 },
+	{ NULL, 0, 0, -1, 0 }
+};
+#elif defined(__linux__)
+#define PERF_CACHE_CONFIG(_cache, _op, _result)	\
+	((_cache) | ((_op) << 8) | ((_result) << 16))
+
+static struct bench_counter bench_counters[] = {
+	{ "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, -1, 0 },
+	{ "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, -1, 0 },
+	{ "l1d_loads", PERF_TYPE_HW_CACHE,
+	  PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+			    PERF_COUNT_HW_CACHE_RESULT_ACCESS), -1, 0 },
+	{ "l1d_misses", PERF_TYPE_HW_CACHE,
+	  PERF_CACHE_CONFIG(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+			    PERF_COUNT_HW_CACHE_RESULT_MISS), -1, 0 },
+	{ "branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, -1, 0 },
+	{ "stalls_frontend", PERF_TYPE_HARDWARE,
+	  PERF_COUNT_HW_STALLED_CYCLES_FRONTEND, -1, 0 },
+	{ "stalls_backend", PERF_TYPE_HARDWARE,
+	  PERF_COUNT_HW_STALLED_CYCLES_BACKEND, -1, 0 },
+	{ NULL, 0, 0, -1, 0 }
+};
+#else
+static struct bench_counter bench_counters[] = {
+	{ NULL, 0, 0, -1, 0 }
+};
+#endif
+
+static int have_cycles = 0;
+static int perf_mode = 0;
+static int group_fd = -1;
+
+
+/*********\
+* HELPERS *
+\*********/
+
+static uint64_t
+get_time_ns(void)
+{
+	struct timespec ts = { 0 };
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline uint64_t
+get_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__riscv) && (__riscv_xlen == 64)
+	uint64_t cycles = 0;
+	__asm__ volatile ("rdcycle %0" : "=r" (cycles));
+	return cycles;
+#else
+	return 0;
+#endif
+}
+
+/* For timing single calls, on x86 rdtsc may be executed before
+ * the previous instructions complete (or after the following ones
+ * start), lfence prevents that. On RISC-V rdcycle is ordered with
+ * the instructions around it as far as we are concerned. */
+static inline uint64_t
+get_cycles_ordered(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	uint64_t cycles = 0;
+
+	_mm_lfence();
+	cycles = __rdtsc();
+	_mm_lfence();
+	return cycles;
+#else
+	return get_cycles();
+#endif
+}
+
+/* xorshift64*, good enough for picking classes / random
+ * messages, and doesn't touch any global state */
+static inline uint64_t
+rand_next(uint64_t *seed)
+{
+	uint64_t x = *seed;
+
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	*seed = x;
+	return x * 0x2545F4914F6CDD1DULL;
+}
+
+static void
+rand_fill(uint64_t *seed, uint8_t *buf, size_t len)
+{
+	uint64_t r = 0;
+	size_t i = 0;
+
+	for (i = 0; i < len; i++) {
+		if (!(i % 8))
+			r = rand_next(seed);
+		buf[i] = r >> (8 * (i % 8));
+	}
+}
+
+#if defined(__riscv) && (__riscv_xlen == 64)
+static sigjmp_buf probe_env;
+
+static void
+probe_sigill(int sig)
+{
+	(void) sig;
+	siglongjmp(probe_env, 1);
+}
+#endif
+
+/* Newer Linux kernels don't allow rdcycle from user space
+ * (it traps), so try it once before relying on it */
+static int
+probe_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return 1;
+#elif defined(__riscv) && (__riscv_xlen == 64)
+	struct sigaction sa = { 0 };
+	struct sigaction old_sa = { 0 };
+	int ret = 0;
+
+	sa.sa_handler = probe_sigill;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGILL, &sa, &old_sa);
+	if (!sigsetjmp(probe_env, 1)) {
+		get_cycles();
+		ret = 1;
+	}
+	sigaction(SIGILL, &old_sa, NULL);
+
+	return ret;
+#else
+	return 0;
+#endif
+}
+
+static int
+pin_cpu(int cpu)
+{
+	cpu_set_t set;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return sched_setaffinity(0, sizeof(set), &set);
+}
+
+static int
+cmp_double(const void *a, const void *b)
+{
+	double da = *(const double *) a;
+	double db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+/* Nearest rank percentile of the sorted values */
+static double
+percentile(const double *vals, unsigned int num, unsigned int pct)
+{
+	unsigned int idx = (pct * (num - 1) + 50) / 100;
+
+	return vals[idx];
+}
+
+static void
+hash_once(const k1600_engine_t *eng, const struct bench_alg *alg,
+	  const uint8_t *msg, size_t msg_len, uint8_t *md)
+{
+	k1600_ctx_t ctx;
+
+	if (alg->xof) {
+		keccakf1600_xof_init(&ctx, eng, alg->rate_bytes, alg->delim);
+		keccakf1600_update(&ctx, msg, msg_len);
+		keccakf1600_xof_squeeze(&ctx, md, alg->md_len);
+	} else {
+		keccakp1600_init(&ctx, eng, KECCAK1600_NUM_ROUNDS,
+				 alg->rate_bytes, alg->md_len, alg->delim);
+		keccakf1600_update(&ctx, msg, msg_len);
+		keccakf1600_final(&ctx, md);
+	}
+}
+
+
+/***************\
+* PERF COUNTERS *
+\***************/
+
+#if defined(BENCH_HPM_CSRS)
+static uint64_t
+counter_read(unsigned int idx)
+{
+	uint64_t val = 0;
+
+	switch (idx) {
+	case 0:
+		__asm__ volatile ("csrr %0, cycle" : "=r" (val));
+		break;
+	case 1:
+		__asm__ volatile ("csrr %0, instret" : "=r" (val));
+		break;
+	case 2:
+		__asm__ volatile ("csrr %0, hpmcounter3" : "=r" (val));
+		break;
+	case 3:
+		__asm__ volatile ("csrr %0, hpmcounter4" : "=r" (val));
+		break;
+	case 4:
+		__asm__ volatile ("csrr %0, hpmcounter5" : "=r" (val));
+		break;
+	case 5:
+		__asm__ volatile ("csrr %0, hpmcounter6" : "=r" (val));
+		break;
+	default:
+		break;
+	}
+
+	return val;
+}
+#elif defined(__linux__)
+/* With PERF_FORMAT_GROUP we get the number of
+ * counters, the time enabled / running and then
+ * each counter in the order they were added */
+#define GROUP_NR	0
+#define GROUP_ENABLED	1
+#define GROUP_RUNNING	2
+#define GROUP_VALS	3
+
+static int
+group_read(uint64_t *buf)
+{
+	size_t len = (GROUP_VALS + BENCH_MAX_COUNTERS) * sizeof(uint64_t);
+
+	memset(buf, 0, len);
+	return read(group_fd, buf, len) < (ssize_t) (GROUP_VALS *
+						     sizeof(uint64_t));
+}
+
+/* A group that doesn't fit on the PMU is never scheduled, so after
+ * adding a counter check that the group still gets running time */
+static int
+group_runs(void)
+{
+	uint64_t before[GROUP_VALS + BENCH_MAX_COUNTERS];
+	uint64_t after[GROUP_VALS + BENCH_MAX_COUNTERS];
+	uint64_t start_ns = 0;
+
+	if (group_read(before))
+		return 0;
+	start_ns = get_time_ns();
+	while (get_time_ns() - start_ns < BENCH_GROUP_PROBE_NS)
+		;
+	if (group_read(after))
+		return 0;
+
+	return after[GROUP_RUNNING] > before[GROUP_RUNNING];
+}
+#endif
+
+/* Open the counters we can, returns how many we got */
+static int
+counters_open(void)
+{
+	int num_open = 0;
+	int i = 0;
+#if defined(BENCH_HPM_CSRS)
+	struct sigaction sa = { 0 };
+	struct sigaction old_sa = { 0 };
+
+	/* Reading a counter that's not enabled on
+	 * mcounteren / scounteren traps */
+	sa.sa_handler = probe_sigill;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGILL, &sa, &old_sa);
+	for (i = 0; bench_counters[i].name != NULL; i++) {
+		if (sigsetjmp(probe_env, 1))
+			continue;
+		counter_read(i);
+		bench_counters[i].fd = 0;
+		num_open++;
+	}
+	sigaction(SIGILL, &old_sa, NULL);
+#elif defined(__linux__)
+	struct perf_event_attr attr;
+	int fd = -1;
+
+	/* Cycles go first so they'll be the leader if we have
+	 * them, else it's the first counter that opens */
+	for (i = 0; bench_counters[i].name != NULL; i++) {
+		memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = bench_counters[i].type;
+		attr.config = bench_counters[i].config;
+		attr.read_format = PERF_FORMAT_GROUP |
+				   PERF_FORMAT_TOTAL_TIME_ENABLED |
+				   PERF_FORMAT_TOTAL_TIME_RUNNING;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv = 1;
+		fd = syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+		if (fd < 0)
+			continue;
+		if (group_fd < 0)
+			group_fd = fd;
+		if (!group_runs()) {
+			close(fd);
+			if (fd == group_fd)
+				group_fd = -1;
+			continue;
+		}
+		bench_counters[i].fd = fd;
+		bench_counters[i].slot = num_open++;
+	}
+#endif
+	return num_open;
+}
+
+static void
+counters_close(void)
+{
+	int i = 0;
+
+	/* Close the leader last, members
+	 * go away with it anyway */
+	for (i = 0; bench_counters[i].name != NULL; i++) {
+#if !defined(BENCH_HPM_CSRS)
+		if (bench_counters[i].fd >= 0 &&
+		    bench_counters[i].fd != group_fd)
+			close(bench_counters[i].fd);
+#endif
+		bench_counters[i].fd = -1;
+	}
+#if !defined(BENCH_HPM_CSRS)
+	if (group_fd >= 0)
+		close(group_fd);
+	group_fd = -1;
+#endif
+}
+
+/* Fills BENCH_SNAP_LEN values, the CSRs are always
+ * running so their enabled / running time stays 0 */
+static inline void
+counters_snapshot(uint64_t *vals)
+{
+#if defined(BENCH_HPM_CSRS)
+	int i = 0;
+
+	for (i = 0; bench_counters[i].name != NULL; i++)
+		if (bench_counters[i].fd >= 0)
+			vals[i] = counter_read(i);
+#elif defined(__linux__)
+	uint64_t buf[GROUP_VALS + BENCH_MAX_COUNTERS];
+	int i = 0;
+
+	if (group_fd < 0 || group_read(buf))
+		return;
+	for (i = 0; bench_counters[i].name != NULL; i++)
+		if (bench_counters[i].fd >= 0)
+			vals[i] = buf[GROUP_VALS + bench_counters[i].slot];
+	vals[BENCH_SNAP_ENABLED] = buf[GROUP_ENABLED];
+	vals[BENCH_SNAP_RUNNING] = buf[GROUP_RUNNING];
+#else
+	(void) vals;
+#endif
+}
+
+
+/*************\
+* MEASUREMENT *
+\*************/
+
+static void
+bench_run(const k1600_engine_t *eng, const struct bench_alg *alg,
+	  const uint8_t *msg, size_t msg_len, unsigned int max_samples,
+	  struct bench_result *res)
+{
+	double ns[BENCH_WARMUP_SAMPLES + BENCH_DEFAULT_SAMPLES * 8];
+	double cycles[BENCH_WARMUP_SAMPLES + BENCH_DEFAULT_SAMPLES * 8];
+	uint64_t cnt_start[BENCH_SNAP_LEN] = { 0 };
+	uint64_t cnt_end[BENCH_SNAP_LEN] = { 0 };
+	uint64_t enabled = 0;
+	uint64_t running = 0;
+	uint8_t md[64] = { 0 };
+	uint64_t start_ns = 0;
+	uint64_t start_cycles = 0;
+	uint64_t dur = 0;
+	unsigned int samples = max_samples;
+	unsigned int i = 0;
+	size_t iters = 0;
+	size_t j = 0;
+
+	memset(res->counts, 0, sizeof(res->counts));
+
+	/* Figure out how many hashes we need per sample,
+	 * this also serves as the first warm-up run */
+	start_ns = get_time_ns();
+	hash_once(eng, alg, msg, msg_len, md);
+	dur = get_time_ns() - start_ns;
+	if (dur == 0)
+		dur = 1;
+	iters = (BENCH_MIN_SAMPLE_NS + dur - 1) / dur;
+	if (dur > BENCH_LONG_HASH_NS && samples > BENCH_MIN_SAMPLES)
+		samples = BENCH_MIN_SAMPLES;
+
+	for (i = 0; i < BENCH_WARMUP_SAMPLES + samples; i++) {
+		if (perf_mode)
+			counters_snapshot(cnt_start);
+		start_ns = get_time_ns();
+		start_cycles = have_cycles ? get_cycles() : 0;
+		for (j = 0; j < iters; j++)
+			hash_once(eng, alg, msg, msg_len, md);
+		cycles[i] = have_cycles ?
+			    (double) (get_cycles() - start_cycles) / iters : 0;
+		ns[i] = (double) (get_time_ns() - start_ns) / iters;
+		if (!perf_mode || i < BENCH_WARMUP_SAMPLES)
+			continue;
+		counters_snapshot(cnt_end);
+		for (j = 0; j < BENCH_MAX_COUNTERS; j++)
+			res->counts[j] += cnt_end[j] - cnt_start[j];
+		enabled += cnt_end[BENCH_SNAP_ENABLED] -
+			   cnt_start[BENCH_SNAP_ENABLED];
+		running += cnt_end[BENCH_SNAP_RUNNING] -
+			   cnt_start[BENCH_SNAP_RUNNING];
+	}
+
+	/* If the group was multiplexed, extrapolate to the time it was
+	 * enabled, all counters of the group scale the same way */
+	for (j = 0; j < BENCH_MAX_COUNTERS; j++) {
+		if (running > 0 && running < enabled)
+			res->counts[j] *= (double) enabled / running;
+		res->counts[j] /= (double) samples * iters;
+	}
+
+	/* Drop the warm-up samples */
+	qsort(ns + BENCH_WARMUP_SAMPLES, samples, sizeof(double), cmp_double);
+	qsort(cycles + BENCH_WARMUP_SAMPLES, samples, sizeof(double), cmp_double);
+
+	res->iters = iters;
+	res->samples = samples;
+	res->median_ns = percentile(ns + BENCH_WARMUP_SAMPLES, samples, 50);
+	res->p10_ns = percentile(ns + BENCH_WARMUP_SAMPLES, samples, 10);
+	res->p90_ns = percentile(ns + BENCH_WARMUP_SAMPLES, samples, 90);
+	res->median_cycles = percentile(cycles + BENCH_WARMUP_SAMPLES,
+					samples, 50);
+}
+
+/*
+ * Time runs single calls, each one on either the fixed message (class 0)
+ * or a random one (class 1). The message is copied / generated in the
+ * same buffer before each call, outside the timed region, so both classes
+ * see it in the same place and equally hot in the cache.
+ */
+static int
+bench_lat_run(const k1600_engine_t *eng, const struct bench_alg *alg,
+	      const uint8_t *fixed, uint8_t *msg, size_t msg_len,
+	      unsigned int runs, struct bench_lat_result *res)
+{
+	/* Running mean / sum of squared differences per class
+	 * (Welford), so that we don't need to sort them apart */
+	double mean[2] = { 0 };
+	double m2[2] = { 0 };
+	double num[2] = { 0 };
+	double var[2] = { 0 };
+	double delta = 0;
+	double *vals = NULL;
+	double *sorted = NULL;
+	uint8_t *cls = NULL;
+	uint8_t md[64] = { 0 };
+	uint64_t seed = 0x9E3779B97F4A7C15ULL;
+	uint64_t start = 0;
+	unsigned int i = 0;
+	int c = 0;
+
+	vals = malloc(runs * sizeof(double));
+	sorted = malloc(runs * sizeof(double));
+	cls = malloc(runs);
+	if (!vals || !sorted || !cls) {
+		free(vals);
+		free(sorted);
+		free(cls);
+		return -1;
+	}
+
+	for (i = 0; i < BENCH_LAT_WARMUP_RUNS + runs; i++) {
+		c = rand_next(&seed) & 1;
+		if (c)
+			rand_fill(&seed, msg, msg_len);
+		else
+			memcpy(msg, fixed, msg_len);
+
+		if (have_cycles) {
+			start = get_cycles_ordered();
+			hash_once(eng, alg, msg, msg_len, md);
+			start = get_cycles_ordered() - start;
+		} else {
+			start = get_time_ns();
+			hash_once(eng, alg, msg, msg_len, md);
+			start = get_time_ns() - start;
+		}
+
+		if (i < BENCH_LAT_WARMUP_RUNS)
+			continue;
+		vals[i - BENCH_LAT_WARMUP_RUNS] = (double) start;
+		cls[i - BENCH_LAT_WARMUP_RUNS] = c;
+	}
+
+	memcpy(sorted, vals, runs * sizeof(double));
+	qsort(sorted, runs, sizeof(double), cmp_double);
+
+	res->runs = runs;
+	res->min = sorted[0];
+	res->median = percentile(sorted, runs, 50);
+	res->p99 = percentile(sorted, runs, 99);
+	res->max = sorted[runs - 1];
+	res->jitter = res->p99 - res->min;
+
+	for (i = 0; i < runs; i++) {
+		if (vals[i] > res->p99)
+			continue;
+		c = cls[i];
+		num[c] += 1;
+		delta = vals[i] - mean[c];
+		mean[c] += delta / num[c];
+		m2[c] += delta * (vals[i] - mean[c]);
+	}
+
+	/* t = (mean0 - mean1) / sqrt(var0 / n0 + var1 / n1), if
+	 * there's no variance at all both classes behave the same */
+	res->t = 0;
+	if (num[0] > 1 && num[1] > 1) {
+		var[0] = m2[0] / (num[0] - 1);
+		var[1] = m2[1] / (num[1] - 1);
+		delta = var[0] / num[0] + var[1] / num[1];
+		if (delta > 0)
+			res->t = (mean[0] - mean[1]) / sqrt(delta);
+	}
+
+	free(vals);
+	free(sorted);
+	free(cls);
+	return 0;
+}
+
+
+/********\
+* OUTPUT *
+\********/
+
+static void
+print_header(enum bench_fmt fmt)
+{
+	int i = 0;
+
+	switch (fmt) {
+	case BENCH_FMT_CSV:
+		printf("engine,alg,size,iters,samples,median_ns,p10_ns,"
+		       "p90_ns,gbps,median_cycles,cpb");
+		for (i = 0; perf_mode && bench_counters[i].name != NULL; i++)
+			printf(",%s_perm,%s_byte", bench_counters[i].name,
+			       bench_counters[i].name);
+		printf("%s\n", perf_mode ? ",ipc" : "");
+		break;
+	case BENCH_FMT_JSON:
+		printf("[\n");
+		break;
+	default:
+		printf("%-20s %-9s %10s %14s %14s %14s %9s %9s\n", "engine",
+		       "alg", "size", "median ns", "p10 ns", "p90 ns",
+		       "GB/s", "c/B");
+		break;
+	}
+}
+
+static void
+print_footer(enum bench_fmt fmt)
+{
+	if (fmt == BENCH_FMT_JSON)
+		printf("\n]\n");
+}
+
+/*
+ * Counters are printed per permutation and per byte, with an
+ * empty field (csv) / no entry (json) / a dash (text) for the
+ * ones we couldn't open. Instructions per cycle go last, if
+ * we have both.
+ */
+static void
+print_counters(enum bench_fmt fmt, const struct bench_alg *alg,
+	       size_t msg_len, const struct bench_result *res)
+{
+	/* We need one permutation per full block plus
+	 * the last (padded) one, the output always fits
+	 * in a block */
+	double perms = msg_len / alg->rate_bytes + 1;
+	double ipc = 0;
+	int printed = 0;
+	int i = 0;
+
+	if (bench_counters[0].fd >= 0 && bench_counters[1].fd >= 0 &&
+	    res->counts[0] > 0)
+		ipc = res->counts[1] / res->counts[0];
+
+	switch (fmt) {
+	case BENCH_FMT_CSV:
+		for (i = 0; bench_counters[i].name != NULL; i++) {
+			if (bench_counters[i].fd < 0) {
+				printf(",,");
+				continue;
+			}
+			printf(",%.1f,", res->counts[i] / perms);
+			if (msg_len)
+				printf("%.3f", res->counts[i] / msg_len);
+		}
+		printf(",");
+		if (ipc > 0)
+			printf("%.2f", ipc);
+		break;
+	case BENCH_FMT_JSON:
+		printf(", \"counters\": {");
+		for (i = 0; bench_counters[i].name != NULL; i++) {
+			if (bench_counters[i].fd < 0)
+				continue;
+			printf("%s\"%s\": {\"perm\": %.1f, \"byte\": %.3f}",
+			       printed ? ", " : "", bench_counters[i].name,
+			       res->counts[i] / perms,
+			       msg_len ? res->counts[i] / msg_len : 0);
+			printed++;
+		}
+		printf("}");
+		if (ipc > 0)
+			printf(", \"ipc\": %.2f", ipc);
+		break;
+	default:
+		printf("    per perm:");
+		for (i = 0; bench_counters[i].name != NULL; i++) {
+			if (bench_counters[i].fd < 0)
+				printf(" %s -", bench_counters[i].name);
+			else
+				printf(" %s %.1f", bench_counters[i].name,
+				       res->counts[i] / perms);
+		}
+		if (ipc > 0)
+			printf(" ipc %.2f", ipc);
+		printf("\n");
+		if (!msg_len)
+			break;
+		printf("    per byte:");
+		for (i = 0; bench_counters[i].name != NULL; i++) {
+			if (bench_counters[i].fd < 0)
+				printf(" %s -", bench_counters[i].name);
+			else
+				printf(" %s %.3f", bench_counters[i].name,
+				       res->counts[i] / msg_len);
+		}
+		printf("\n");
+		break;
+	}
+}
+
+static void
+print_result(enum bench_fmt fmt, int first, const k1600_engine_t *eng,
+	     const struct bench_alg *alg, size_t msg_len,
+	     const struct bench_result *res)
+{
+	/* Both are 0 for empty messages, the time per hash
+	 * is what matters there */
+	double gbps = msg_len ? (double) msg_len / res->median_ns : 0;
+	double cpb = msg_len ? res->median_cycles / msg_len : 0;
+
+	switch (fmt) {
+	case BENCH_FMT_CSV:
+		printf("%s,%s,%zu,%zu,%u,%.1f,%.1f,%.1f,%.4f,%.1f,%.3f",
+		       eng->name, alg->name, msg_len, res->iters,
+		       res->samples, res->median_ns, res->p10_ns,
+		       res->p90_ns, gbps, res->median_cycles, cpb);
+		if (perf_mode)
+			print_counters(fmt, alg, msg_len, res);
+		printf("\n");
+		break;
+	case BENCH_FMT_JSON:
+		printf("%s  {\"engine\": \"%s\", \"alg\": \"%s\", "
+		       "\"size\": %zu, \"iters\": %zu, \"samples\": %u, "
+		       "\"median_ns\": %.1f, \"p10_ns\": %.1f, "
+		       "\"p90_ns\": %.1f, \"gbps\": %.4f, "
+		       "\"median_cycles\": %.1f, \"cpb\": %.3f",
+		       first ? "" : ",\n", eng->name, alg->name, msg_len,
+		       res->iters, res->samples, res->median_ns, res->p10_ns,
+		       res->p90_ns, gbps, res->median_cycles, cpb);
+		if (perf_mode)
+			print_counters(fmt, alg, msg_len, res);
+		printf("}");
+		break;
+	default:
+		printf("%-20s %-9s %10zu %14.1f %14.1f %14.1f %9.3f ",
+		       eng->name, alg->name, msg_len, res->median_ns,
+		       res->p10_ns, res->p90_ns, gbps);
+		if (have_cycles && msg_len)
+			printf("%9.2f\n", cpb);
+		else
+			printf("%9s\n", "-");
+		if (perf_mode)
+			print_counters(fmt, alg, msg_len, res);
+		break;
+	}
+}
+
+static void
+print_lat_header(enum bench_fmt fmt)
+{
+	const char *unit = have_cycles ? "cycles" : "ns";
+
+	switch (fmt) {
+	case BENCH_FMT_CSV:
+		printf("engine,alg,size,runs,unit,min,median,p99,max,jitter,"
+		       "t,leak\n");
+		break;
+	case BENCH_FMT_JSON:
+		printf("[\n");
+		break;
+	default:
+		printf("%-20s %-9s %10s %8s %10s %10s %10s %10s %10s %8s\n",
+		       "engine", "alg", "size", "runs", "min", "median",
+		       "p99", "max", "jitter", "t");
+		printf("(%s per call, t is fixed vs random input, |t| > %.1f "
+		       "is marked with !)\n", unit, BENCH_LAT_T_MAX);
+		break;
+	}
+}
+
+static void
+print_lat_result(enum bench_fmt fmt, int first, const k1600_engine_t *eng,
+		 const struct bench_alg *alg, size_t msg_len,
+		 const struct bench_lat_result *res)
+{
+	const char *unit = have_cycles ? "cycles" : "ns";
+	int leak = fabs(res->t) > BENCH_LAT_T_MAX;
+
+	switch (fmt) {
+	case BENCH_FMT_CSV:
+		printf("%s,%s,%zu,%u,%s,%.0f,%.0f,%.0f,%.0f,%.0f,%.2f,%i\n",
+		       eng->name, alg->name, msg_len, res->runs, unit,
+		       res->min, res->median, res->p99, res->max,
+		       res->jitter, res->t, leak);
+		break;
+	case BENCH_FMT_JSON:
+		printf("%s  {\"engine\": \"%s\", \"alg\": \"%s\", "
+		       "\"size\": %zu, \"runs\": %u, \"unit\": \"%s\", "
+		       "\"min\": %.0f, \"median\": %.0f, \"p99\": %.0f, "
+		       "\"max\": %.0f, \"jitter\": %.0f, \"t\": %.2f, "
+		       "\"leak\": %s}",
+		       first ? "" : ",\n", eng->name, alg->name, msg_len,
+		       res->runs, unit, res->min, res->median, res->p99,
+		       res->max, res->jitter, res->t, leak ? "true" : "false");
+		break;
+	default:
+		printf("%-20s %-9s %10zu %8u %10.0f %10.0f %10.0f %10.0f "
+		       "%10.0f %8.2f%s\n", eng->name, alg->name, msg_len,
+		       res->runs, res->min, res->median, res->p99, res->max,
+		       res->jitter, res->t, leak ? " !" : "");
+		break;
+	}
+}
+
+static void
+usage(const char *prog)
+{
+	fprintf(stderr,
+		"Usage: %s [-f text|csv|json] [-e engine] [-a alg] [-c cpu]\n"
+		"          [-m max_size] [-n samples] [-p] [-l size [-r runs]]\n"
+		"  -f  Output format (default text)\n"
+		"  -e  Only benchmark this engine (default all supported)\n"
+		"  -a  Only benchmark this algorithm (sha3-256, sha3-512,\n"
+		"      shake128, shake256)\n"
+		"  -c  Pin to this cpu, -1 to not pin (default the current one)\n"
+		"  -m  Largest message size in bytes (default %lu)\n"
+		"  -n  Samples per measurement (default %u, max %u)\n"
+		"  -p  Also report performance counters\n"
+		"  -l  Latency mode, time each call separately for this\n"
+		"      message size, and compare fixed / random input\n"
+		"  -r  Calls per measurement in latency mode (default %u)\n",
+		prog, BENCH_MAX_SIZE, BENCH_DEFAULT_SAMPLES,
+		BENCH_DEFAULT_SAMPLES * 8, BENCH_LAT_DEFAULT_RUNS);
+}
+
+
+/*************\
+* ENTRY POINT *
+\*************/
+
+static int
+bench_lat_main(enum bench_fmt fmt, const char *eng_name, const char *alg_name,
+	       size_t msg_len, unsigned int runs)
+{
+	struct bench_lat_result res = { 0 };
+	uint8_t *fixed = NULL;
+	uint8_t *msg = NULL;
+	int first = 1;
+	int ret = 0;
+	int i = 0;
+	int j = 0;
+
+	/* The fixed class is all zeroes, + 1 so that we
+	 * don't ask for 0 bytes */
+	fixed = calloc(1, msg_len + 1);
+	msg = malloc(msg_len + 1);
+	if (!fixed || !msg) {
+		fprintf(stderr, "Couldn't allocate %zu bytes\n", msg_len);
+		free(fixed);
+		free(msg);
+		return 1;
+	}
+
+	print_lat_header(fmt);
+
+	for (i = 0; keccakf1600_engines[i] != NULL && !ret; i++) {
+		if (eng_name && strcmp(keccakf1600_engines[i]->name, eng_name))
+			continue;
+		if (!keccakf1600_engine_supported(keccakf1600_engines[i]))
+			continue;
+
+		for (j = 0; bench_algs[j].name != NULL; j++) {
+			if (alg_name && strcmp(bench_algs[j].name, alg_name))
+				continue;
+
+			if (bench_lat_run(keccakf1600_engines[i],
+					  &bench_algs[j], fixed, msg, msg_len,
+					  runs, &res)) {
+				fprintf(stderr, "Couldn't allocate %u runs\n",
+					runs);
+				ret = 1;
+				break;
+			}
+			print_lat_result(fmt, first, keccakf1600_engines[i],
+					 &bench_algs[j], msg_len, &res);
+			first = 0;
+			fflush(stdout);
+		}
+	}
+
+	print_footer(fmt);
+	free(fixed);
+	free(msg);
+
+	return ret;
+}
+
+int
+main(int argc, char *argv[])
+{
+	struct bench_result res = { 0 };
+	enum bench_fmt fmt = BENCH_FMT_TEXT;
+	const char *eng_name = NULL;
+	const char *alg_name = NULL;
+	unsigned int samples = BENCH_DEFAULT_SAMPLES;
+	size_t max_size = BENCH_MAX_SIZE;
+	size_t msg_len = 0;
+	size_t lat_size = 0;
+	unsigned int lat_runs = BENCH_LAT_DEFAULT_RUNS;
+	uint8_t *msg = NULL;
+	int lat_mode = 0;
+	int cpu = sched_getcpu();
+	int first = 1;
+	int opt = 0;
+	int i = 0;
+	int j = 0;
+
+	while ((opt = getopt(argc, argv, "f:e:a:c:m:n:pl:r:h")) != -1) {
+		switch (opt) {
+		case 'f':
+			if (!strcmp(optarg, "csv"))
+				fmt = BENCH_FMT_CSV;
+			else if (!strcmp(optarg, "json"))
+				fmt = BENCH_FMT_JSON;
+			else if (!strcmp(optarg, "text"))
+				fmt = BENCH_FMT_TEXT;
+			else {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'e':
+			eng_name = optarg;
+			break;
+		case 'a':
+			alg_name = optarg;
+			break;
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+		case 'm':
+			max_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			samples = atoi(optarg);
+			if (samples < 1 || samples > BENCH_DEFAULT_SAMPLES * 8) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		case 'p':
+			perf_mode = 1;
+			break;
+		case 'l':
+			lat_mode = 1;
+			lat_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			lat_runs = strtoul(optarg, NULL, 0);
+			if (lat_runs < 2 || lat_runs > BENCH_LAT_MAX_RUNS) {
+				usage(argv[0]);
+				return 1;
+			}
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (eng_name && !keccakf1600_get_engine(eng_name)) {
+		fprintf(stderr, "Unknown engine: %s\n", eng_name);
+		return 1;
+	}
+
+	if (cpu >= 0 && pin_cpu(cpu))
+		fprintf(stderr, "Couldn't pin to cpu %i\n", cpu);
+
+	have_cycles = probe_cycles();
+
+	if (lat_mode)
+		return bench_lat_main(fmt, eng_name, alg_name, lat_size,
+				      lat_runs);
+
+	if (perf_mode && !counters_open())
+		fprintf(stderr, "No performance counters available\n");
+
+	/* Random-ish contents, malloc + 1 so that
+	 * we don't ask for 0 bytes */
+	msg = malloc(max_size + 1);
+	if (!msg) {
+		fprintf(stderr, "Couldn't allocate %zu bytes\n", max_size);
+		return 1;
+	}
+	for (msg_len = 0; msg_len < max_size; msg_len++)
+		msg[msg_len] = (uint8_t) (msg_len * 0x9D + 0x3B);
+
+	print_header(fmt);
+
+	for (i = 0; keccakf1600_engines[i] != NULL; i++) {
+		if (eng_name && strcmp(keccakf1600_engines[i]->name, eng_name))
+			continue;
+		if (!keccakf1600_engine_supported(keccakf1600_engines[i]))
+			continue;
+
+		for (j = 0; bench_algs[j].name != NULL; j++) {
+			if (alg_name && strcmp(bench_algs[j].name, alg_name))
+				continue;
+
+			/* 0, 1, 4, 16 ... max_size */
+			for (msg_len = 0; msg_len <= max_size;
+			     msg_len = msg_len ? msg_len * 4 : 1) {
+				bench_run(keccakf1600_engines[i], &bench_algs[j],
+					  msg, msg_len, samples, &res);
+				print_result(fmt, first, keccakf1600_engines[i],
+					     &bench_algs[j], msg_len, &res);
+				first = 0;
+				fflush(stdout);
+			}
+		}
+	}
+
+	print_footer(fmt);
+	if (perf_mode)
+		counters_close();
+	free(msg);
+
+	return 0;
+}
@@ -0,0 +1,1364 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 C / RV64 Implementation - Known answer / differential tests
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include <stdio.h>	/* For printf() */
+#include <stdlib.h>	/* For malloc() / strtoull() */
+#include <stdarg.h>	/* For va_list */
+#include <string.h>	/* For memcmp() */
+#include "keccak1600.h"
+#include "k12.h"
+#include "kmac.h"
+#include "merkle.h"
+#include "sha3_svc.h"
+
+/*
+ * Seven sets of checks, each one on every engine the cpu supports
+ * (except for the service, that runs on the engines the dispatcher
+ * picked):
+ *
+ * Known answers: The SHA3 / SHAKE examples published by NIST (short
+ * messages, the 200 x 0xA3 one and a million 'a's) and Keccak-256,
+ * through the sponge of each single state engine and through each
+ * multi-buffer engine.
+ *
+ * Permutations: Random states through Keccak-p[1600, nr] for every nr
+ * the engine can do, against keccakp1600_state_permute_ref. Engines
+ * with their own state encoding (e.g. lane complementing) get the
+ * state imported before and exported after, same as the sponge does.
+ * Multi-buffer engines get a different state on each way.
+ *
+ * Sponge: Every message length from 0 to KAT_SPONGE_BLOCKS blocks, on
+ * a few rates and with 24 / 12 rounds, against the reference engine.
+ * The input is misaligned and split in two updates, and we squeeze
+ * more than a block (to a misaligned output) in two calls, then the
+ * same through the one-shot API (single block fast path included).
+ * Multi-buffer engines get a different message on each way, both
+ * one-shot and incremental. We also clone a context after a random
+ * prefix and continue each copy with a different message.
+ *
+ * SP 800-185: The cSHAKE / KMAC samples published by NIST, with each
+ * engine as the default one, and KMAC on a cloned keyed context.
+ *
+ * KangarooTwelve: The TurboSHAKE128 / KT128 test vectors of RFC 9861,
+ * with each engine as the default one. These include customization
+ * strings, messages just below / at the 8KB chunk size and messages
+ * of many chunks, and KT128 runs on one and on a few threads. Each
+ * multi-buffer engine also hashes a few chunks as K12 leaves, against
+ * the reference engine.
+ *
+ * Merkle: Trees of a few sizes (odd levels included) over chunks of
+ * random lengths, with each engine as the default one, built with one
+ * and with a few threads and then with a few leaves updated, against
+ * a tree built on the reference engine. Also a two leaf tree with a
+ * known root, and a leaf over the same 64 bytes as its root node that
+ * must hash to something else.
+ *
+ * Service: A few thousand jobs with random algorithms, lengths and
+ * alignment (mostly a few common lengths so that they get grouped)
+ * through the batch hashing service, half of them with a callback,
+ * against the reference engine.
+ *
+ * Any mismatch makes us exit with 1, the random inputs are seeded
+ * from the first argument (if any) so that a failure can be repeated.
+ */
+
+#define KAT_MAX_MD		64
+#define KAT_MAX_MSG		1000000
+#define KAT_PERM_STATES		16
+#define KAT_SPONGE_BLOCKS	4
+#define KAT_SPONGE_MAX_RATE	168
+#define KAT_SPONGE_MAX_MSG	(KAT_SPONGE_BLOCKS * KAT_SPONGE_MAX_RATE)
+/* More than a block of output, squeezed in two calls */
+#define KAT_SPONGE_OUT		(2 * KAT_SPONGE_MAX_RATE + 5)
+#define KAT_SPONGE_OUT_SPLIT	7
+#define KAT_CLONE_PREFIXES	4
+/* 10032 bytes for the longest RFC 9861 output */
+#define KAT_K12_MAX_OUT		10032
+#define KAT_K12_THREADS		4
+#define KAT_MERKLE_MAX_CHUNK	300
+#define KAT_MERKLE_THREADS	4
+#define KAT_MERKLE_UPDATES	8
+#define KAT_SVC_JOBS		4096
+#define KAT_SVC_THREADS		4
+/* Only report the first few failures of each set */
+#define KAT_MAX_REPORTS		10
+
+enum kat_alg_id {
+	KAT_SHA3_224,
+	KAT_SHA3_256,
+	KAT_SHA3_384,
+	KAT_SHA3_512,
+	KAT_KECCAK_256,
+	KAT_SHAKE128,
+	KAT_SHAKE256,
+};
+
+struct kat_alg {
+	const char *name;
+	size_t rate_bytes;
+	size_t md_len;
+	uint8_t delim;
+};
+
+static const struct kat_alg kat_algs[] = {
+	[KAT_SHA3_224] = { "SHA3-224", 144, 28, 0x06 },
+	[KAT_SHA3_256] = { "SHA3-256", 136, 32, 0x06 },
+	[KAT_SHA3_384] = { "SHA3-384", 104, 48, 0x06 },
+	[KAT_SHA3_512] = { "SHA3-512", 72, 64, 0x06 },
+	[KAT_KECCAK_256] = { "Keccak-256", 136, 32, 0x01 },
+	[KAT_SHAKE128] = { "SHAKE128", 168, 64, 0x1F },
+	[KAT_SHAKE256] = { "SHAKE256", 136, 64, 0x1F },
+};
+
+enum kat_msg_id {
+	KAT_MSG_EMPTY,
+	KAT_MSG_ABC,
+	KAT_MSG_448,
+	KAT_MSG_896,
+	KAT_MSG_A3,
+	KAT_MSG_MILLION_A,
+	KAT_NUM_MSGS,
+};
+
+/* Each message is pattern, repeated repeat times */
+struct kat_msg {
+	const char *name;
+	const char *pattern;
+	size_t repeat;
+};
+
+static const struct kat_msg kat_msgs[] = {
+	[KAT_MSG_EMPTY] = { "empty string", "", 1 },
+	[KAT_MSG_ABC] = { "\"abc\"", "abc", 1 },
+	[KAT_MSG_448] = { "448 bits",
+		"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1 },
+	[KAT_MSG_896] = { "896 bits",
+		"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmn"
+		"hijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu", 1 },
+	[KAT_MSG_A3] = { "200 x 0xA3", "\xA3", 200 },
+	[KAT_MSG_MILLION_A] = { "1mil 'a's", "a", 1000000 },
+};
+
+struct kat_vector {
+	enum kat_alg_id alg;
+	enum kat_msg_id msg;
+	const char *md_hex;
+};
+
+static const struct kat_vector kat_vectors[] = {
+	{ KAT_SHA3_224, KAT_MSG_EMPTY,
+	  "6B4E03423667DBB73B6E15454F0EB1ABD4597F9A1B078E3F5B5A6BC7" },
+	{ KAT_SHA3_224, KAT_MSG_ABC,
+	  "E642824C3F8CF24AD09234EE7D3C766FC9A3A5168D0C94AD73B46FDF" },
+	{ KAT_SHA3_224, KAT_MSG_448,
+	  "8A24108B154ADA21C9FD5574494479BA5C7E7AB76EF264EAD0FCCE33" },
+	{ KAT_SHA3_224, KAT_MSG_896,
+	  "543E6868E1666C1A643630DF77367AE5A62A85070A51C14CBF665CBC" },
+	{ KAT_SHA3_224, KAT_MSG_A3,
+	  "9376816ABA503F72F96CE7EB65AC095DEEE3BE4BF9BBC2A1CB7E11E0" },
+	{ KAT_SHA3_224, KAT_MSG_MILLION_A,
+	  "D69335B93325192E516A912E6D19A15CB51C6ED5C15243E7A7FD653C" },
+	{ KAT_SHA3_256, KAT_MSG_EMPTY,
+	  "A7FFC6F8BF1ED76651C14756A061D662F580FF4DE43B49FA82D80A4B80F8434A" },
+	{ KAT_SHA3_256, KAT_MSG_ABC,
+	  "3A985DA74FE225B2045C172D6BD390BD855F086E3E9D525B46BFE24511431532" },
+	{ KAT_SHA3_256, KAT_MSG_448,
+	  "41C0DBA2A9D6240849100376A8235E2C82E1B9998A999E21DB32DD97496D3376" },
+	{ KAT_SHA3_256, KAT_MSG_896,
+	  "916F6061FE879741CA6469B43971DFDB28B1A32DC36CB3254E812BE27AAD1D18" },
+	{ KAT_SHA3_256, KAT_MSG_A3,
+	  "79F38ADEC5C20307A98EF76E8324AFBFD46CFD81B22E3973C65FA1BD9DE31787" },
+	{ KAT_SHA3_256, KAT_MSG_MILLION_A,
+	  "5C8875AE474A3634BA4FD55EC85BFFD661F32ACA75C6D699D0CDCB6C115891C1" },
+	{ KAT_SHA3_384, KAT_MSG_EMPTY,
+	  "0C63A75B845E4F7D01107D852E4C2485C51A50AAAA94FC61995E71BBEE983A2A"
+	  "C3713831264ADB47FB6BD1E058D5F004" },
+	{ KAT_SHA3_384, KAT_MSG_ABC,
+	  "EC01498288516FC926459F58E2C6AD8DF9B473CB0FC08C2596DA7CF0E49BE4B2"
+	  "98D88CEA927AC7F539F1EDF228376D25" },
+	{ KAT_SHA3_384, KAT_MSG_448,
+	  "991C665755EB3A4B6BBDFB75C78A492E8C56A22C5C4D7E429BFDBC32B9D4AD5A"
+	  "A04A1F076E62FEA19EEF51ACD0657C22" },
+	{ KAT_SHA3_384, KAT_MSG_896,
+	  "79407D3B5916B59C3E30B09822974791C313FB9ECC849E406F23592D04F625DC"
+	  "8C709B98B43B3852B337216179AA7FC7" },
+	{ KAT_SHA3_384, KAT_MSG_A3,
+	  "1881DE2CA7E41EF95DC4732B8F5F002B189CC1E42B74168ED1732649CE1DBCDD"
+	  "76197A31FD55EE989F2D7050DD473E8F" },
+	{ KAT_SHA3_384, KAT_MSG_MILLION_A,
+	  "EEE9E24D78C1855337983451DF97C8AD9EEDF256C6334F8E948D252D5E0E7684"
+	  "7AA0774DDB90A842190D2C558B4B8340" },
+	{ KAT_SHA3_512, KAT_MSG_EMPTY,
+	  "A69F73CCA23A9AC5C8B567DC185A756E97C982164FE25859E0D1DCC1475C80A6"
+	  "15B2123AF1F5F94C11E3E9402C3AC558F500199D95B6D3E301758586281DCD26" },
+	{ KAT_SHA3_512, KAT_MSG_ABC,
+	  "B751850B1A57168A5693CD924B6B096E08F621827444F70D884F5D0240D2712E"
+	  "10E116E9192AF3C91A7EC57647E3934057340B4CF408D5A56592F8274EEC53F0" },
+	{ KAT_SHA3_512, KAT_MSG_448,
+	  "04A371E84ECFB5B8B77CB48610FCA8182DD457CE6F326A0FD3D7EC2F1E91636D"
+	  "EE691FBE0C985302BA1B0D8DC78C086346B533B49C030D99A27DAF1139D6E75E" },
+	{ KAT_SHA3_512, KAT_MSG_896,
+	  "AFEBB2EF542E6579C50CAD06D2E578F9F8DD6881D7DC824D26360FEEBF18A4FA"
+	  "73E3261122948EFCFD492E74E82E2189ED0FB440D187F382270CB455F21DD185" },
+	{ KAT_SHA3_512, KAT_MSG_A3,
+	  "E76DFAD22084A8B1467FCF2FFA58361BEC7628EDF5F3FDC0E4805DC48CAEECA8"
+	  "1B7C13C30ADF52A3659584739A2DF46BE589C51CA1A4A8416DF6545A1CE8BA00" },
+	{ KAT_SHA3_512, KAT_MSG_MILLION_A,
+	  "3C3A876DA14034AB60627C077BB98F7E120A2A5370212DFFB3385A18D4F38859"
+	  "ED311D0A9D5141CE9CC5C66EE689B266A8AA18ACE8282A0E0DB596C90B0A7B87" },
+	{ KAT_KECCAK_256, KAT_MSG_EMPTY,
+	  "C5D2460186F7233C927E7DB2DCC703C0E500B653CA82273B7BFAD8045D85A470" },
+	{ KAT_KECCAK_256, KAT_MSG_ABC,
+	  "4E03657AEA45A94FC7D47BA826C8D667C0D1E6E33A64A036EC44F58FA12D6C45" },
+	{ KAT_SHAKE128, KAT_MSG_EMPTY,
+	  "7F9C2BA4E88F827D616045507605853ED73B8093F6EFBC88EB1A6EACFA66EF26"
+	  "3CB1EEA988004B93103CFB0AEEFD2A686E01FA4A58E8A3639CA8A1E3F9AE57E2" },
+	{ KAT_SHAKE128, KAT_MSG_ABC,
+	  "5881092DD818BF5CF8A3DDB793FBCBA74097D5C526A6D35F97B83351940F2CC8"
+	  "44C50AF32ACD3F2CDD066568706F509BC1BDDE58295DAE3F891A9A0FCA578378" },
+	{ KAT_SHAKE128, KAT_MSG_448,
+	  "1A96182B50FB8C7E74E0A707788F55E98209B8D91FADE8F32F8DD5CFF7BF21F5"
+	  "4EE5F19550825A6E070030519E944263AC1C6765287065621F9FCB3201723E32" },
+	{ KAT_SHAKE128, KAT_MSG_896,
+	  "7B6DF6FF181173B6D7898D7FF63FB07B7C237DAF471A5AE5602ADBCCEF9CCF4B"
+	  "37E06B4A3543164FFBE0D0557C02F9B25AD434005526D88CA04A6094B93EE57A" },
+	{ KAT_SHAKE128, KAT_MSG_A3,
+	  "131AB8D2B594946B9C81333F9BB6E0CE75C3B93104FA3469D3917457385DA037"
+	  "CF232EF7164A6D1EB448C8908186AD852D3F85A5CF28DA1AB6FE343817197846" },
+	{ KAT_SHAKE128, KAT_MSG_MILLION_A,
+	  "9D222C79C4FF9D092CF6CA86143AA411E369973808EF97093255826C5572EF58"
+	  "424C4B5C28475FFDCF981663867FEC6321C1262E387BCCF8CA676884C4A9D0C1" },
+	{ KAT_SHAKE256, KAT_MSG_EMPTY,
+	  "46B9DD2B0BA88D13233B3FEB743EEB243FCD52EA62B81B82B50C27646ED5762F"
+	  "D75DC4DDD8C0F200CB05019D67B592F6FC821C49479AB48640292EACB3B7C4BE" },
+	{ KAT_SHAKE256, KAT_MSG_ABC,
+	  "483366601360A8771C6863080CC4114D8DB44530F8F1E1EE4F94EA37E78B5739"
+	  "D5A15BEF186A5386C75744C0527E1FAA9F8726E462A12A4FEB06BD8801E751E4" },
+	{ KAT_SHAKE256, KAT_MSG_448,
+	  "4D8C2DD2435A0128EEFBB8C36F6F87133A7911E18D979EE1AE6BE5D4FD2E3329"
+	  "40D8688A4E6A59AA8060F1F9BC996C05ACA3C696A8B66279DC672C740BB224EC" },
+	{ KAT_SHAKE256, KAT_MSG_896,
+	  "98BE04516C04CC73593FEF3ED0352EA9F6443942D6950E29A372A681C3DEAF45"
+	  "35423709B02843948684E029010BADCC0ACD8303FC85FDAD3EABF4F78CAE1656" },
+	{ KAT_SHAKE256, KAT_MSG_A3,
+	  "CD8A920ED141AA0407A22D59288652E9D9F1A7EE0C1E7C1CA699424DA84A904D"
+	  "2D700CAAE7396ECE96604440577DA4F3AA22AEB8857F961C4CD8E06F0AE6610B" },
+	{ KAT_SHAKE256, KAT_MSG_MILLION_A,
+	  "3578A7A4CA9137569CDF76ED617D31BB994FCA9C1BBF8B184013DE8234DFD13A"
+	  "3FD124D4DF76C0A539EE7DD2F6E1EC346124C815D9410E145EB561BCD97B18AB" },
+	{ 0, 0, NULL }
+};
+
+/* Same order as enum sha3_svc_alg, SHAKE jobs get a random output length */
+static const struct kat_alg kat_svc_algs[SHA3_SVC_NUM_ALGS] = {
+	[SHA3_SVC_SHA3_224] = { "SHA3-224", 144, 28, 0x06 },
+	[SHA3_SVC_SHA3_256] = { "SHA3-256", 136, 32, 0x06 },
+	[SHA3_SVC_SHA3_384] = { "SHA3-384", 104, 48, 0x06 },
+	[SHA3_SVC_SHA3_512] = { "SHA3-512", 72, 64, 0x06 },
+	[SHA3_SVC_SHAKE128] = { "SHAKE128", 168, 0, 0x1F },
+	[SHA3_SVC_SHAKE256] = { "SHAKE256", 136, 0, 0x1F },
+	[SHA3_SVC_KECCAK_256] = { "Keccak-256", 136, 32, 0x01 },
+	[SHA3_SVC_KECCAK_512] = { "Keccak-512", 72, 64, 0x01 },
+};
+
+struct kat_sp800_185_vector {
+	const char *name;
+	/* 128 or 256 */
+	unsigned int strength;
+	int kmac;
+	/* Message / key are 00 01 02 ... / 40 41 42 ... */
+	size_t msg_len;
+	size_t key_len;
+	const char *custom;
+	const char *out_hex;
+};
+
+static const struct kat_sp800_185_vector kat_sp800_185_vectors[] = {
+	{ "cSHAKE128 sample 1", 128, 0, 4, 0, "Email Signature",
+	  "C1C36925B6409A04F1B504FCBCA9D82B4017277CB5ED2B2065FC1D3814D5AAF5" },
+	{ "cSHAKE128 sample 2", 128, 0, 200, 0, "Email Signature",
+	  "C5221D50E4F822D96A2E8881A961420F294B7B24FE3D2094BAED2C6524CC166B" },
+	{ "KMAC128 sample 1", 128, 1, 4, 32, "",
+	  "E5780B0D3EA6F7D3A429C5706AA43A00FADBD7D49628839E3187243F456EE14E" },
+	{ "KMAC128 sample 2", 128, 1, 4, 32, "My Tagged Application",
+	  "3B1FBA963CD8B0B59E8C1A6D71888B7143651AF8BA0A7070C0979E2811324AA5" },
+	{ "KMAC128 sample 3", 128, 1, 200, 32, "My Tagged Application",
+	  "1F5B4E6CCA02209E0DCB5CA635B89A15E271ECC760071DFD805FAA38F9729230" },
+	{ "KMAC256 sample 4", 256, 1, 4, 32, "My Tagged Application",
+	  "20C570C31346F703C9AC36C61C03CB64C3970D0CFC787E9B79599D273A68D2F7"
+	  "F69D4CC3DE9D104A351689F27CF6F5951F0103F33F4F24871024D9C27773A8DD" },
+	{ NULL, 0, 0, 0, 0, NULL, NULL }
+};
+
+/* RFC 9861 test vectors, ptn(n) is n bytes of 00 01 .. FA repeated */
+struct kat_k12_vector {
+	const char *name;
+	/* KT128, or TurboSHAKE128 with the given domain */
+	int k12;
+	/* Message is ptn(msg_len), or msg_len x 0xFF */
+	size_t msg_len;
+	int msg_ff;
+	/* Customization string is ptn(custom_len) */
+	size_t custom_len;
+	uint8_t domain;
+	/* Only the last bytes of the output are given for the long ones */
+	size_t out_len;
+	const char *out_hex;
+};
+
+static const struct kat_k12_vector kat_k12_vectors[] = {
+	{ "TurboSHAKE128 empty, 32 bytes", 0, 0, 0, 0, 0x1F, 32,
+	  "1E415F1C5983AFF2169217277D17BB538CD945A397DDEC541F1CE41AF2C1B74C" },
+	{ "TurboSHAKE128 empty, 64 bytes", 0, 0, 0, 0, 0x1F, 64,
+	  "1E415F1C5983AFF2169217277D17BB538CD945A397DDEC541F1CE41AF2C1B74C"
+	  "3E8CCAE2A4DAE56C84A04C2385C03C15E8193BDF58737363321691C05462C8DF" },
+	{ "TurboSHAKE128 empty, 10032 bytes", 0, 0, 0, 0, 0x1F, 10032,
+	  "A3B9B0385900CE761F22AED548E754DA10A5242D62E8C658E3F3A923A7555607" },
+	{ "TurboSHAKE128 ptn(17^0)", 0, 1, 0, 0, 0x1F, 32,
+	  "55CEDD6F60AF7BB29A4042AE832EF3F58DB7299F893EBB9247247D856958DAA9" },
+	{ "TurboSHAKE128 ptn(17^1)", 0, 17, 0, 0, 0x1F, 32,
+	  "9C97D036A3BAC819DB70EDE0CA554EC6E4C2A1A4FFBFD9EC269CA6A111161233" },
+	{ "TurboSHAKE128 ptn(17^2)", 0, 289, 0, 0, 0x1F, 32,
+	  "96C77C279E0126F7FC07C9B07F5CDAE1E0BE60BDBE10620040E75D7223A624D2" },
+	{ "TurboSHAKE128 ptn(17^3)", 0, 4913, 0, 0, 0x1F, 32,
+	  "D4976EB56BCF118520582B709F73E1D6853E001FDAF80E1B13E0D0599D5FB372" },
+	{ "TurboSHAKE128 ptn(17^4)", 0, 83521, 0, 0, 0x1F, 32,
+	  "DA67C7039E98BF530CF7A37830C6664E14CBAB7F540F58403B1B82951318EE5C" },
+	{ "TurboSHAKE128 ptn(17^5)", 0, 1419857, 0, 0, 0x1F, 32,
+	  "B97A906FBF83EF7C812517ABF3B2D0AEA0C4F60318CE11CF103925127F59EECD" },
+	{ "TurboSHAKE128 ptn(17^6)", 0, 24137569, 0, 0, 0x1F, 32,
+	  "35CD494ADEDED2F25239AF09A7B8EF0C4D1CA4FE2D1AC370FA63216FE7B4C2B1" },
+	{ "TurboSHAKE128 3 x FF, D 0x01", 0, 3, 1, 0, 0x01, 32,
+	  "BF323F940494E88EE1C540FE660BE8A0C93F43D15EC006998462FA994EED5DAB" },
+	{ "TurboSHAKE128 1 x FF, D 0x06", 0, 1, 1, 0, 0x06, 32,
+	  "8EC9C66465ED0D4A6C35D13506718D687A25CB05C74CCA1E42501ABD83874A67" },
+	{ "TurboSHAKE128 3 x FF, D 0x07", 0, 3, 1, 0, 0x07, 32,
+	  "B658576001CAD9B1E5F399A9F77723BBA05458042D68206F7252682DBA3663ED" },
+	{ "TurboSHAKE128 7 x FF, D 0x0B", 0, 7, 1, 0, 0x0B, 32,
+	  "8DEEAA1AEC47CCEE569F659C21DFA8E112DB3CEE37B18178B2ACD805B799CC37" },
+	{ "TurboSHAKE128 1 x FF, D 0x30", 0, 1, 1, 0, 0x30, 32,
+	  "553122E2135E363C3292BED2C6421FA232BAB03DAA07C7D6636603286506325B" },
+	{ "TurboSHAKE128 3 x FF, D 0x7F", 0, 3, 1, 0, 0x7F, 32,
+	  "16274CC656D44CEFD422395D0F9053BDA6D28E122ABA15C765E5AD0E6EAF26F9" },
+	{ "KT128 empty, 32 bytes", 1, 0, 0, 0, 0, 32,
+	  "1AC2D450FC3B4205D19DA7BFCA1B37513C0803577AC7167F06FE2CE1F0EF39E5" },
+	{ "KT128 empty, 64 bytes", 1, 0, 0, 0, 0, 64,
+	  "1AC2D450FC3B4205D19DA7BFCA1B37513C0803577AC7167F06FE2CE1F0EF39E5"
+	  "4269C056B8C82E48276038B6D292966CC07A3D4645272E31FF38508139EB0A71" },
+	{ "KT128 empty, 10032 bytes", 1, 0, 0, 0, 0, 10032,
+	  "E8DC563642F7228C84684C898405D3A834799158C079B12880277A1D28E2FF6D" },
+	{ "KT128 ptn(17^0)", 1, 1, 0, 0, 0, 32,
+	  "2BDA92450E8B147F8A7CB629E784A058EFCA7CF7D8218E02D345DFAA65244A1F" },
+	{ "KT128 ptn(17^1)", 1, 17, 0, 0, 0, 32,
+	  "6BF75FA2239198DB4772E36478F8E19B0F371205F6A9A93A273F51DF37122888" },
+	{ "KT128 ptn(17^2)", 1, 289, 0, 0, 0, 32,
+	  "0C315EBCDEDBF61426DE7DCF8FB725D1E74675D7F5327A5067F367B108ECB67C" },
+	{ "KT128 ptn(17^3)", 1, 4913, 0, 0, 0, 32,
+	  "CB552E2EC77D9910701D578B457DDF772C12E322E4EE7FE417F92C758F0D59D0" },
+	{ "KT128 ptn(17^4)", 1, 83521, 0, 0, 0, 32,
+	  "8701045E22205345FF4DDA05555CBB5C3AF1A771C2B89BAEF37DB43D9998B9FE" },
+	{ "KT128 ptn(17^5)", 1, 1419857, 0, 0, 0, 32,
+	  "844D610933B1B9963CBDEB5AE3B6B05CC7CBD67CEEDF883EB678A0A8E0371682" },
+	{ "KT128 ptn(17^6)", 1, 24137569, 0, 0, 0, 32,
+	  "3C390782A8A4E89FA6367F72FEAAF13255C8D95878481D3CD8CE85F58E880AF8" },
+	{ "KT128 empty, C ptn(41^0)", 1, 0, 0, 1, 0, 32,
+	  "FAB658DB63E94A246188BF7AF69A133045F46EE984C56E3C3328CAAF1AA1A583" },
+	{ "KT128 empty, C ptn(41^1)", 1, 0, 0, 41, 0, 32,
+	  "76F06E60FBA37414E0DC56D9D1E5D03B2D38C672B70C8C51D2E00A4FA959F1AA" },
+	{ "KT128 empty, C ptn(41^2)", 1, 0, 0, 1681, 0, 32,
+	  "FD04579597AB534921E87FBC5B88CE4AF833DA107E8D3514B999648CDDFD56DE" },
+	{ "KT128 empty, C ptn(41^3)", 1, 0, 0, 68921, 0, 32,
+	  "D61D5C064508CE4B120F6D86B8B3D41E516B7E619564FE8FA4F9D7D0D081942F" },
+	{ "KT128 1 x FF, C ptn(41^1)", 1, 1, 1, 41, 0, 32,
+	  "D848C5068CED736F4462159B9867FD4C20B808ACC3D5BC48E0B06BA0A3762EC4" },
+	{ "KT128 3 x FF, C ptn(41^2)", 1, 3, 1, 1681, 0, 32,
+	  "C389E5009AE57120854C2E8C64670AC01358CF4C1BAF89447A724234DC7CED74" },
+	{ "KT128 7 x FF, C ptn(41^3)", 1, 7, 1, 68921, 0, 32,
+	  "75D2F86A2E644566726B4FBCFC5657B9DBCF070C7B0DCA06450AB291D7443BCF" },
+	{ "KT128 ptn(8191)", 1, 8191, 0, 0, 0, 32,
+	  "1B577636F723643E990CC7D6A659837436FD6A103626600EB8301CD1DBE553D6" },
+	{ "KT128 ptn(8192)", 1, 8192, 0, 0, 0, 32,
+	  "48F256F6772F9EDFB6A8B661EC92DC93B95EBD05A08A17B39AE3490870C926C3" },
+	{ "KT128 ptn(8192), C ptn(8189)", 1, 8192, 0, 8189, 0, 32,
+	  "3ED12F70FB05DDB58689510AB3E4D23C6C6033849AA01E1D8C220A297FEDCD0B" },
+	{ "KT128 ptn(8192), C ptn(8190)", 1, 8192, 0, 8190, 0, 32,
+	  "6A7C1B6A5CD0D8C9CA943A4A216CC64604559A2EA45F78570A15253D67BA00AE" },
+	{ NULL, 0, 0, 0, 0, 0, 0, NULL }
+};
+
+struct kat_sponge_cfg {
+	size_t rate_bytes;
+	unsigned int nr;
+};
+
+/* SHA3-512, SHA3-256 / SHAKE256, SHAKE128 and TurboSHAKE128 */
+static const struct kat_sponge_cfg kat_sponge_cfgs[] = {
+	{ 72, 24 },
+	{ 136, 24 },
+	{ 168, 24 },
+	{ 168, 12 },
+	{ 0, 0 }
+};
+
+static const size_t kat_merkle_sizes[] = { 1, 2, 3, 5, 8, 17, 64, 65, 1000, 0 };
+/* Root of the tree over "abc" and "", the node over SHA3-256("abc")
+ * and SHA3-256(""), it must not match a leaf over the same 64 bytes */
+static const char kat_merkle_root_hex[] =
+	"94ee303299e50c78ce61a73d4ebf3021ceba63cc77af35aa1a1731264d809fdb";
+
+struct kat_set {
+	const char *name;
+	unsigned int checks;
+	unsigned int failures;
+};
+
+static uint64_t kat_rng = 0x9E3779B97F4A7C15ULL;
+
+
+/*********\
+* HELPERS *
+\*********/
+
+/* xorshift64*, more than enough for test inputs */
+static uint64_t
+kat_rand(void)
+{
+	kat_rng ^= kat_rng >> 12;
+	kat_rng ^= kat_rng << 25;
+	kat_rng ^= kat_rng >> 27;
+	return kat_rng * 0x2545F4914F6CDD1DULL;
+}
+
+static void
+kat_rand_bytes(uint8_t *buf, size_t len)
+{
+	size_t i = 0;
+
+	for (i = 0; i < len; i++)
+		buf[i] = kat_rand() >> 56;
+}
+
+static size_t
+kat_unhex(const char *hex, uint8_t *out)
+{
+	unsigned int byte = 0;
+	size_t len = 0;
+
+	for (len = 0; hex[2 * len] != '\0'; len++) {
+		sscanf(hex + 2 * len, "%2x", &byte);
+		out[len] = byte;
+	}
+
+	return len;
+}
+
+static size_t
+kat_msg_build(const struct kat_msg *msg, uint8_t *buf)
+{
+	size_t pattern_len = strlen(msg->pattern);
+	size_t i = 0;
+
+	for (i = 0; i < msg->repeat; i++)
+		memcpy(buf + i * pattern_len, msg->pattern, pattern_len);
+
+	return pattern_len * msg->repeat;
+}
+
+static void
+kat_result(struct kat_set *set, int ok, const char *eng_name,
+	   const char *fmt, ...)
+{
+	va_list args;
+
+	set->checks++;
+	if (ok)
+		return;
+
+	if (set->failures++ < KAT_MAX_REPORTS) {
+		printf("FAIL: %s: %s, ", set->name, eng_name);
+		va_start(args, fmt);
+		vprintf(fmt, args);
+		va_end(args);
+		printf("\n");
+	}
+}
+
+/* Output of the reference engine for the sponge checks */
+static void
+kat_sponge_ref(const struct kat_sponge_cfg *cfg, const uint8_t *msg,
+	       size_t msg_len, uint8_t *out, size_t out_len)
+{
+	k1600_ctx_t ctx;
+
+	keccakp1600_init(&ctx, &keccakf1600_engine_ref, cfg->nr,
+			 cfg->rate_bytes, 0, 0x1F);
+	keccakf1600_update(&ctx, msg, msg_len);
+	keccakf1600_xof_squeeze(&ctx, out, out_len);
+}
+
+
+/***************\
+* KNOWN ANSWERS *
+\***************/
+
+static void
+kat_check_vectors(const k1600_engine_t *eng, uint8_t *const msgs[],
+		  const size_t msg_lens[], struct kat_set *set)
+{
+	const struct kat_vector *vec = NULL;
+	const struct kat_alg *alg = NULL;
+	uint8_t expected[KAT_MAX_MD] = { 0 };
+	uint8_t md[KAT_MAX_MD] = { 0 };
+	k1600_ctx_t ctx;
+
+	for (vec = kat_vectors; vec->md_hex != NULL; vec++) {
+		alg = &kat_algs[vec->alg];
+		kat_unhex(vec->md_hex, expected);
+		keccakp1600_init(&ctx, eng, KECCAK1600_NUM_ROUNDS,
+				 alg->rate_bytes, alg->md_len, alg->delim);
+		keccakf1600_update(&ctx, msgs[vec->msg], msg_lens[vec->msg]);
+		keccakf1600_final(&ctx, md);
+		kat_result(set, !memcmp(md, expected, alg->md_len), eng->name,
+			   "%s of %s", alg->name, kat_msgs[vec->msg].name);
+	}
+}
+
+static void
+kat_check_vectors_mb(const k1600_mb_engine_t *eng, uint8_t *const msgs[],
+		     const size_t msg_lens[], struct kat_set *set)
+{
+	uint8_t md[KECCAK1600_MAX_WAYS][KAT_MAX_MD];
+	const void *way_msgs[KECCAK1600_MAX_WAYS] = { 0 };
+	void *way_mds[KECCAK1600_MAX_WAYS] = { 0 };
+	const struct kat_vector *vec = NULL;
+	const struct kat_alg *alg = NULL;
+	uint8_t expected[KAT_MAX_MD] = { 0 };
+	unsigned int i = 0;
+	int ok = 0;
+
+	for (vec = kat_vectors; vec->md_hex != NULL; vec++) {
+		alg = &kat_algs[vec->alg];
+		kat_unhex(vec->md_hex, expected);
+		for (i = 0; i < eng->ways; i++) {
+			way_msgs[i] = msgs[vec->msg];
+			way_mds[i] = md[i];
+		}
+		memset(md, 0, sizeof(md));
+		keccakp1600_oneshot_mb(eng, KECCAK1600_NUM_ROUNDS,
+				       alg->rate_bytes, way_msgs,
+				       msg_lens[vec->msg], way_mds,
+				       alg->md_len, alg->delim);
+		ok = 1;
+		for (i = 0; i < eng->ways; i++)
+			ok &= !memcmp(md[i], expected, alg->md_len);
+		kat_result(set, ok, eng->name, "%s of %s", alg->name,
+			   kat_msgs[vec->msg].name);
+	}
+}
+
+
+/**************\
+* PERMUTATIONS *
+\**************/
+
+static void
+kat_check_perm(const k1600_engine_t *eng, const k1600_state_t *states,
+	       struct kat_set *set)
+{
+	k1600_state_t expected;
+	k1600_state_t st;
+	unsigned int nr = 0;
+	int i = 0;
+
+	for (i = 0; i < KAT_PERM_STATES; i++) {
+		/* nr == KECCAK1600_NUM_ROUNDS + 1 is for permute() */
+		for (nr = 0; nr <= KECCAK1600_NUM_ROUNDS + 1; nr++) {
+			if (nr <= KECCAK1600_NUM_ROUNDS && !eng->permute_rounds)
+				continue;
+
+			memcpy(&st, &states[i], sizeof(st));
+			memcpy(&expected, &states[i], sizeof(expected));
+			if (eng->state_import)
+				eng->state_import(&st, &st);
+			if (nr <= KECCAK1600_NUM_ROUNDS) {
+				eng->permute_rounds(&st, nr);
+				keccakp1600_state_permute_ref(&expected, nr);
+			} else {
+				eng->permute(&st);
+				keccakf1600_state_permute_ref(&expected);
+			}
+			if (eng->state_export)
+				eng->state_export(&st, &st);
+
+			kat_result(set, !memcmp(&st, &expected, sizeof(st)),
+				   eng->name, "state %i, %u rounds", i,
+				   nr <= KECCAK1600_NUM_ROUNDS ? nr :
+				   KECCAK1600_NUM_ROUNDS);
+		}
+	}
+}
+
+static void
+kat_check_perm_mb(const k1600_mb_engine_t *eng, const k1600_state_t *states,
+		  struct kat_set *set)
+{
+	lane_t A[KECCAK_NUM_LANES * KECCAK1600_MAX_WAYS]
+		__attribute__((aligned(64)));
+	k1600_state_t expected;
+	unsigned int nr = 0;
+	unsigned int i = 0;
+	unsigned int j = 0;
+	int ok = 0;
+
+	for (nr = 0; nr <= KECCAK1600_NUM_ROUNDS + 1; nr++) {
+		if (nr <= KECCAK1600_NUM_ROUNDS && !eng->permute_rounds)
+			continue;
+
+		for (i = 0; i < KECCAK_NUM_LANES; i++)
+			for (j = 0; j < eng->ways; j++)
+				A[i * eng->ways + j] = states[j].A[i];
+
+		if (nr <= KECCAK1600_NUM_ROUNDS)
+			eng->permute_rounds(A, nr);
+		else
+			eng->permute(A);
+
+		ok = 1;
+		for (j = 0; j < eng->ways; j++) {
+			memcpy(&expected, &states[j], sizeof(expected));
+			if (nr <= KECCAK1600_NUM_ROUNDS)
+				keccakp1600_state_permute_ref(&expected, nr);
+			else
+				keccakf1600_state_permute_ref(&expected);
+			for (i = 0; i < KECCAK_NUM_LANES; i++)
+				ok &= (A[i * eng->ways + j] == expected.A[i]);
+		}
+
+		kat_result(set, ok, eng->name, "%u rounds",
+			   nr <= KECCAK1600_NUM_ROUNDS ? nr :
+			   KECCAK1600_NUM_ROUNDS);
+	}
+}
+
+
+/********\
+* SPONGE *
+\********/
+
+static void
+kat_check_sponge(const k1600_engine_t *eng, const uint8_t *buf,
+		 struct kat_set *set)
+{
+	const struct kat_sponge_cfg *cfg = NULL;
+	uint8_t expected[KAT_SPONGE_OUT] = { 0 };
+	uint8_t out_buf[KAT_SPONGE_OUT + KECCAK1600_LANE_BYTES] = { 0 };
+	const uint8_t *msg = NULL;
+	uint8_t *out = NULL;
+	k1600_ctx_t ctx;
+	size_t msg_len = 0;
+	size_t out_len = 0;
+	size_t split = 0;
+
+	for (cfg = kat_sponge_cfgs; cfg->rate_bytes != 0; cfg++) {
+		for (msg_len = 0; msg_len <= KAT_SPONGE_BLOCKS * cfg->rate_bytes;
+		     msg_len++) {
+			/* Walk through all misalignments */
+			msg = buf + (msg_len % KECCAK1600_LANE_BYTES);
+			out = out_buf + (msg_len / KECCAK1600_LANE_BYTES) %
+				  KECCAK1600_LANE_BYTES;
+			split = msg_len / 3;
+
+			kat_sponge_ref(cfg, msg, msg_len, expected,
+				       sizeof(expected));
+
+			memset(out_buf, 0, sizeof(out_buf));
+			keccakp1600_init(&ctx, eng, cfg->nr, cfg->rate_bytes,
+					 0, 0x1F);
+			keccakf1600_update(&ctx, msg, split);
+			keccakf1600_update(&ctx, msg + split, msg_len - split);
+			keccakf1600_xof_squeeze(&ctx, out, KAT_SPONGE_OUT_SPLIT);
+			keccakf1600_xof_squeeze(&ctx, out + KAT_SPONGE_OUT_SPLIT,
+						KAT_SPONGE_OUT - KAT_SPONGE_OUT_SPLIT);
+
+			kat_result(set, !memcmp(out, expected, KAT_SPONGE_OUT),
+				   eng->name, "rate %zu, %u rounds, %zu bytes",
+				   cfg->rate_bytes, cfg->nr, msg_len);
+
+			/* One-shot, mostly with output that fits in a block
+			 * (so that short messages take the fast path) */
+			out_len = (msg_len % 4 == 3) ? KAT_SPONGE_OUT :
+				  1 + msg_len % cfg->rate_bytes;
+			memset(out_buf, 0, sizeof(out_buf));
+			keccakp1600_oneshot(eng, cfg->nr, cfg->rate_bytes, msg,
+					    msg_len, out, out_len, 0x1F);
+			kat_result(set, !memcmp(out, expected, out_len),
+				   eng->name, "rate %zu, %u rounds, %zu bytes, "
+				   "one-shot %zu bytes out", cfg->rate_bytes,
+				   cfg->nr, msg_len, out_len);
+		}
+	}
+}
+
+static void
+kat_check_sponge_mb(const k1600_mb_engine_t *eng, const uint8_t *buf,
+		    struct kat_set *set)
+{
+	uint8_t md[KECCAK1600_MAX_WAYS][KAT_SPONGE_OUT];
+	uint8_t md_inc[KECCAK1600_MAX_WAYS][KAT_SPONGE_OUT];
+	const void *way_msgs[KECCAK1600_MAX_WAYS] = { 0 };
+	void *way_mds[KECCAK1600_MAX_WAYS] = { 0 };
+	const struct kat_sponge_cfg *cfg = NULL;
+	uint8_t expected[KAT_SPONGE_OUT] = { 0 };
+	k1600_mb_ctx_t *ctx = NULL;
+	size_t msg_len = 0;
+	size_t split = 0;
+	unsigned int i = 0;
+	int ok = 0;
+
+	ctx = keccakf1600_mb_ctx_new();
+	if (!ctx) {
+		kat_result(set, 0, eng->name, "context allocation failed");
+		return;
+	}
+
+	for (cfg = kat_sponge_cfgs; cfg->rate_bytes != 0; cfg++) {
+		if (cfg->nr != KECCAK1600_NUM_ROUNDS && !eng->permute_rounds)
+			continue;
+
+		for (msg_len = 0; msg_len <= KAT_SPONGE_BLOCKS * cfg->rate_bytes;
+		     msg_len++) {
+			/* A different (and differently aligned)
+			 * message on each way */
+			for (i = 0; i < eng->ways; i++) {
+				way_msgs[i] = buf + i * (KAT_SPONGE_MAX_MSG + 1) +
+					      ((msg_len + i) % KECCAK1600_LANE_BYTES);
+				way_mds[i] = md[i];
+			}
+			split = msg_len / 3;
+			memset(md, 0, sizeof(md));
+			keccakp1600_oneshot_mb(eng, cfg->nr, cfg->rate_bytes,
+					       way_msgs, msg_len, way_mds,
+					       KAT_SPONGE_OUT, 0x1F);
+
+			/* Same through the incremental API, with the
+			 * input split in two updates and the output
+			 * squeezed in two calls */
+			memset(md_inc, 0, sizeof(md_inc));
+			keccakp1600_mb_init(ctx, eng, cfg->nr, cfg->rate_bytes,
+					    0, 0x1F);
+			keccakf1600_mb_update(ctx, way_msgs, split);
+			for (i = 0; i < eng->ways; i++) {
+				way_msgs[i] = (const uint8_t *) way_msgs[i] + split;
+				way_mds[i] = md_inc[i];
+			}
+			keccakf1600_mb_update(ctx, way_msgs, msg_len - split);
+			keccakf1600_mb_xof_squeeze(ctx, way_mds,
+						   KAT_SPONGE_OUT_SPLIT);
+			for (i = 0; i < eng->ways; i++)
+				way_mds[i] = md_inc[i] + KAT_SPONGE_OUT_SPLIT;
+			keccakf1600_mb_xof_squeeze(ctx, way_mds, KAT_SPONGE_OUT -
+						   KAT_SPONGE_OUT_SPLIT);
+
+			ok = 1;
+			for (i = 0; i < eng->ways; i++) {
+				kat_sponge_ref(cfg, (const uint8_t *) way_msgs[i] -
+					       split, msg_len, expected,
+					       sizeof(expected));
+				ok &= !memcmp(md[i], expected, sizeof(expected));
+				ok &= !memcmp(md_inc[i], expected, sizeof(expected));
+			}
+
+			kat_result(set, ok, eng->name,
+				   "rate %zu, %u rounds, %zu bytes",
+				   cfg->rate_bytes, cfg->nr, msg_len);
+		}
+	}
+
+	keccakf1600_mb_ctx_free(ctx);
+}
+
+/* Absorb a random prefix, clone the context and continue each
+ * copy with a different message, against absorbing prefix and
+ * message in one go on the reference engine */
+static void
+kat_check_clone(const k1600_engine_t *eng, const uint8_t *buf,
+		struct kat_set *set)
+{
+	const struct kat_sponge_cfg *cfg = NULL;
+	uint8_t expected[KAT_SPONGE_OUT] = { 0 };
+	uint8_t out[KAT_SPONGE_OUT] = { 0 };
+	k1600_ctx_t prefix_ctx;
+	k1600_ctx_t ctx;
+	size_t prefix_len = 0;
+	size_t msg_len = 0;
+	int i = 0;
+
+	for (cfg = kat_sponge_cfgs; cfg->rate_bytes != 0; cfg++) {
+		for (i = 0; i < KAT_CLONE_PREFIXES; i++) {
+			prefix_len = kat_rand() % (KAT_SPONGE_MAX_MSG / 2);
+			keccakp1600_init(&prefix_ctx, eng, cfg->nr,
+					 cfg->rate_bytes, 0, 0x1F);
+			keccakf1600_update(&prefix_ctx, buf, prefix_len);
+
+			for (msg_len = 0; msg_len < 2 * cfg->rate_bytes;
+			     msg_len += 1 + kat_rand() % 16) {
+				kat_sponge_ref(cfg, buf, prefix_len + msg_len,
+					       expected, sizeof(expected));
+
+				keccakf1600_clone(&ctx, &prefix_ctx);
+				keccakf1600_update(&ctx, buf + prefix_len, msg_len);
+				keccakf1600_xof_squeeze(&ctx, out, sizeof(out));
+
+				kat_result(set, !memcmp(out, expected, sizeof(out)),
+					   eng->name, "clone, rate %zu, %u rounds, "
+					   "prefix %zu, %zu bytes", cfg->rate_bytes,
+					   cfg->nr, prefix_len, msg_len);
+			}
+		}
+	}
+}
+
+
+/************\
+* SP 800-185 *
+\************/
+
+static void
+kat_check_sp800_185(const k1600_engine_t *eng, struct kat_set *set)
+{
+	const struct kat_sp800_185_vector *vec = NULL;
+	const k1600_engine_t *prev_eng = keccakf1600_get_default_engine();
+	uint8_t expected[KAT_MAX_MD] = { 0 };
+	uint8_t out[KAT_MAX_MD] = { 0 };
+	uint8_t msg[200] = { 0 };
+	uint8_t key[32] = { 0 };
+	k1600_ctx_t key_ctx;
+	k1600_ctx_t ctx;
+	size_t out_len = 0;
+	size_t i = 0;
+
+	for (i = 0; i < sizeof(msg); i++)
+		msg[i] = i;
+	for (i = 0; i < sizeof(key); i++)
+		key[i] = 0x40 + i;
+
+	keccakf1600_set_default_engine(eng);
+
+	for (vec = kat_sp800_185_vectors; vec->name != NULL; vec++) {
+		out_len = kat_unhex(vec->out_hex, expected);
+		memset(out, 0, sizeof(out));
+
+		if (!vec->kmac && vec->strength == 128)
+			cshake128_oneshot(msg, vec->msg_len, "", 0, vec->custom,
+					  strlen(vec->custom), out, out_len);
+		else if (!vec->kmac)
+			cshake256_oneshot(msg, vec->msg_len, "", 0, vec->custom,
+					  strlen(vec->custom), out, out_len);
+		else if (vec->strength == 128)
+			kmac128_oneshot(key, vec->key_len, msg, vec->msg_len,
+					vec->custom, strlen(vec->custom), out,
+					out_len);
+		else
+			kmac256_oneshot(key, vec->key_len, msg, vec->msg_len,
+					vec->custom, strlen(vec->custom), out,
+					out_len);
+
+		kat_result(set, !memcmp(out, expected, out_len), eng->name,
+			   "%s", vec->name);
+	}
+
+	/* The same KMAC key on all lengths of the
+	 * message, from a cloned keyed context */
+	kmac128_init(&key_ctx, key, sizeof(key), "", 0);
+	for (i = 0; i <= sizeof(msg); i++) {
+		kmac128_oneshot(key, sizeof(key), msg, i, "", 0, expected, 32);
+		keccakf1600_clone(&ctx, &key_ctx);
+		keccakf1600_update(&ctx, msg, i);
+		kmac_final(&ctx, out, 32);
+		kat_result(set, !memcmp(out, expected, 32), eng->name,
+			   "KMAC128 clone, %zu bytes", i);
+	}
+
+	keccakf1600_set_default_engine(prev_eng);
+}
+
+
+/****************\
+* KANGAROOTWELVE *
+\****************/
+
+/* Returns ptn(len) for the largest message / customization
+ * string of the RFC 9861 vectors, or NULL on failure */
+static uint8_t *
+kat_k12_ptn(size_t *len)
+{
+	const struct kat_k12_vector *vec = NULL;
+	uint8_t *ptn = NULL;
+	size_t i = 0;
+
+	*len = 0;
+	for (vec = kat_k12_vectors; vec->name != NULL; vec++) {
+		if (vec->msg_len > *len)
+			*len = vec->msg_len;
+		if (vec->custom_len > *len)
+			*len = vec->custom_len;
+	}
+
+	ptn = malloc(*len);
+	if (!ptn)
+		return NULL;
+	for (i = 0; i < *len; i++)
+		ptn[i] = i % 251;
+
+	return ptn;
+}
+
+static void
+kat_check_k12(const k1600_engine_t *eng, const uint8_t *ptn,
+	      struct kat_set *set)
+{
+	const struct kat_k12_vector *vec = NULL;
+	const k1600_engine_t *prev_eng = keccakf1600_get_default_engine();
+	static uint8_t out[KAT_K12_MAX_OUT];
+	uint8_t expected[KAT_MAX_MD] = { 0 };
+	uint8_t ff[8] = { 0 };
+	const uint8_t *msg = NULL;
+	size_t expected_len = 0;
+	unsigned int nthreads = 0;
+
+	memset(ff, 0xFF, sizeof(ff));
+
+	keccakf1600_set_default_engine(eng);
+
+	for (vec = kat_k12_vectors; vec->name != NULL; vec++) {
+		expected_len = kat_unhex(vec->out_hex, expected);
+		msg = vec->msg_ff ? ff : ptn;
+
+		if (!vec->k12) {
+			memset(out, 0, sizeof(out));
+			turboshake128_oneshot(msg, vec->msg_len, vec->domain,
+					      out, vec->out_len);
+			kat_result(set, !memcmp(out + vec->out_len -
+						expected_len, expected,
+						expected_len), eng->name,
+				   "%s", vec->name);
+			continue;
+		}
+
+		/* Chunks go through the multi-buffer engines
+		 * on one thread and are spread on the rest */
+		for (nthreads = 1; nthreads <= KAT_K12_THREADS;
+		     nthreads += KAT_K12_THREADS - 1) {
+			memset(out, 0, sizeof(out));
+			k12_oneshot(msg, vec->msg_len, ptn, vec->custom_len,
+				    out, vec->out_len, nthreads);
+			kat_result(set, !memcmp(out + vec->out_len -
+						expected_len, expected,
+						expected_len), eng->name,
+				   "%s, %u threads", vec->name, nthreads);
+		}
+	}
+
+	keccakf1600_set_default_engine(prev_eng);
+}
+
+/* The chaining values of eng->ways consecutive chunks through the
+ * multi-buffer engine (what k12_oneshot() does for chunks 1 - n),
+ * against TurboSHAKE128 with the leaf domain on the reference engine */
+static void
+kat_check_k12_mb(const k1600_mb_engine_t *eng, const uint8_t *ptn,
+		 size_t ptn_len, struct kat_set *set)
+{
+	const void *chunks[KECCAK1600_MAX_WAYS] = { 0 };
+	void *mds[KECCAK1600_MAX_WAYS] = { 0 };
+	uint8_t out[KECCAK1600_MAX_WAYS][32];
+	uint8_t expected[32] = { 0 };
+	size_t max_off = ptn_len - eng->ways * K12_CHUNK_SIZE;
+	size_t off = 0;
+	unsigned int j = 0;
+
+	/* Once aligned, once not */
+	for (off = 0; off <= 1 && off <= max_off; off++) {
+		memset(out, 0, sizeof(out));
+		for (j = 0; j < eng->ways; j++) {
+			chunks[j] = ptn + off + j * K12_CHUNK_SIZE;
+			mds[j] = out[j];
+		}
+
+		keccakp1600_oneshot_mb(eng, 12, 168, chunks, K12_CHUNK_SIZE,
+				       mds, sizeof(out[0]), 0x0B);
+
+		for (j = 0; j < eng->ways; j++) {
+			keccakp1600_oneshot(&keccakf1600_engine_ref, 12, 168,
+					    chunks[j], K12_CHUNK_SIZE, expected,
+					    sizeof(expected), 0x0B);
+			kat_result(set, !memcmp(out[j], expected,
+						sizeof(expected)), eng->name,
+				   "K12 leaf, offset %zu, way %u", off, j);
+		}
+	}
+}
+
+
+/********\
+* MERKLE *
+\********/
+
+/* Root of the tree over the given chunks through the reference
+ * engine, nodes has room for a hash per chunk */
+static void
+kat_merkle_ref(const void *const chunks[], const size_t lens[], size_t n,
+	       uint8_t (*nodes)[MERKLE_HASH_LEN], uint8_t *root)
+{
+	size_t i = 0;
+
+	for (i = 0; i < n; i++)
+		keccakf1600_oneshot_eng(&keccakf1600_engine_ref, chunks[i],
+					lens[i], nodes[i], MERKLE_HASH_LEN, 0x06);
+
+	/* Each level in place, node i only needs 2i and 2i + 1,
+	 * nodes use suffix bits 11 instead of SHA3's 01 */
+	for (; n > 1; n = (n + 1) / 2) {
+		for (i = 0; i < n / 2; i++)
+			keccakf1600_oneshot_eng(&keccakf1600_engine_ref,
+						nodes[2 * i],
+						2 * MERKLE_HASH_LEN, nodes[i],
+						MERKLE_HASH_LEN, 0x07);
+		if (n % 2)
+			memcpy(nodes[n / 2], nodes[n - 1], MERKLE_HASH_LEN);
+	}
+	memcpy(root, nodes[0], MERKLE_HASH_LEN);
+}
+
+/* Known root of a two leaf tree, and a single leaf tree over the
+ * two leaf hashes of that one, that must have a different root */
+static void
+kat_check_merkle_domains(const k1600_engine_t *eng, struct kat_set *set)
+{
+	const void *chunks[2] = { "abc", "" };
+	const size_t lens[2] = { 3, 0 };
+	uint8_t expected[MERKLE_HASH_LEN] = { 0 };
+	uint8_t leaves[2 * MERKLE_HASH_LEN] = { 0 };
+	const void *leaf_chunk[1] = { leaves };
+	const size_t leaf_len[1] = { sizeof(leaves) };
+	merkle_tree_t *pair = merkle_new(2);
+	merkle_tree_t *leaf = merkle_new(1);
+
+	if (!pair || !leaf) {
+		kat_result(set, 0, eng->name, "domains, allocation failed");
+		goto cleanup;
+	}
+
+	kat_unhex(kat_merkle_root_hex, expected);
+	merkle_build(pair, chunks, lens, 1);
+	kat_result(set, !memcmp(merkle_root(pair), expected, MERKLE_HASH_LEN),
+		   eng->name, "2 leaves, known root");
+
+	memcpy(leaves, merkle_node(pair, 0, 0), MERKLE_HASH_LEN);
+	memcpy(leaves + MERKLE_HASH_LEN, merkle_node(pair, 0, 1),
+	       MERKLE_HASH_LEN);
+	merkle_build(leaf, leaf_chunk, leaf_len, 1);
+	kat_result(set, memcmp(merkle_root(leaf), merkle_root(pair),
+			       MERKLE_HASH_LEN) != 0, eng->name,
+		   "leaf over a node's children hashes apart from the node");
+
+ cleanup:
+	merkle_free(leaf);
+	merkle_free(pair);
+}
+
+static void
+kat_check_merkle(const k1600_engine_t *eng, const uint8_t *buf,
+		 size_t buf_len, struct kat_set *set)
+{
+	const k1600_engine_t *prev_eng = keccakf1600_get_default_engine();
+	uint8_t root[MERKLE_HASH_LEN] = { 0 };
+	uint8_t (*nodes)[MERKLE_HASH_LEN] = NULL;
+	const void **chunks = NULL;
+	merkle_tree_t *tree = NULL;
+	size_t *lens = NULL;
+	size_t max_leaves = 0;
+	size_t n = 0;
+	size_t idx = 0;
+	size_t i = 0;
+	unsigned int nthreads = 0;
+	unsigned int j = 0;
+
+	for (i = 0; kat_merkle_sizes[i] != 0; i++)
+		if (kat_merkle_sizes[i] > max_leaves)
+			max_leaves = kat_merkle_sizes[i];
+
+	nodes = malloc(max_leaves * MERKLE_HASH_LEN);
+	chunks = malloc(max_leaves * sizeof(chunks[0]));
+	lens = malloc(max_leaves * sizeof(lens[0]));
+	if (!nodes || !chunks || !lens) {
+		kat_result(set, 0, eng->name, "setup failed");
+		goto cleanup;
+	}
+
+	keccakf1600_set_default_engine(eng);
+	kat_check_merkle_domains(eng, set);
+
+	for (i = 0; kat_merkle_sizes[i] != 0; i++) {
+		n = kat_merkle_sizes[i];
+		for (nthreads = 1; nthreads <= KAT_MERKLE_THREADS;
+		     nthreads += KAT_MERKLE_THREADS - 1) {
+			tree = merkle_new(n);
+			if (!tree) {
+				kat_result(set, 0, eng->name, "%zu leaves, "
+					   "allocation failed", n);
+				continue;
+			}
+
+			/* Mostly the same length so that they get batched */
+			for (idx = 0; idx < n; idx++) {
+				lens[idx] = (kat_rand() & 1) ? 100 :
+					    kat_rand() % KAT_MERKLE_MAX_CHUNK;
+				chunks[idx] = buf + kat_rand() %
+					      (buf_len - KAT_MERKLE_MAX_CHUNK);
+			}
+
+			merkle_build(tree, chunks, lens, nthreads);
+			kat_merkle_ref(chunks, lens, n, nodes, root);
+			kat_result(set, !memcmp(merkle_root(tree), root,
+						MERKLE_HASH_LEN), eng->name,
+				   "%zu leaves, %u threads", n, nthreads);
+
+			for (j = 0; j < KAT_MERKLE_UPDATES; j++) {
+				idx = kat_rand() % n;
+				lens[idx] = kat_rand() % KAT_MERKLE_MAX_CHUNK;
+				chunks[idx] = buf + kat_rand() %
+					      (buf_len - KAT_MERKLE_MAX_CHUNK);
+				merkle_update(tree, idx, chunks[idx], lens[idx]);
+			}
+			kat_merkle_ref(chunks, lens, n, nodes, root);
+			kat_result(set, !memcmp(merkle_root(tree), root,
+						MERKLE_HASH_LEN), eng->name,
+				   "%zu leaves, after updates", n);
+
+			merkle_free(tree);
+		}
+	}
+
+	keccakf1600_set_default_engine(prev_eng);
+
+ cleanup:
+	free(lens);
+	free(chunks);
+	free(nodes);
+}
+
+
+/*********\
+* SERVICE *
+\*********/
+
+static void
+kat_svc_done(struct sha3_svc_job *job, void *arg)
+{
+	unsigned int *count = arg;
+
+	(void) job;
+	__atomic_add_fetch(count, 1, __ATOMIC_RELAXED);
+}
+
+static void
+kat_check_svc(const uint8_t *buf, size_t buf_len, struct kat_set *set)
+{
+	static const size_t common_lens[] = { 0, 1, 32, 64, 135, 136, 500 };
+	uint8_t expected[KAT_SPONGE_OUT] = { 0 };
+	struct sha3_svc_job bad = { 0 };
+	struct sha3_svc_job *jobs = NULL;
+	struct sha3_svc_job *job = NULL;
+	const struct kat_alg *alg = NULL;
+	sha3_svc_t *svc = NULL;
+	uint8_t *mds = NULL;
+	k1600_ctx_t ctx;
+	unsigned int callbacks = 0;
+	size_t half = KAT_SVC_JOBS / 2;
+	size_t md_len = 0;
+	size_t i = 0;
+	int ok = 0;
+
+	jobs = calloc(KAT_SVC_JOBS, sizeof(jobs[0]));
+	mds = calloc(KAT_SVC_JOBS, KAT_SPONGE_OUT);
+	svc = sha3_svc_create(KAT_SVC_THREADS, 0);
+	if (!jobs || !mds || !svc) {
+		kat_result(set, 0, "service", "setup failed");
+		goto cleanup;
+	}
+
+	for (i = 0; i < KAT_SVC_JOBS; i++) {
+		job = &jobs[i];
+		job->alg = kat_rand() % SHA3_SVC_NUM_ALGS;
+		if (kat_rand() & 1)
+			job->msg_len = common_lens[kat_rand() %
+				(sizeof(common_lens) / sizeof(common_lens[0]))];
+		else
+			job->msg_len = kat_rand() % (buf_len - KECCAK1600_LANE_BYTES);
+		job->msg = buf + (kat_rand() % KECCAK1600_LANE_BYTES);
+		job->md = mds + i * KAT_SPONGE_OUT;
+		job->md_len = 1 + kat_rand() % KAT_SPONGE_OUT;
+		if (i & 1) {
+			job->done = kat_svc_done;
+			job->done_arg = &callbacks;
+		}
+	}
+
+	/* Half of them one by one, the rest at once */
+	ok = 1;
+	for (i = 0; i < half; i++)
+		ok &= !sha3_svc_submit(svc, &jobs[i]);
+	ok &= !sha3_svc_submit_n(svc, &jobs[half], KAT_SVC_JOBS - half);
+	kat_result(set, ok, "service", "submit failed");
+
+	/* Wait for some of the ones without a callback, then for all */
+	for (i = 0; i < KAT_SVC_JOBS; i += 16)
+		sha3_svc_wait(svc, &jobs[i]);
+	sha3_svc_drain(svc);
+	kat_result(set, callbacks == KAT_SVC_JOBS / 2, "service",
+		   "%u callbacks", callbacks);
+
+	for (i = 0; i < KAT_SVC_JOBS; i++) {
+		job = &jobs[i];
+		alg = &kat_svc_algs[job->alg];
+		md_len = alg->md_len ? alg->md_len : job->md_len;
+
+		keccakp1600_init(&ctx, &keccakf1600_engine_ref,
+				 KECCAK1600_NUM_ROUNDS, alg->rate_bytes, 0,
+				 alg->delim);
+		keccakf1600_update(&ctx, job->msg, job->msg_len);
+		keccakf1600_xof_squeeze(&ctx, expected, md_len);
+
+		ok = (job->done || sha3_svc_job_done(job)) &&
+		     !memcmp(job->md, expected, md_len);
+		kat_result(set, ok, "service", "%s, %zu bytes", alg->name,
+			   job->msg_len);
+	}
+
+	/* SHAKE needs an output length */
+	bad.alg = SHA3_SVC_SHAKE128;
+	kat_result(set, sha3_svc_submit(svc, &bad) == -1, "service",
+		   "invalid job accepted");
+
+ cleanup:
+	sha3_svc_destroy(svc);
+	free(mds);
+	free(jobs);
+}
+
+
+/*************\
+* ENTRY POINT *
+\*************/
+
+int
+main(int argc, char *argv[])
+{
+	struct kat_set vectors = { "known answers", 0, 0 };
+	struct kat_set perms = { "permutation", 0, 0 };
+	struct kat_set sponge = { "sponge", 0, 0 };
+	struct kat_set sp800_185 = { "SP 800-185", 0, 0 };
+	struct kat_set k12 = { "KangarooTwelve", 0, 0 };
+	struct kat_set merkle = { "Merkle", 0, 0 };
+	struct kat_set service = { "service", 0, 0 };
+	k1600_state_t states[KAT_PERM_STATES];
+	uint8_t *msgs[KAT_NUM_MSGS] = { 0 };
+	size_t msg_lens[KAT_NUM_MSGS] = { 0 };
+	const k1600_engine_t *eng = NULL;
+	const k1600_mb_engine_t *mb_eng = NULL;
+	struct kat_set *sets[] = { &vectors, &perms, &sponge, &sp800_185,
+				   &k12, &merkle, &service };
+	uint8_t *buf = NULL;
+	uint8_t *k12_ptn = NULL;
+	size_t k12_ptn_len = 0;
+	unsigned int failures = 0;
+	size_t i = 0;
+	int ret = 0;
+
+	if (argc > 1)
+		kat_rng = strtoull(argv[1], NULL, 0) | 1;
+	printf("Seed: 0x%016lX\n", (unsigned long) kat_rng);
+
+	for (i = 0; i < KAT_NUM_MSGS; i++) {
+		msgs[i] = malloc(strlen(kat_msgs[i].pattern) *
+				 kat_msgs[i].repeat + 1);
+		if (!msgs[i]) {
+			ret = 1;
+			goto cleanup;
+		}
+		msg_lens[i] = kat_msg_build(&kat_msgs[i], msgs[i]);
+	}
+
+	/* Room for a message per way, plus misalignment */
+	buf = malloc(KECCAK1600_MAX_WAYS * (KAT_SPONGE_MAX_MSG + 1) +
+		     KECCAK1600_LANE_BYTES);
+	if (!buf) {
+		ret = 1;
+		goto cleanup;
+	}
+	kat_rand_bytes(buf, KECCAK1600_MAX_WAYS * (KAT_SPONGE_MAX_MSG + 1) +
+		       KECCAK1600_LANE_BYTES);
+	kat_rand_bytes((uint8_t *) states, sizeof(states));
+
+	k12_ptn = kat_k12_ptn(&k12_ptn_len);
+	if (!k12_ptn) {
+		ret = 1;
+		goto cleanup;
+	}
+
+	for (i = 0; keccakf1600_engines[i] != NULL; i++) {
+		eng = keccakf1600_engines[i];
+		if (!keccakf1600_engine_supported(eng)) {
+			printf("Skipping %s, not supported\n", eng->name);
+			continue;
+		}
+		printf("Checking %s\n", eng->name);
+		kat_check_vectors(eng, msgs, msg_lens, &vectors);
+		kat_check_perm(eng, states, &perms);
+		if (eng != &keccakf1600_engine_ref) {
+			kat_check_sponge(eng, buf, &sponge);
+			kat_check_clone(eng, buf, &sponge);
+		}
+		kat_check_sp800_185(eng, &sp800_185);
+		kat_check_k12(eng, k12_ptn, &k12);
+		kat_check_merkle(eng, buf, KECCAK1600_MAX_WAYS *
+				 (KAT_SPONGE_MAX_MSG + 1), &merkle);
+	}
+
+	for (i = 0; keccakf1600_mb_engines[i] != NULL; i++) {
+		mb_eng = keccakf1600_mb_engines[i];
+		if (!keccakf1600_mb_engine_supported(mb_eng)) {
+			printf("Skipping %s, not supported\n", mb_eng->name);
+			continue;
+		}
+		printf("Checking %s\n", mb_eng->name);
+		kat_check_vectors_mb(mb_eng, msgs, msg_lens, &vectors);
+		kat_check_perm_mb(mb_eng, states, &perms);
+		kat_check_sponge_mb(mb_eng, buf, &sponge);
+		kat_check_k12_mb(mb_eng, k12_ptn, k12_ptn_len, &k12);
+	}
+
+	printf("Checking the batch hashing service\n");
+	kat_check_svc(buf, KECCAK1600_MAX_WAYS * (KAT_SPONGE_MAX_MSG + 1),
+		      &service);
+
+	for (i = 0; i < sizeof(sets) / sizeof(sets[0]); i++) {
+		printf("%-16s %u checks, %u failed\n", sets[i]->name,
+		       sets[i]->checks, sets[i]->failures);
+		failures += sets[i]->failures;
+	}
+	ret = failures ? 1 : 0;
+	printf("%s\n", ret ? "FAILED" : "PASSED");
+
+ cleanup:
+	for (i = 0; i < KAT_NUM_MSGS; i++)
+		free(msgs[i]);
+	free(buf);
+	free(k12_ptn);
+
+	return ret;
+}
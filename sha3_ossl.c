@@ -12,6 +12,17 @@
 * ENTRY POINTS *
 \**************/
 
+void
+sha3_224_oneshot(const void *msg, size_t msg_len, void* md)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	unsigned int md_len = 28;
+	EVP_DigestInit_ex(ctx, EVP_sha3_224(), NULL);
+	EVP_DigestUpdate(ctx, msg, msg_len);
+	EVP_DigestFinal_ex(ctx, md, &md_len);
+	EVP_MD_CTX_destroy(ctx);
+}
+
 void
 sha3_256_oneshot(const void *msg, size_t msg_len, void* md)
 {
@@ -23,6 +34,17 @@ sha3_256_oneshot(const void *msg, size_t msg_len, void* md)
 	EVP_MD_CTX_destroy(ctx);
 }
 
+void
+sha3_384_oneshot(const void *msg, size_t msg_len, void* md)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	unsigned int md_len = 48;
+	EVP_DigestInit_ex(ctx, EVP_sha3_384(), NULL);
+	EVP_DigestUpdate(ctx, msg, msg_len);
+	EVP_DigestFinal_ex(ctx, md, &md_len);
+	EVP_MD_CTX_destroy(ctx);
+}
+
 void
 sha3_512_oneshot(const void *msg, size_t msg_len, void* md)
 {
@@ -33,3 +55,23 @@ sha3_512_oneshot(const void *msg, size_t msg_len, void* md)
 	EVP_DigestFinal_ex(ctx, md, &md_len);
 	EVP_MD_CTX_destroy(ctx);
 }
+
+void
+shake128_oneshot(const void *msg, size_t msg_len, void *out, size_t out_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	EVP_DigestInit_ex(ctx, EVP_shake128(), NULL);
+	EVP_DigestUpdate(ctx, msg, msg_len);
+	EVP_DigestFinalXOF(ctx, out, out_len);
+	EVP_MD_CTX_destroy(ctx);
+}
+
+void
+shake256_oneshot(const void *msg, size_t msg_len, void *out, size_t out_len)
+{
+	EVP_MD_CTX *ctx = EVP_MD_CTX_create();
+	EVP_DigestInit_ex(ctx, EVP_shake256(), NULL);
+	EVP_DigestUpdate(ctx, msg, msg_len);
+	EVP_DigestFinalXOF(ctx, out, out_len);
+	EVP_MD_CTX_destroy(ctx);
+}
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Shared worker pool
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include "sha3_pool.h"
+#include <pthread.h>	/* For pthread_*() */
+#include <unistd.h>	/* For sysconf() */
+
+/*
+ * Workers sleep on work_cond until a new run shows up (gen changes),
+ * join it if it still needs threads, and take indices off the shared
+ * counter until there are none left. Once the caller runs out of
+ * indices it closes the run, so that workers that wake up late don't
+ * join it, and waits for the ones that did to finish.
+ */
+
+struct sha3_pool {
+	/* Held for the whole run, only one at a time */
+	pthread_mutex_t run_lock;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+	pthread_t threads[SHA3_POOL_MAX_THREADS - 1];
+	unsigned int num_threads;
+	int stop;
+	/* The current run */
+	unsigned long gen;
+	int closed;
+	unsigned int wanted;
+	unsigned int active;
+	sha3_pool_fn fn;
+	void *arg;
+	size_t count;
+	size_t next;
+};
+
+static struct sha3_pool pool = {
+	.run_lock = PTHREAD_MUTEX_INITIALIZER,
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.work_cond = PTHREAD_COND_INITIALIZER,
+	.done_cond = PTHREAD_COND_INITIALIZER,
+	.closed = 1,
+};
+
+
+/*********\
+* WORKERS *
+\*********/
+
+static void
+sha3_pool_work(struct sha3_pool *p)
+{
+	size_t idx = 0;
+
+	while ((idx = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED)) <
+	       p->count)
+		p->fn(p->arg, idx);
+}
+
+static void *
+sha3_pool_worker(void *arg)
+{
+	struct sha3_pool *p = arg;
+	unsigned long seen = 0;
+
+	pthread_mutex_lock(&p->lock);
+	while (!p->stop) {
+		if (p->gen != seen && !p->closed && p->wanted > 0) {
+			seen = p->gen;
+			p->wanted--;
+			p->active++;
+			pthread_mutex_unlock(&p->lock);
+
+			sha3_pool_work(p);
+
+			pthread_mutex_lock(&p->lock);
+			if (!--p->active)
+				pthread_cond_signal(&p->done_cond);
+			continue;
+		}
+		seen = p->gen;
+		pthread_cond_wait(&p->work_cond, &p->lock);
+	}
+	pthread_mutex_unlock(&p->lock);
+
+	return NULL;
+}
+
+/* Called with the lock held, start workers until
+ * we have num of them, or we fail to start more */
+static void
+sha3_pool_grow(struct sha3_pool *p, unsigned int num)
+{
+	while (p->num_threads < num) {
+		if (pthread_create(&p->threads[p->num_threads], NULL,
+				   sha3_pool_worker, p))
+			break;
+		p->num_threads++;
+	}
+}
+
+/* Stop the workers when we get unloaded (e.g. as part of
+ * a dlopen()ed module), so that they don't outlive our code */
+__attribute__((destructor)) static void
+sha3_pool_fini(void)
+{
+	unsigned int i = 0;
+
+	pthread_mutex_lock(&pool.lock);
+	pool.stop = 1;
+	pthread_cond_broadcast(&pool.work_cond);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (i = 0; i < pool.num_threads; i++)
+		pthread_join(pool.threads[i], NULL);
+	pool.num_threads = 0;
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+void
+sha3_pool_run(unsigned int nthreads, size_t count, sha3_pool_fn fn,
+	      void *arg)
+{
+	size_t idx = 0;
+	long ncpus = 0;
+
+	if (!nthreads) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpus > 0) ? ncpus : 1;
+	}
+	if (nthreads > SHA3_POOL_MAX_THREADS)
+		nthreads = SHA3_POOL_MAX_THREADS;
+	if (nthreads > count)
+		nthreads = count;
+
+	/* Not worth it, or someone else is using the pool */
+	if (nthreads <= 1 || pthread_mutex_trylock(&pool.run_lock)) {
+		for (idx = 0; idx < count; idx++)
+			fn(arg, idx);
+		return;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	sha3_pool_grow(&pool, nthreads - 1);
+	pool.fn = fn;
+	pool.arg = arg;
+	pool.count = count;
+	pool.next = 0;
+	pool.wanted = nthreads - 1;
+	pool.closed = 0;
+	pool.gen++;
+	pthread_cond_broadcast(&pool.work_cond);
+	pthread_mutex_unlock(&pool.lock);
+
+	sha3_pool_work(&pool);
+
+	pthread_mutex_lock(&pool.lock);
+	pool.closed = 1;
+	while (pool.active)
+		pthread_cond_wait(&pool.done_cond, &pool.lock);
+	pthread_mutex_unlock(&pool.lock);
+
+	pthread_mutex_unlock(&pool.run_lock);
+}
@@ -0,0 +1,37 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * Shared worker pool - Private header
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _SHA3_POOL_H
+#define _SHA3_POOL_H
+
+/*
+ * A process-wide pool of worker threads for the tree hashes (K12,
+ * the Merkle tree), created lazily on first use and kept around
+ * after that, so that each call doesn't pay for creating and joining
+ * its threads. It only does one thing: run fn(arg, idx) for every idx
+ * from 0 to count - 1, spread over up to nthreads threads, the
+ * calling one included, and return when they are all done.
+ *
+ * There is one run at a time, if the pool is busy (another thread
+ * is in the middle of a run, or fn itself calls into the pool) the
+ * caller does all the work itself, so it never blocks on someone
+ * else's run and nested calls can't deadlock. For independent jobs
+ * from many threads use the batch hashing service instead.
+ */
+
+#include <stddef.h>	/* For size_t */
+
+#define SHA3_POOL_MAX_THREADS	64
+
+typedef void (*sha3_pool_fn) (void *arg, size_t idx);
+
+/* nthreads includes the calling thread, 0 means one for each online
+ * cpu and 1 means only the calling thread. If some of the workers
+ * can't be started, the ones we have just get more work. */
+void sha3_pool_run(unsigned int nthreads, size_t count, sha3_pool_fn fn,
+		   void *arg);
+
+#endif /* _SHA3_POOL_H */
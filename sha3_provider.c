@@ -0,0 +1,359 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 OpenSSL 3 provider
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#include <openssl/core.h>		/* For OSSL_ALGORITHM */
+#include <openssl/core_dispatch.h>	/* For OSSL_FUNC_* */
+#include <openssl/core_names.h>		/* For OSSL_DIGEST_PARAM_* */
+#include <openssl/params.h>		/* For OSSL_PARAM_locate() */
+#include <openssl/crypto.h>		/* For OPENSSL_zalloc() */
+#include "sha3.h"
+
+/*
+ * Registers SHA3-224/256/384/512 and SHAKE128/256 with OpenSSL's EVP,
+ * on top of the incremental API and the default (auto-selected) engine,
+ * so that applications using EVP get the fast kernels with no code
+ * changes. To use it either load it explicitly, e.g.
+ *
+ *	openssl dgst -provider-path . -provider rv_sha3 -sha3-256 file
+ *
+ * or activate it from openssl.cnf (together with the default provider,
+ * for everything else) and prefer it for the algorithms it has:
+ *
+ *	[openssl_init]
+ *	providers = provider_sect
+ *	alg_section = evp_properties
+ *
+ *	[provider_sect]
+ *	default = default_sect
+ *	rv_sha3 = rv_sha3_sect
+ *
+ *	[default_sect]
+ *	activate = 1
+ *
+ *	[rv_sha3_sect]
+ *	module = /usr/local/lib/ossl-modules/rv_sha3.so
+ *	activate = 1
+ *
+ *	[evp_properties]
+ *	default_properties = ?provider=rv_sha3
+ *
+ * The engine can still be overridden through KECCAK1600_ENGINE, as
+ * with any other user of the library.
+ */
+
+#define PROV_NAME	"rv_sha3"
+#define PROV_VERSION	"1.0"
+#define PROV_PROPS	"provider=" PROV_NAME
+
+/* The defaults OpenSSL uses for SHAKE's output length,
+ * when the application doesn't set one */
+#define SHAKE128_MD_LEN	16
+#define SHAKE256_MD_LEN	32
+
+typedef void (*prov_initf)(sha3_ctx_t *ctx);
+
+struct prov_alg {
+	prov_initf init;
+	size_t md_len;
+	size_t block_size;
+	int xof;
+};
+
+struct prov_ctx {
+	sha3_ctx_t ctx;
+	const struct prov_alg *alg;
+	size_t md_len;
+};
+
+static const struct prov_alg prov_sha3_224 = { sha3_224_init, 28, 144, 0 };
+static const struct prov_alg prov_sha3_256 = { sha3_256_init, 32, 136, 0 };
+static const struct prov_alg prov_sha3_384 = { sha3_384_init, 48, 104, 0 };
+static const struct prov_alg prov_sha3_512 = { sha3_512_init, 64, 72, 0 };
+static const struct prov_alg prov_shake128 = { shake128_init, SHAKE128_MD_LEN,
+					       SHAKE128_RATE, 1 };
+static const struct prov_alg prov_shake256 = { shake256_init, SHAKE256_MD_LEN,
+					       SHAKE256_RATE, 1 };
+
+
+/******************\
+* DIGEST FUNCTIONS *
+\******************/
+
+static void *
+prov_newctx(const struct prov_alg *alg)
+{
+	struct prov_ctx *pctx = OPENSSL_zalloc(sizeof(*pctx));
+
+	if (pctx)
+		pctx->alg = alg;
+	return pctx;
+}
+
+static void
+prov_freectx(void *vctx)
+{
+	OPENSSL_clear_free(vctx, sizeof(struct prov_ctx));
+}
+
+static void *
+prov_dupctx(void *vctx)
+{
+	struct prov_ctx *src = vctx;
+	struct prov_ctx *dst = OPENSSL_malloc(sizeof(*dst));
+
+	if (!dst)
+		return NULL;
+	keccakf1600_clone(&dst->ctx, &src->ctx);
+	dst->alg = src->alg;
+	dst->md_len = src->md_len;
+	return dst;
+}
+
+static int
+prov_set_ctx_params(void *vctx, const OSSL_PARAM params[])
+{
+	struct prov_ctx *pctx = vctx;
+	const OSSL_PARAM *p = NULL;
+	size_t md_len = 0;
+
+	if (!params)
+		return 1;
+
+	p = OSSL_PARAM_locate_const(params, OSSL_DIGEST_PARAM_XOFLEN);
+	if (!p)
+		return 1;
+	if (!pctx->alg->xof || !OSSL_PARAM_get_size_t(p, &md_len))
+		return 0;
+	pctx->md_len = md_len;
+	return 1;
+}
+
+static const OSSL_PARAM *
+prov_settable_ctx_params(void *vctx, void *provctx)
+{
+	static const OSSL_PARAM settable[] = {
+		OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_XOFLEN, NULL),
+		OSSL_PARAM_END
+	};
+
+	(void) vctx;
+	(void) provctx;
+	return settable;
+}
+
+static int
+prov_init(void *vctx, const OSSL_PARAM params[])
+{
+	struct prov_ctx *pctx = vctx;
+
+	pctx->alg->init(&pctx->ctx);
+	pctx->md_len = pctx->alg->md_len;
+	return prov_set_ctx_params(vctx, params);
+}
+
+static int
+prov_update(void *vctx, const unsigned char *in, size_t inl)
+{
+	struct prov_ctx *pctx = vctx;
+
+	sha3_update(&pctx->ctx, in, inl);
+	return 1;
+}
+
+static int
+prov_final(void *vctx, unsigned char *out, size_t *outl, size_t outsz)
+{
+	struct prov_ctx *pctx = vctx;
+
+	if (outsz < pctx->md_len)
+		return 0;
+
+	if (pctx->alg->xof)
+		shake_squeeze(&pctx->ctx, out, pctx->md_len);
+	else
+		sha3_final(&pctx->ctx, out);
+	*outl = pctx->md_len;
+	return 1;
+}
+
+static int
+prov_get_params(const struct prov_alg *alg, OSSL_PARAM params[])
+{
+	OSSL_PARAM *p = NULL;
+
+	p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_BLOCK_SIZE);
+	if (p && !OSSL_PARAM_set_size_t(p, alg->block_size))
+		return 0;
+	p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_SIZE);
+	if (p && !OSSL_PARAM_set_size_t(p, alg->md_len))
+		return 0;
+	p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_XOF);
+	if (p && !OSSL_PARAM_set_int(p, alg->xof))
+		return 0;
+	/* The AlgorithmIdentifier has no parameters, e.g.
+	 * for signatures */
+	p = OSSL_PARAM_locate(params, OSSL_DIGEST_PARAM_ALGID_ABSENT);
+	if (p && !OSSL_PARAM_set_int(p, 1))
+		return 0;
+	return 1;
+}
+
+static const OSSL_PARAM *
+prov_gettable_params(void *provctx)
+{
+	static const OSSL_PARAM gettable[] = {
+		OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_BLOCK_SIZE, NULL),
+		OSSL_PARAM_size_t(OSSL_DIGEST_PARAM_SIZE, NULL),
+		OSSL_PARAM_int(OSSL_DIGEST_PARAM_XOF, NULL),
+		OSSL_PARAM_int(OSSL_DIGEST_PARAM_ALGID_ABSENT, NULL),
+		OSSL_PARAM_END
+	};
+
+	(void) provctx;
+	return gettable;
+}
+
+/* OpenSSL doesn't pass anything to newctx / get_params that
+ * tells us which algorithm they are for, so we need a pair of
+ * wrappers for each one */
+#define PROV_DIGEST(_name)						\
+static void *								\
+prov_##_name##_newctx(void *provctx)					\
+{									\
+	(void) provctx;							\
+	return prov_newctx(&prov_##_name);				\
+}									\
+									\
+static int								\
+prov_##_name##_get_params(OSSL_PARAM params[])				\
+{									\
+	return prov_get_params(&prov_##_name, params);			\
+}									\
+									\
+static const OSSL_DISPATCH prov_##_name##_functions[] = {		\
+	{ OSSL_FUNC_DIGEST_NEWCTX,					\
+	  (void (*)(void)) prov_##_name##_newctx },			\
+	{ OSSL_FUNC_DIGEST_INIT, (void (*)(void)) prov_init },		\
+	{ OSSL_FUNC_DIGEST_UPDATE, (void (*)(void)) prov_update },	\
+	{ OSSL_FUNC_DIGEST_FINAL, (void (*)(void)) prov_final },	\
+	{ OSSL_FUNC_DIGEST_FREECTX, (void (*)(void)) prov_freectx },	\
+	{ OSSL_FUNC_DIGEST_DUPCTX, (void (*)(void)) prov_dupctx },	\
+	{ OSSL_FUNC_DIGEST_GET_PARAMS,					\
+	  (void (*)(void)) prov_##_name##_get_params },			\
+	{ OSSL_FUNC_DIGEST_GETTABLE_PARAMS,				\
+	  (void (*)(void)) prov_gettable_params },			\
+	{ OSSL_FUNC_DIGEST_SET_CTX_PARAMS,				\
+	  (void (*)(void)) prov_set_ctx_params },			\
+	{ OSSL_FUNC_DIGEST_SETTABLE_CTX_PARAMS,			\
+	  (void (*)(void)) prov_settable_ctx_params },			\
+	{ 0, NULL }							\
+};
+
+PROV_DIGEST(sha3_224)
+PROV_DIGEST(sha3_256)
+PROV_DIGEST(sha3_384)
+PROV_DIGEST(sha3_512)
+PROV_DIGEST(shake128)
+PROV_DIGEST(shake256)
+
+/* Same names / OIDs as OpenSSL's default provider */
+static const OSSL_ALGORITHM prov_digests[] = {
+	{ "SHA3-224:2.16.840.1.101.3.4.2.7", PROV_PROPS,
+	  prov_sha3_224_functions, NULL },
+	{ "SHA3-256:2.16.840.1.101.3.4.2.8", PROV_PROPS,
+	  prov_sha3_256_functions, NULL },
+	{ "SHA3-384:2.16.840.1.101.3.4.2.9", PROV_PROPS,
+	  prov_sha3_384_functions, NULL },
+	{ "SHA3-512:2.16.840.1.101.3.4.2.10", PROV_PROPS,
+	  prov_sha3_512_functions, NULL },
+	{ "SHAKE-128:SHAKE128:2.16.840.1.101.3.4.2.11", PROV_PROPS,
+	  prov_shake128_functions, NULL },
+	{ "SHAKE-256:SHAKE256:2.16.840.1.101.3.4.2.12", PROV_PROPS,
+	  prov_shake256_functions, NULL },
+	{ NULL, NULL, NULL, NULL }
+};
+
+
+/********************\
+* PROVIDER FUNCTIONS *
+\********************/
+
+static const OSSL_ALGORITHM *
+prov_query_operation(void *provctx, int operation_id, int *no_cache)
+{
+	(void) provctx;
+	*no_cache = 0;
+	if (operation_id == OSSL_OP_DIGEST)
+		return prov_digests;
+	return NULL;
+}
+
+static const OSSL_PARAM *
+prov_gettable_provider_params(void *provctx)
+{
+	static const OSSL_PARAM gettable[] = {
+		OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_NAME, NULL, 0),
+		OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_VERSION, NULL, 0),
+		OSSL_PARAM_utf8_ptr(OSSL_PROV_PARAM_BUILDINFO, NULL, 0),
+		OSSL_PARAM_int(OSSL_PROV_PARAM_STATUS, NULL),
+		OSSL_PARAM_END
+	};
+
+	(void) provctx;
+	return gettable;
+}
+
+static int
+prov_get_provider_params(void *provctx, OSSL_PARAM params[])
+{
+	const k1600_engine_t *eng = keccakf1600_get_default_engine();
+	OSSL_PARAM *p = NULL;
+
+	(void) provctx;
+	p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_NAME);
+	if (p && !OSSL_PARAM_set_utf8_ptr(p, PROV_NAME))
+		return 0;
+	p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_VERSION);
+	if (p && !OSSL_PARAM_set_utf8_ptr(p, PROV_VERSION))
+		return 0;
+	/* Report the engine we ended up with */
+	p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_BUILDINFO);
+	if (p && !OSSL_PARAM_set_utf8_ptr(p, eng->name))
+		return 0;
+	p = OSSL_PARAM_locate(params, OSSL_PROV_PARAM_STATUS);
+	if (p && !OSSL_PARAM_set_int(p, 1))
+		return 0;
+	return 1;
+}
+
+static const OSSL_DISPATCH prov_functions[] = {
+	{ OSSL_FUNC_PROVIDER_GETTABLE_PARAMS,
+	  (void (*)(void)) prov_gettable_provider_params },
+	{ OSSL_FUNC_PROVIDER_GET_PARAMS,
+	  (void (*)(void)) prov_get_provider_params },
+	{ OSSL_FUNC_PROVIDER_QUERY_OPERATION,
+	  (void (*)(void)) prov_query_operation },
+	{ 0, NULL }
+};
+
+
+/*************\
+* ENTRY POINT *
+\*************/
+
+OSSL_provider_init_fn OSSL_provider_init;
+
+int
+OSSL_provider_init(const OSSL_CORE_HANDLE *handle, const OSSL_DISPATCH *in,
+		   const OSSL_DISPATCH **out, void **provctx)
+{
+	/* We don't keep any state, but OpenSSL expects
+	 * a non-NULL provider context */
+	(void) in;
+	*provctx = (void *) handle;
+	*out = prov_functions;
+	return 1;
+}
@@ -0,0 +1,737 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 C / RV64 Implementation - sha3sum utility
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#define _GNU_SOURCE		/* For getopt_long() / posix_fadvise() */
+#include <stdio.h>		/* For printf() / getline() */
+#include <stdlib.h>		/* For malloc() / strtoul() */
+#include <string.h>		/* For strcmp() / strerror() */
+#include <errno.h>		/* For errno */
+#include <fcntl.h>		/* For open() / posix_fadvise() */
+#include <getopt.h>		/* For getopt_long() */
+#include <pthread.h>		/* For pthread_create() */
+#include <signal.h>		/* For sigaction() */
+#include <setjmp.h>		/* For sigsetjmp() */
+#include <unistd.h>		/* For read() / sysconf() */
+#include <sys/mman.h>		/* For mmap() / madvise() */
+#include <sys/stat.h>		/* For fstat() */
+#include "sha3.h"
+
+/*
+ * Output (and the input for -c) is the same as coreutils' sha*sum,
+ * "<hex>  <name>" or "<hex> *<name>" in binary mode (there is no
+ * difference between the two here, it's just for compatibility),
+ * names with a backslash or a newline get escaped and the line
+ * starts with a backslash. With --tag we use the BSD style one,
+ * "SHA3-256 (<name>) = <hex>", same as cksum -a sha3. When checking,
+ * the algorithm comes from the tag or the digest length, so sums of
+ * different algorithms can be mixed in the same list.
+ *
+ * Regular files are mapped and absorbed straight from the mapping
+ * through the incremental API, so there is no copy into a buffer
+ * and the default engine's absorb hook runs on the page cache. We
+ * do that in windows of SUM_WINDOW bytes, asking the kernel to read
+ * ahead the next window while we hash the current one and dropping
+ * the pages we are done with from our mapping, so that huge files
+ * don't grow our RSS. Anything that can't be mapped (pipes, stdin,
+ * empty or special files) goes through read(). If the file gets
+ * truncated while we hash it, touching the mapping past its new end
+ * raises SIGBUS on the hashing thread, we catch that and report the
+ * file as unreadable (EIO) instead of getting killed.
+ *
+ * Files are split among up to -j worker threads (by default one per
+ * online cpu), results are printed in order as they become available.
+ */
+
+#define SUM_WINDOW		(8UL << 20)
+#define SUM_READ_BUF		(64UL << 10)
+#define SUM_MAX_THREADS		256
+#define SUM_MAX_MD		64
+
+struct sum_alg {
+	const char *name;
+	size_t md_len;
+	void (*init) (sha3_ctx_t *ctx);
+};
+
+static const struct sum_alg sum_algs[] = {
+	{ "SHA3-224", 28, sha3_224_init },
+	{ "SHA3-256", 32, sha3_256_init },
+	{ "SHA3-384", 48, sha3_384_init },
+	{ "SHA3-512", 64, sha3_512_init },
+	{ NULL, 0, NULL }
+};
+
+struct sum_entry {
+	const char *name;
+	const struct sum_alg *alg;
+	/* For -c, the expected digest */
+	uint8_t expected[SUM_MAX_MD];
+	uint8_t md[SUM_MAX_MD];
+	int err;	/* errno, 0 on success */
+	int done;
+};
+
+struct sum_job {
+	struct sum_entry *entries;
+	size_t num_entries;
+	size_t next;
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+};
+
+static const char *prog_name = "sha3_sum";
+
+/* Where to jump on SIGBUS, set while a thread hashes from a mapping */
+static __thread sigjmp_buf *sum_bus_env = NULL;
+
+
+/*********\
+* HASHING *
+\*********/
+
+/* SIGBUS is delivered to the thread that touched the mapping, so if
+ * it's one of ours we go back to sum_mapped(), else it's a real bug */
+static void
+sum_sigbus(int sig)
+{
+	if (sum_bus_env)
+		siglongjmp(*sum_bus_env, 1);
+	signal(sig, SIG_DFL);
+	raise(sig);
+}
+
+/* Returns -1 if the file can't be mapped (use read() instead),
+ * 0 on success or an errno */
+static int
+sum_mapped(sha3_ctx_t *ctx, int fd, size_t size)
+{
+	sigjmp_buf env;
+	uint8_t *map = NULL;
+	size_t off = 0;
+	size_t len = 0;
+
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+
+	/* Truncated under us, ctx is garbage by now */
+	if (sigsetjmp(env, 1)) {
+		sum_bus_env = NULL;
+		munmap(map, size);
+		return EIO;
+	}
+	sum_bus_env = &env;
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	madvise(map, size, MADV_SEQUENTIAL);
+
+	for (off = 0; off < size; off += len) {
+		len = (size - off < SUM_WINDOW) ? (size - off) : SUM_WINDOW;
+		/* Start reading the next window while we hash this one */
+		if (off + len < size)
+			madvise(map + off + len, (size - off - len < SUM_WINDOW) ?
+				(size - off - len) : SUM_WINDOW, MADV_WILLNEED);
+		sha3_update(ctx, map + off, len);
+		/* They are still on the page cache, we just
+		 * drop them from our mapping */
+		madvise(map + off, len, MADV_DONTNEED);
+	}
+	sum_bus_env = NULL;
+
+	munmap(map, size);
+	return 0;
+}
+
+static int
+sum_read(sha3_ctx_t *ctx, int fd)
+{
+	uint8_t *buf = NULL;
+	ssize_t len = 0;
+	int ret = 0;
+
+	buf = malloc(SUM_READ_BUF);
+	if (!buf)
+		return ENOMEM;
+
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	while ((len = read(fd, buf, SUM_READ_BUF)) != 0) {
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+			ret = errno;
+			break;
+		}
+		sha3_update(ctx, buf, len);
+	}
+
+	free(buf);
+	return ret;
+}
+
+static int
+sum_file(struct sum_entry *ent)
+{
+	sha3_ctx_t ctx;
+	struct stat st;
+	int ret = 0;
+	int fd = 0;
+
+	if (!strcmp(ent->name, "-"))
+		fd = STDIN_FILENO;
+	else if ((fd = open(ent->name, O_RDONLY)) < 0)
+		return errno;
+
+	if (fstat(fd, &st) < 0) {
+		ret = errno;
+		goto done;
+	}
+	if (S_ISDIR(st.st_mode)) {
+		ret = EISDIR;
+		goto done;
+	}
+
+	/* Files we can't map in one go (on 32-bit
+	 * targets) also go through read() */
+	ent->alg->init(&ctx);
+	if (!S_ISREG(st.st_mode) || st.st_size <= 0 ||
+	    (off_t) (size_t) st.st_size != st.st_size ||
+	    (ret = sum_mapped(&ctx, fd, st.st_size)) < 0)
+		ret = sum_read(&ctx, fd);
+	if (!ret)
+		sha3_final(&ctx, ent->md);
+
+ done:
+	if (fd != STDIN_FILENO)
+		close(fd);
+	return ret;
+}
+
+static void *
+sum_worker(void *arg)
+{
+	struct sum_job *job = arg;
+	struct sum_entry *ent = NULL;
+	size_t i = 0;
+
+	while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) <
+	       job->num_entries) {
+		ent = &job->entries[i];
+		ent->err = sum_file(ent);
+
+		pthread_mutex_lock(&job->lock);
+		ent->done = 1;
+		pthread_cond_broadcast(&job->done_cond);
+		pthread_mutex_unlock(&job->lock);
+	}
+
+	return NULL;
+}
+
+/* Hash all entries, calling report() for each one in order */
+static void
+sum_entries(struct sum_entry *entries, size_t num_entries,
+	    unsigned int nthreads, void (*report) (struct sum_entry *ent))
+{
+	pthread_t threads[SUM_MAX_THREADS];
+	struct sum_job job = { 0 };
+	unsigned int started = 0;
+	size_t i = 0;
+
+	job.entries = entries;
+	job.num_entries = num_entries;
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.done_cond, NULL);
+
+	/* Stdin can only be read once, and it'd better be
+	 * in order, do everything on this thread then */
+	for (i = 0; i < num_entries; i++)
+		if (!strcmp(entries[i].name, "-"))
+			nthreads = 1;
+	if (nthreads > num_entries)
+		nthreads = num_entries;
+
+	for (i = 0; nthreads > 1 && i < nthreads; i++) {
+		if (pthread_create(&threads[started], NULL, sum_worker, &job))
+			break;
+		started++;
+	}
+
+	for (i = 0; i < num_entries; i++) {
+		if (!started) {
+			entries[i].err = sum_file(&entries[i]);
+		} else {
+			pthread_mutex_lock(&job.lock);
+			while (!entries[i].done)
+				pthread_cond_wait(&job.done_cond, &job.lock);
+			pthread_mutex_unlock(&job.lock);
+		}
+		report(&entries[i]);
+	}
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&job.done_cond);
+	pthread_mutex_destroy(&job.lock);
+}
+
+
+/********\
+* OUTPUT *
+\********/
+
+static int opt_binary = 0;
+static int opt_tag = 0;
+static int opt_quiet = 0;
+static int opt_status = 0;
+static int opt_warn = 0;
+static int opt_strict = 0;
+static unsigned int num_errors = 0;
+static unsigned int num_mismatches = 0;
+
+static int
+sum_needs_escape(const char *name)
+{
+	return strchr(name, '\\') || strchr(name, '\n') || strchr(name, '\r');
+}
+
+static void
+sum_print_name(const char *name, int escape)
+{
+	for (; *name; name++) {
+		if (escape && *name == '\\')
+			fputs("\\\\", stdout);
+		else if (escape && *name == '\n')
+			fputs("\\n", stdout);
+		else if (escape && *name == '\r')
+			fputs("\\r", stdout);
+		else
+			putchar(*name);
+	}
+}
+
+static void
+sum_print_hex(const uint8_t *md, size_t md_len)
+{
+	size_t i = 0;
+
+	for (i = 0; i < md_len; i++)
+		printf("%02x", md[i]);
+}
+
+static void
+sum_report(struct sum_entry *ent)
+{
+	int escape = sum_needs_escape(ent->name);
+
+	if (ent->err) {
+		fflush(stdout);
+		fprintf(stderr, "%s: %s: %s\n", prog_name, ent->name,
+			strerror(ent->err));
+		num_errors++;
+		return;
+	}
+
+	if (escape)
+		putchar('\\');
+	if (opt_tag) {
+		printf("%s (", ent->alg->name);
+		sum_print_name(ent->name, escape);
+		printf(") = ");
+		sum_print_hex(ent->md, ent->alg->md_len);
+	} else {
+		sum_print_hex(ent->md, ent->alg->md_len);
+		printf(" %c", opt_binary ? '*' : ' ');
+		sum_print_name(ent->name, escape);
+	}
+	putchar('\n');
+}
+
+static void
+sum_check_report(struct sum_entry *ent)
+{
+	int ok = !ent->err && !memcmp(ent->md, ent->expected,
+				      ent->alg->md_len);
+
+	if (ent->err) {
+		fflush(stdout);
+		if (!opt_status)
+			fprintf(stderr, "%s: %s: %s\n", prog_name, ent->name,
+				strerror(ent->err));
+		num_errors++;
+	} else if (!ok) {
+		num_mismatches++;
+	}
+
+	if (opt_status || (ok && opt_quiet))
+		return;
+
+	if (sum_needs_escape(ent->name))
+		putchar('\\');
+	sum_print_name(ent->name, sum_needs_escape(ent->name));
+	printf(": %s\n", ent->err ? "FAILED open or read" :
+	       ok ? "OK" : "FAILED");
+}
+
+
+/**********\
+* CHECKING *
+\**********/
+
+static int
+sum_unhex(const char *hex, size_t hex_len, uint8_t *out)
+{
+	unsigned int byte = 0;
+	size_t i = 0;
+
+	for (i = 0; i < hex_len; i++)
+		if (!hex[i] || !strchr("0123456789abcdefABCDEF", hex[i]))
+			return -1;
+	for (i = 0; i < hex_len / 2; i++) {
+		sscanf(hex + 2 * i, "%2x", &byte);
+		out[i] = byte;
+	}
+
+	return 0;
+}
+
+static const struct sum_alg *
+sum_alg_by_len(size_t md_len)
+{
+	const struct sum_alg *alg = NULL;
+
+	for (alg = sum_algs; alg->name; alg++)
+		if (alg->md_len == md_len)
+			return alg;
+	return NULL;
+}
+
+/* Undo the escaping in place */
+static void
+sum_unescape(char *name)
+{
+	char *out = name;
+
+	for (; *name; name++) {
+		if (*name == '\\' && name[1] == 'n') {
+			*out++ = '\n';
+			name++;
+		} else if (*name == '\\' && name[1] == 'r') {
+			*out++ = '\r';
+			name++;
+		} else if (*name == '\\' && name[1] == '\\') {
+			*out++ = '\\';
+			name++;
+		} else {
+			*out++ = *name;
+		}
+	}
+	*out = '\0';
+}
+
+/* Parse a line of a checksum list, in either format,
+ * the name points within the line */
+static int
+sum_parse_line(char *line, struct sum_entry *ent)
+{
+	const struct sum_alg *alg = NULL;
+	char *hex = NULL;
+	char *name = NULL;
+	char *end = NULL;
+	size_t hex_len = 0;
+	int escaped = 0;
+
+	if (*line == '\\') {
+		escaped = 1;
+		line++;
+	}
+
+	for (alg = sum_algs; alg->name; alg++)
+		if (!strncmp(line, alg->name, strlen(alg->name)) &&
+		    !strncmp(line + strlen(alg->name), " (", 2))
+			break;
+
+	if (alg->name) {
+		/* BSD style, the digest follows the last ") = " */
+		name = line + strlen(alg->name) + 2;
+		end = strstr(name, ") = ");
+		if (!end)
+			return -1;
+		while (strstr(end + 1, ") = "))
+			end = strstr(end + 1, ") = ");
+		*end = '\0';
+		hex = end + 4;
+		hex_len = strlen(hex);
+		if (hex_len != 2 * alg->md_len)
+			return -1;
+	} else {
+		hex = line;
+		hex_len = strcspn(line, " ");
+		alg = sum_alg_by_len(hex_len / 2);
+		if (!alg || hex_len != 2 * alg->md_len ||
+		    line[hex_len] != ' ' ||
+		    (line[hex_len + 1] != ' ' && line[hex_len + 1] != '*'))
+			return -1;
+		name = line + hex_len + 2;
+	}
+
+	if (!*name || sum_unhex(hex, hex_len, ent->expected))
+		return -1;
+	if (escaped)
+		sum_unescape(name);
+
+	ent->name = name;
+	ent->alg = alg;
+	return 0;
+}
+
+/* Verify the sums listed on file, returns non-zero on failure */
+static int
+sum_check_list(const char *list_name, unsigned int nthreads)
+{
+	struct sum_entry *entries = NULL;
+	struct sum_entry *tmp = NULL;
+	char **lines = NULL;
+	char **tmp_lines = NULL;
+	char *line = NULL;
+	size_t line_size = 0;
+	size_t num_entries = 0;
+	size_t cap = 0;
+	size_t lineno = 0;
+	size_t bad_lines = 0;
+	ssize_t len = 0;
+	FILE *list = NULL;
+	size_t i = 0;
+	int ret = 0;
+
+	list = strcmp(list_name, "-") ? fopen(list_name, "r") : stdin;
+	if (!list) {
+		fprintf(stderr, "%s: %s: %s\n", prog_name, list_name,
+			strerror(errno));
+		return 1;
+	}
+
+	num_errors = 0;
+	num_mismatches = 0;
+
+	while ((len = getline(&line, &line_size, list)) >= 0) {
+		lineno++;
+		if (len > 0 && line[len - 1] == '\n')
+			line[--len] = '\0';
+		if (len > 0 && line[len - 1] == '\r')
+			line[--len] = '\0';
+		/* Skip empty lines and comments */
+		if (!len || line[0] == '#')
+			continue;
+
+		if (num_entries == cap) {
+			cap = cap ? 2 * cap : 64;
+			tmp = realloc(entries, cap * sizeof(entries[0]));
+			tmp_lines = realloc(lines, cap * sizeof(lines[0]));
+			if (tmp)
+				entries = tmp;
+			if (tmp_lines)
+				lines = tmp_lines;
+			if (!tmp || !tmp_lines) {
+				fprintf(stderr, "%s: out of memory\n", prog_name);
+				ret = 1;
+				goto cleanup;
+			}
+		}
+
+		memset(&entries[num_entries], 0, sizeof(entries[0]));
+		if (sum_parse_line(line, &entries[num_entries])) {
+			bad_lines++;
+			if (opt_warn)
+				fprintf(stderr, "%s: %s: %zu: improperly "
+					"formatted SHA3 checksum line\n",
+					prog_name, list_name, lineno);
+			continue;
+		}
+
+		/* Names point within the line, keep it around */
+		lines[num_entries++] = line;
+		line = NULL;
+		line_size = 0;
+	}
+
+	if (!num_entries) {
+		fprintf(stderr, "%s: %s: no properly formatted SHA3 "
+			"checksum lines found\n", prog_name, list_name);
+		ret = 1;
+		goto cleanup;
+	}
+
+	sum_entries(entries, num_entries, nthreads, sum_check_report);
+
+	fflush(stdout);
+	if (!opt_status) {
+		if (bad_lines)
+			fprintf(stderr, "%s: WARNING: %zu line%s improperly "
+				"formatted\n", prog_name, bad_lines,
+				bad_lines > 1 ? "s are" : " is");
+		if (num_errors)
+			fprintf(stderr, "%s: WARNING: %u listed file%s could "
+				"not be read\n", prog_name, num_errors,
+				num_errors > 1 ? "s" : "");
+		if (num_mismatches)
+			fprintf(stderr, "%s: WARNING: %u computed checksum%s "
+				"did NOT match\n", prog_name, num_mismatches,
+				num_mismatches > 1 ? "s" : "");
+	}
+
+	ret = num_errors || num_mismatches || (opt_strict && bad_lines);
+
+ cleanup:
+	for (i = 0; i < num_entries; i++)
+		free(lines[i]);
+	free(lines);
+	free(entries);
+	free(line);
+	if (list != stdin)
+		fclose(list);
+	return ret;
+}
+
+
+/*************\
+* ENTRY POINT *
+\*************/
+
+static void
+usage(void)
+{
+	fprintf(stderr,
+		"Usage: %s [OPTION]... [FILE]...\n"
+		"Print or check SHA3 checksums, with no FILE, or when FILE\n"
+		"is -, read standard input.\n"
+		"  -a, --algorithm=N  224, 256 (default), 384 or 512\n"
+		"  -b, --binary       Mark files as binary (\" *\" separator)\n"
+		"  -t, --text         Mark files as text (default)\n"
+		"  -c, --check        Read checksums from the FILEs and check them\n"
+		"      --tag          BSD style output\n"
+		"  -j, --jobs=N       Hash up to N files in parallel (default\n"
+		"                     one per online cpu)\n"
+		"When checking:\n"
+		"      --quiet        Don't print OK for each verified file\n"
+		"      --status       Don't output anything, only the exit status\n"
+		"      --strict       Fail on improperly formatted lines\n"
+		"  -w, --warn         Warn about improperly formatted lines\n",
+		prog_name);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const struct option long_opts[] = {
+		{ "algorithm", required_argument, NULL, 'a' },
+		{ "binary", no_argument, NULL, 'b' },
+		{ "check", no_argument, NULL, 'c' },
+		{ "jobs", required_argument, NULL, 'j' },
+		{ "text", no_argument, NULL, 't' },
+		{ "warn", no_argument, NULL, 'w' },
+		{ "tag", no_argument, NULL, 'T' },
+		{ "quiet", no_argument, NULL, 'q' },
+		{ "status", no_argument, NULL, 's' },
+		{ "strict", no_argument, NULL, 'S' },
+		{ "help", no_argument, NULL, 'h' },
+		{ NULL, 0, NULL, 0 }
+	};
+	static char *stdin_name[] = { "-" };
+	const struct sum_alg *alg = &sum_algs[1];
+	struct sigaction sa = { 0 };
+	struct sum_entry *entries = NULL;
+	char **files = NULL;
+	unsigned int nthreads = 0;
+	size_t num_files = 0;
+	long ncpus = 0;
+	int check = 0;
+	int opt = 0;
+	int ret = 0;
+	size_t i = 0;
+
+	while ((opt = getopt_long(argc, argv, "a:bcj:twh", long_opts,
+				  NULL)) != -1) {
+		switch (opt) {
+		case 'a':
+			alg = sum_alg_by_len(strtoul(optarg, NULL, 10) / 8);
+			if (!alg || strtoul(optarg, NULL, 10) % 8) {
+				fprintf(stderr, "%s: invalid algorithm: %s\n",
+					prog_name, optarg);
+				return 1;
+			}
+			break;
+		case 'b':
+			opt_binary = 1;
+			break;
+		case 't':
+			opt_binary = 0;
+			break;
+		case 'c':
+			check = 1;
+			break;
+		case 'j':
+			nthreads = strtoul(optarg, NULL, 10);
+			break;
+		case 'w':
+			opt_warn = 1;
+			break;
+		case 'T':
+			opt_tag = 1;
+			break;
+		case 'q':
+			opt_quiet = 1;
+			break;
+		case 's':
+			opt_status = 1;
+			break;
+		case 'S':
+			opt_strict = 1;
+			break;
+		case 'h':
+			usage();
+			return 0;
+		default:
+			usage();
+			return 1;
+		}
+	}
+
+	if (!nthreads) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpus > 0) ? ncpus : 1;
+	}
+	if (nthreads > SUM_MAX_THREADS)
+		nthreads = SUM_MAX_THREADS;
+
+	sa.sa_handler = sum_sigbus;
+	sigemptyset(&sa.sa_mask);
+	sigaction(SIGBUS, &sa, NULL);
+
+	files = (optind < argc) ? argv + optind : stdin_name;
+	num_files = (optind < argc) ? (size_t) (argc - optind) : 1;
+
+	if (check) {
+		for (i = 0; i < num_files; i++)
+			ret |= sum_check_list(files[i], nthreads);
+		return ret;
+	}
+
+	entries = calloc(num_files, sizeof(entries[0]));
+	if (!entries) {
+		fprintf(stderr, "%s: out of memory\n", prog_name);
+		return 1;
+	}
+	for (i = 0; i < num_files; i++) {
+		entries[i].name = files[i];
+		entries[i].alg = alg;
+	}
+
+	sum_entries(entries, num_files, nthreads, sum_report);
+	free(entries);
+
+	return num_errors ? 1 : 0;
+}
@@ -0,0 +1,621 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 batch hashing service
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#define _GNU_SOURCE	/* For pthread_setaffinity_np() / CPU_SET() */
+#include "keccak1600.h"
+#include "sha3_svc.h"
+#include <pthread.h>	/* For pthread_*() */
+#include <sched.h>	/* For sched_getaffinity() */
+#include <stdlib.h>	/* For malloc() / qsort() */
+#include <unistd.h>	/* For sysconf() */
+
+/*
+ * Each worker owns a deque of jobs, submissions go to the back of
+ * it and the owner also takes jobs from the back (the most recent
+ * ones, whose inputs are more likely to still be in cache), while
+ * idle workers steal half of what's there from the front. Deques
+ * are small mutex-protected ring buffers, a worker takes a whole
+ * group of jobs each time it locks one so the lock isn't hot.
+ *
+ * Within each group, jobs up to SVC_SMALL_LEN bytes with the same
+ * algorithm, input and output length go to the widest multi-buffer
+ * engine available (as in sha3_batch()), anything else goes to the
+ * default engine (so through its absorb hook when it has one).
+ * Consecutive submissions from outside the service land on the same
+ * deque, in runs of SVC_SUBMIT_RUN, so that jobs submitted together
+ * end up in the same group.
+ */
+
+/* Jobs a worker takes at once */
+#define SVC_GROUP_MAX		(4 * KECCAK1600_MAX_WAYS)
+#define SVC_SUBMIT_RUN		KECCAK1600_MAX_WAYS
+/* Past that a job is big enough to keep a worker busy on
+ * its own and there is no point waiting for more of the
+ * same length, also multi-buffer engines lose their edge
+ * as inputs fall out of cache. */
+#define SVC_SMALL_LEN		4096
+/* Initial deque size, it doubles when full (power of 2) */
+#define SVC_DEQUE_INIT		256
+
+#define SVC_JOB_QUEUED		1
+#define SVC_JOB_DONE		2
+
+/* Job algorithms are sha3.c's, only
+ * call this for jobs we've validated */
+static inline const struct sha3_alg_info *
+svc_job_alg(const struct sha3_svc_job *job)
+{
+	return sha3_get_alg_info((enum sha3_alg) job->alg);
+}
+
+struct svc_deque {
+	pthread_mutex_t lock;
+	struct sha3_svc_job **jobs;
+	size_t size;
+	size_t head;	/* Oldest job, thieves take from here */
+	size_t tail;	/* Next free slot, the owner takes from here */
+};
+
+struct svc_worker {
+	struct sha3_svc *svc;
+	struct svc_deque dq;
+	pthread_t thread;
+	unsigned int idx;
+	int cpu;	/* To pin to, or -1 */
+};
+
+struct sha3_svc {
+	struct svc_worker *workers;
+	unsigned int num_workers;
+	unsigned int started;
+	unsigned int next_submit;
+	/* Jobs on the deques, and jobs submitted but not
+	 * completed, accessed atomically */
+	size_t queued;
+	size_t pending;
+	/* Threads sleeping on work_cond / done_cond,
+	 * updated with lock held, read atomically */
+	unsigned int sleepers;
+	unsigned int waiters;
+	int stop;
+	pthread_mutex_t lock;
+	pthread_cond_t work_cond;
+	pthread_cond_t done_cond;
+};
+
+/* The worker running on this thread (if any), so that jobs
+ * submitted from callbacks go to the worker's own deque */
+static __thread struct svc_worker *svc_self;
+
+
+/*********\
+* HELPERS *
+\*********/
+
+static inline size_t
+svc_job_md_len(const struct sha3_svc_job *job)
+{
+	const struct sha3_alg_info *alg = svc_job_alg(job);
+
+	return alg->md_len ? alg->md_len : job->md_len;
+}
+
+static int
+svc_job_cmp(const void *a, const void *b)
+{
+	const struct sha3_svc_job *ja = *(struct sha3_svc_job *const *) a;
+	const struct sha3_svc_job *jb = *(struct sha3_svc_job *const *) b;
+	size_t md_a = svc_job_md_len(ja);
+	size_t md_b = svc_job_md_len(jb);
+
+	if (ja->alg != jb->alg)
+		return (ja->alg < jb->alg) ? -1 : 1;
+	if (md_a != md_b)
+		return (md_a < md_b) ? -1 : 1;
+	return (ja->msg_len < jb->msg_len) ? -1 : (ja->msg_len > jb->msg_len);
+}
+
+static inline int
+svc_job_same(const struct sha3_svc_job *ja, const struct sha3_svc_job *jb)
+{
+	return ja->alg == jb->alg && ja->msg_len == jb->msg_len &&
+	       svc_job_md_len(ja) == svc_job_md_len(jb);
+}
+
+static inline int
+svc_job_valid(const struct sha3_svc_job *job)
+{
+	if ((unsigned int) job->alg >= SHA3_SVC_NUM_ALGS)
+		return 0;
+	return svc_job_md_len(job) != 0;
+}
+
+
+/********\
+* DEQUES *
+\********/
+
+static int
+svc_deque_init(struct svc_deque *dq)
+{
+	dq->jobs = malloc(SVC_DEQUE_INIT * sizeof(dq->jobs[0]));
+	if (!dq->jobs)
+		return -1;
+	dq->size = SVC_DEQUE_INIT;
+	dq->head = 0;
+	dq->tail = 0;
+	pthread_mutex_init(&dq->lock, NULL);
+	return 0;
+}
+
+static void
+svc_deque_fini(struct svc_deque *dq)
+{
+	pthread_mutex_destroy(&dq->lock);
+	free(dq->jobs);
+}
+
+/* Called with the lock held */
+static int
+svc_deque_grow(struct svc_deque *dq)
+{
+	struct sha3_svc_job **jobs = NULL;
+	size_t count = dq->tail - dq->head;
+	size_t i = 0;
+
+	jobs = malloc(2 * dq->size * sizeof(jobs[0]));
+	if (!jobs)
+		return -1;
+
+	for (i = 0; i < count; i++)
+		jobs[i] = dq->jobs[(dq->head + i) & (dq->size - 1)];
+
+	free(dq->jobs);
+	dq->jobs = jobs;
+	dq->size *= 2;
+	dq->head = 0;
+	dq->tail = count;
+	return 0;
+}
+
+static int
+svc_deque_push(struct svc_deque *dq, struct sha3_svc_job *job)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&dq->lock);
+	if (dq->tail - dq->head == dq->size)
+		ret = svc_deque_grow(dq);
+	if (!ret)
+		dq->jobs[dq->tail++ & (dq->size - 1)] = job;
+	pthread_mutex_unlock(&dq->lock);
+
+	return ret;
+}
+
+/* Owner side, most recent jobs first */
+static size_t
+svc_deque_pop(struct svc_deque *dq, struct sha3_svc_job **out, size_t max)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+	pthread_mutex_lock(&dq->lock);
+	count = dq->tail - dq->head;
+	if (count > max)
+		count = max;
+	for (i = 0; i < count; i++)
+		out[i] = dq->jobs[--dq->tail & (dq->size - 1)];
+	pthread_mutex_unlock(&dq->lock);
+
+	return count;
+}
+
+/* Thief side, half of the oldest jobs */
+static size_t
+svc_deque_steal(struct svc_deque *dq, struct sha3_svc_job **out, size_t max)
+{
+	size_t count = 0;
+	size_t i = 0;
+
+	pthread_mutex_lock(&dq->lock);
+	count = (dq->tail - dq->head + 1) / 2;
+	if (count > max)
+		count = max;
+	for (i = 0; i < count; i++)
+		out[i] = dq->jobs[dq->head++ & (dq->size - 1)];
+	pthread_mutex_unlock(&dq->lock);
+
+	return count;
+}
+
+
+/*********\
+* HASHING *
+\*********/
+
+static void
+svc_job_complete(struct sha3_svc *svc, struct sha3_svc_job *job)
+{
+	sha3_svc_donef done = job->done;
+
+	/* Past this point the job belongs to the caller again */
+	if (done)
+		done(job, job->done_arg);
+	else
+		__atomic_store_n(&job->state, SVC_JOB_DONE, __ATOMIC_SEQ_CST);
+
+	__atomic_sub_fetch(&svc->pending, 1, __ATOMIC_SEQ_CST);
+
+	/* Waiters increment the counter with the lock held before
+	 * checking if their job is done, so taking the lock here
+	 * means they are either asleep or will see it done. */
+	if (__atomic_load_n(&svc->waiters, __ATOMIC_SEQ_CST)) {
+		pthread_mutex_lock(&svc->lock);
+		pthread_cond_broadcast(&svc->done_cond);
+		pthread_mutex_unlock(&svc->lock);
+	}
+}
+
+static void
+svc_hash_one(struct sha3_svc_job *job)
+{
+	const struct sha3_alg_info *alg = svc_job_alg(job);
+
+	keccakp1600_oneshot(NULL, KECCAK1600_NUM_ROUNDS, alg->rate_bytes,
+			    job->msg, job->msg_len, job->md,
+			    svc_job_md_len(job), alg->delim);
+}
+
+/* A run of jobs with the same algorithm, input and output length */
+static void
+svc_hash_run(struct sha3_svc *svc, struct sha3_svc_job **jobs, size_t count)
+{
+	const struct sha3_alg_info *alg = svc_job_alg(jobs[0]);
+	const void *mb_msgs[KECCAK1600_MAX_WAYS];
+	void *mb_mds[KECCAK1600_MAX_WAYS];
+	const k1600_mb_engine_t *eng = NULL;
+	unsigned int ways = KECCAK1600_MAX_WAYS;
+	unsigned int k = 0;
+	size_t i = 0;
+
+	for (i = 0; i < count; i += ways) {
+		/* Pick the widest engine that fits */
+		while (ways > 1 && (count - i < ways ||
+		       !keccakf1600_get_mb_engine(ways)))
+			ways >>= 1;
+
+		if (ways == 1) {
+			svc_hash_one(jobs[i]);
+			svc_job_complete(svc, jobs[i]);
+			continue;
+		}
+
+		for (k = 0; k < ways; k++) {
+			mb_msgs[k] = jobs[i + k]->msg;
+			mb_mds[k] = jobs[i + k]->md;
+		}
+		eng = keccakf1600_get_mb_engine(ways);
+		keccakp1600_oneshot_mb(eng, KECCAK1600_NUM_ROUNDS,
+				       alg->rate_bytes, mb_msgs,
+				       jobs[i]->msg_len, mb_mds,
+				       svc_job_md_len(jobs[i]), alg->delim);
+		for (k = 0; k < ways; k++)
+			svc_job_complete(svc, jobs[i + k]);
+	}
+}
+
+static void
+svc_hash_group(struct sha3_svc *svc, struct sha3_svc_job **jobs, size_t count)
+{
+	size_t run = 0;
+	size_t i = 0;
+
+	if (count > 1)
+		qsort(jobs, count, sizeof(jobs[0]), svc_job_cmp);
+
+	for (i = 0; i < count; i += run) {
+		if (jobs[i]->msg_len > SVC_SMALL_LEN) {
+			run = 1;
+			svc_hash_one(jobs[i]);
+			svc_job_complete(svc, jobs[i]);
+			continue;
+		}
+
+		for (run = 1; i + run < count &&
+		     svc_job_same(jobs[i], jobs[i + run]); run++);
+		svc_hash_run(svc, &jobs[i], run);
+	}
+}
+
+
+/*********\
+* WORKERS *
+\*********/
+
+/* Grab a group of jobs, first from our own deque
+ * and if it's empty from the others, in order. */
+static size_t
+svc_grab(struct svc_worker *w, struct sha3_svc_job **jobs)
+{
+	struct sha3_svc *svc = w->svc;
+	size_t count = 0;
+	unsigned int i = 0;
+
+	count = svc_deque_pop(&w->dq, jobs, SVC_GROUP_MAX);
+	for (i = 1; !count && i < svc->num_workers; i++)
+		count = svc_deque_steal(&svc->workers[(w->idx + i) %
+						      svc->num_workers].dq,
+					jobs, SVC_GROUP_MAX);
+
+	if (count)
+		__atomic_sub_fetch(&svc->queued, count, __ATOMIC_SEQ_CST);
+
+	return count;
+}
+
+/* Sleep until there is work to do, returns 0 when it's time to stop */
+static int
+svc_idle(struct sha3_svc *svc)
+{
+	int ret = 0;
+
+	pthread_mutex_lock(&svc->lock);
+	/* Pairs with svc_wake(), queued is incremented before
+	 * it checks for sleepers, and we check queued after
+	 * incrementing sleepers. */
+	__atomic_add_fetch(&svc->sleepers, 1, __ATOMIC_SEQ_CST);
+	while (!__atomic_load_n(&svc->queued, __ATOMIC_SEQ_CST) && !svc->stop)
+		pthread_cond_wait(&svc->work_cond, &svc->lock);
+	__atomic_sub_fetch(&svc->sleepers, 1, __ATOMIC_SEQ_CST);
+	ret = !svc->stop;
+	pthread_mutex_unlock(&svc->lock);
+
+	return ret;
+}
+
+static void
+svc_wake(struct sha3_svc *svc, int all)
+{
+	if (!__atomic_load_n(&svc->sleepers, __ATOMIC_SEQ_CST))
+		return;
+
+	pthread_mutex_lock(&svc->lock);
+	if (all)
+		pthread_cond_broadcast(&svc->work_cond);
+	else
+		pthread_cond_signal(&svc->work_cond);
+	pthread_mutex_unlock(&svc->lock);
+}
+
+static void *
+svc_worker_main(void *arg)
+{
+	struct svc_worker *w = arg;
+	struct sha3_svc_job *jobs[SVC_GROUP_MAX];
+	size_t count = 0;
+#ifdef __linux__
+	cpu_set_t set;
+
+	if (w->cpu >= 0) {
+		CPU_ZERO(&set);
+		CPU_SET(w->cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+#endif
+	svc_self = w;
+
+	for (;;) {
+		count = svc_grab(w, jobs);
+		if (count) {
+			svc_hash_group(w->svc, jobs, count);
+			continue;
+		}
+		if (!svc_idle(w->svc))
+			break;
+	}
+
+	return NULL;
+}
+
+/* Pick a cpu for each worker out of the ones we may run on */
+static void
+svc_assign_cpus(struct sha3_svc *svc, int pin)
+{
+	unsigned int i = 0;
+#ifdef __linux__
+	cpu_set_t set;
+	int cpu = -1;
+	int count = 0;
+
+	if (pin && !sched_getaffinity(0, sizeof(set), &set))
+		count = CPU_COUNT(&set);
+
+	for (i = 0; i < svc->num_workers; i++) {
+		svc->workers[i].cpu = -1;
+		if (!count)
+			continue;
+		/* Wrap around if there are more workers than cpus */
+		do {
+			cpu = (cpu + 1) % CPU_SETSIZE;
+		} while (!CPU_ISSET(cpu, &set));
+		svc->workers[i].cpu = cpu;
+	}
+#else
+	(void) pin;
+	for (i = 0; i < svc->num_workers; i++)
+		svc->workers[i].cpu = -1;
+#endif
+}
+
+
+/**************\
+* ENTRY POINTS *
+\**************/
+
+sha3_svc_t *
+sha3_svc_create(unsigned int nthreads, int pin)
+{
+	struct sha3_svc *svc = NULL;
+	unsigned int i = 0;
+	long ncpus = 0;
+
+	if (!nthreads) {
+		ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpus > 0) ? ncpus : 1;
+	}
+
+	svc = calloc(1, sizeof(*svc));
+	if (!svc)
+		return NULL;
+
+	svc->workers = calloc(nthreads, sizeof(svc->workers[0]));
+	if (!svc->workers) {
+		free(svc);
+		return NULL;
+	}
+
+	for (i = 0; i < nthreads; i++) {
+		if (svc_deque_init(&svc->workers[i].dq))
+			break;
+		svc->workers[i].svc = svc;
+		svc->workers[i].idx = i;
+	}
+	svc->num_workers = i;
+
+	pthread_mutex_init(&svc->lock, NULL);
+	pthread_cond_init(&svc->work_cond, NULL);
+	pthread_cond_init(&svc->done_cond, NULL);
+	svc_assign_cpus(svc, pin);
+
+	/* If some of the threads fail to start, the jobs that go to
+	 * their deques will get stolen by the ones that did start */
+	for (i = 0; i < svc->num_workers; i++) {
+		if (pthread_create(&svc->workers[i].thread, NULL,
+				   svc_worker_main, &svc->workers[i]))
+			break;
+		svc->started++;
+	}
+
+	if (!svc->started) {
+		sha3_svc_destroy(svc);
+		return NULL;
+	}
+
+	return svc;
+}
+
+void
+sha3_svc_destroy(sha3_svc_t *svc)
+{
+	unsigned int i = 0;
+
+	if (!svc)
+		return;
+
+	sha3_svc_drain(svc);
+
+	pthread_mutex_lock(&svc->lock);
+	svc->stop = 1;
+	pthread_cond_broadcast(&svc->work_cond);
+	pthread_mutex_unlock(&svc->lock);
+
+	for (i = 0; i < svc->started; i++)
+		pthread_join(svc->workers[i].thread, NULL);
+
+	for (i = 0; i < svc->num_workers; i++)
+		svc_deque_fini(&svc->workers[i].dq);
+
+	pthread_cond_destroy(&svc->done_cond);
+	pthread_cond_destroy(&svc->work_cond);
+	pthread_mutex_destroy(&svc->lock);
+	free(svc->workers);
+	free(svc);
+}
+
+/* Queue a single job, if we can't (the deque couldn't grow)
+ * hash it on the caller's thread instead */
+static void
+svc_queue(struct sha3_svc *svc, struct sha3_svc_job *job)
+{
+	struct svc_worker *w = svc_self;
+	unsigned int idx = 0;
+
+	if (!w || w->svc != svc) {
+		idx = __atomic_fetch_add(&svc->next_submit, 1, __ATOMIC_RELAXED);
+		w = &svc->workers[(idx / SVC_SUBMIT_RUN) % svc->num_workers];
+	}
+
+	job->state = SVC_JOB_QUEUED;
+	__atomic_add_fetch(&svc->pending, 1, __ATOMIC_SEQ_CST);
+	__atomic_add_fetch(&svc->queued, 1, __ATOMIC_SEQ_CST);
+
+	if (svc_deque_push(&w->dq, job)) {
+		__atomic_sub_fetch(&svc->queued, 1, __ATOMIC_SEQ_CST);
+		svc_hash_one(job);
+		svc_job_complete(svc, job);
+	}
+}
+
+int
+sha3_svc_submit(sha3_svc_t *svc, struct sha3_svc_job *job)
+{
+	if (!svc_job_valid(job))
+		return -1;
+
+	svc_queue(svc, job);
+	svc_wake(svc, 0);
+	return 0;
+}
+
+int
+sha3_svc_submit_n(sha3_svc_t *svc, struct sha3_svc_job *jobs, size_t n)
+{
+	size_t i = 0;
+
+	for (i = 0; i < n; i++)
+		if (!svc_job_valid(&jobs[i]))
+			return -1;
+
+	for (i = 0; i < n; i++)
+		svc_queue(svc, &jobs[i]);
+	svc_wake(svc, n > 1);
+	return 0;
+}
+
+int
+sha3_svc_job_done(const struct sha3_svc_job *job)
+{
+	return __atomic_load_n(&job->state, __ATOMIC_ACQUIRE) == SVC_JOB_DONE;
+}
+
+void
+sha3_svc_wait(sha3_svc_t *svc, const struct sha3_svc_job *job)
+{
+	if (sha3_svc_job_done(job))
+		return;
+
+	pthread_mutex_lock(&svc->lock);
+	__atomic_add_fetch(&svc->waiters, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&job->state, __ATOMIC_SEQ_CST) != SVC_JOB_DONE)
+		pthread_cond_wait(&svc->done_cond, &svc->lock);
+	__atomic_sub_fetch(&svc->waiters, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&svc->lock);
+}
+
+void
+sha3_svc_drain(sha3_svc_t *svc)
+{
+	if (!__atomic_load_n(&svc->pending, __ATOMIC_SEQ_CST))
+		return;
+
+	pthread_mutex_lock(&svc->lock);
+	__atomic_add_fetch(&svc->waiters, 1, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&svc->pending, __ATOMIC_SEQ_CST))
+		pthread_cond_wait(&svc->done_cond, &svc->lock);
+	__atomic_sub_fetch(&svc->waiters, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&svc->lock);
+}
@@ -0,0 +1,82 @@
+// SPDX-License-Identifier: BSD-2-Clause
+/*
+ * SHA3 batch hashing service
+ * Copyright (C) 2024 Nick Kossifidis <mick@ics.forth.gr>
+ */
+
+#ifndef _SHA3_SVC_H
+#define _SHA3_SVC_H
+
+/*
+ * A pool of worker threads (one per core by default, optionally
+ * pinned) that hash independent jobs submitted from any thread.
+ * Each worker has its own job queue and when it runs out of jobs
+ * it steals from the others, small jobs of the same algorithm and
+ * length are hashed together using the multi-buffer engines, and
+ * large ones go through the default engine one at a time.
+ *
+ * Jobs are owned by the caller, they must stay around (together
+ * with their input / output buffers) until they complete. A job
+ * completes either by calling its done callback (from the worker
+ * thread), after which the service doesn't touch it again so it
+ * may be freed / reused from there, or if there is no callback,
+ * by marking it as done, so that it can be polled / waited on.
+ */
+
+#include <stddef.h>	/* For size_t */
+#include "sha3.h"
+
+/* Same as enum sha3_alg, the parameters come from sha3_get_alg_info() */
+enum sha3_svc_alg {
+	SHA3_SVC_SHA3_224 = SHA3_ALG_SHA3_224,
+	SHA3_SVC_SHA3_256 = SHA3_ALG_SHA3_256,
+	SHA3_SVC_SHA3_384 = SHA3_ALG_SHA3_384,
+	SHA3_SVC_SHA3_512 = SHA3_ALG_SHA3_512,
+	SHA3_SVC_SHAKE128 = SHA3_ALG_SHAKE128,
+	SHA3_SVC_SHAKE256 = SHA3_ALG_SHAKE256,
+	SHA3_SVC_KECCAK_256 = SHA3_ALG_KECCAK_256,
+	SHA3_SVC_KECCAK_512 = SHA3_ALG_KECCAK_512,
+	SHA3_SVC_NUM_ALGS = SHA3_NUM_ALGS
+};
+
+struct sha3_svc_job;
+typedef void (*sha3_svc_donef) (struct sha3_svc_job *job, void *arg);
+
+struct sha3_svc_job {
+	const void *msg;
+	size_t msg_len;
+	enum sha3_svc_alg alg;
+	void *md;
+	/* Output length for SHAKE, ignored for the rest */
+	size_t md_len;
+	/* Optional completion callback */
+	sha3_svc_donef done;
+	void *done_arg;
+	/* Private */
+	int state;
+};
+
+typedef struct sha3_svc sha3_svc_t;
+
+/* Start nthreads workers (0 means one for each online cpu),
+ * when pin is set each one is bound to a different cpu out
+ * of the ones we are allowed to run on. Returns NULL if no
+ * worker could be started. */
+sha3_svc_t *sha3_svc_create(unsigned int nthreads, int pin);
+/* Waits for all submitted jobs and stops the workers */
+void sha3_svc_destroy(sha3_svc_t *svc);
+
+/* Queue jobs for hashing, returns -1 (without queueing
+ * anything) if any of them has an invalid algorithm or
+ * a SHAKE output length of 0. */
+int sha3_svc_submit(sha3_svc_t *svc, struct sha3_svc_job *job);
+int sha3_svc_submit_n(sha3_svc_t *svc, struct sha3_svc_job *jobs, size_t n);
+
+/* For jobs without a callback, check if the job is done or
+ * wait for it, those shouldn't be called from callbacks. */
+int sha3_svc_job_done(const struct sha3_svc_job *job);
+void sha3_svc_wait(sha3_svc_t *svc, const struct sha3_svc_job *job);
+/* Wait for all submitted jobs to complete */
+void sha3_svc_drain(sha3_svc_t *svc);
+
+#endif /* _SHA3_SVC_H */
@@ -10,6 +10,10 @@
 #include <string.h>	/* For memset() */
 #include "keccak1600.h"
 #include "sha3.h"
+#ifndef OSSL_BUILD
+#include "k12.h"
+#include "kmac.h"
+#endif
 
 /*
  * To verify the output check out:
@@ -27,8 +31,20 @@ sha3_print(const char* md, size_t md_len)
 
 static clock_t
 sha3_test(int print, char* amillion_as) {
+	char md224[28] = {0};
 	char md256[32] = {0};
+	char md384[48] = {0};
 	char md512[64] = {0};
+	char xof[512] = {0};
+#ifndef OSSL_BUILD
+	char batch_md[KECCAK1600_MAX_WAYS][32] = {0};
+	char kmac_key[32] = {0};
+	const void *batch_msgs[KECCAK1600_MAX_WAYS] = {0};
+	void *batch_mds[KECCAK1600_MAX_WAYS] = {0};
+	size_t batch_lens[KECCAK1600_MAX_WAYS] = {0};
+	sha3_ctx_t ctx;
+	size_t i = 0;
+#endif
 	clock_t start = 0;
 	clock_t end = 0;
 
@@ -46,12 +62,24 @@ sha3_test(int print, char* amillion_as) {
 		sha3_print((const char*) md512, 64);
 	}
 
+	sha3_224_oneshot("abc", 3, md224);
+	if(print) {
+		printf("SHA3-224 of \"abc\":\t\t");
+		sha3_print((const char*) md224, 28);
+	}
+
 	sha3_256_oneshot("abc", 3, md256);
 	if(print) {
 		printf("SHA3-256 of \"abc\":\t\t");
 		sha3_print((const char*) md256, 32);
 	}
 
+	sha3_384_oneshot("abc", 3, md384);
+	if(print) {
+		printf("SHA3-384 of \"abc\":\t\t");
+		sha3_print((const char*) md384, 48);
+	}
+
 	sha3_512_oneshot("abc", 3, md512);
 	if(print) {
 		printf("SHA3-512 of \"abc\":\t\t");
@@ -64,7 +92,7 @@ sha3_test(int print, char* amillion_as) {
 		sha3_print((const char*) md256, 32);
 	}
 
-	sha3_512_oneshot("test", 3, md512);
+	sha3_512_oneshot("test", 4, md512);
 	if(print) {
 		printf("SHA3-512 of \"test\":\t\t");
 		sha3_print((const char*) md512, 64);
@@ -82,11 +110,131 @@ sha3_test(int print, char* amillion_as) {
 		sha3_print((const char*) md512, 64);
 	}
 
+	shake128_oneshot("", 0, md256, 32);
+	if(print) {
+		printf("SHAKE128 of empty string:\t");
+		sha3_print((const char*) md256, 32);
+	}
+
+	shake256_oneshot("", 0, md512, 64);
+	if(print) {
+		printf("SHAKE256 of empty string:\t");
+		sha3_print((const char*) md512, 64);
+	}
+
+	/* Print the tail, so that it comes out of the
+	 * state after a few squeeze permutations */
+	shake128_oneshot("abc", 3, xof, sizeof(xof));
+	if(print) {
+		printf("SHAKE128 of \"abc\" (tail):\t");
+		sha3_print((const char*) xof + sizeof(xof) - 32, 32);
+	}
+
+#ifndef OSSL_BUILD
+	/* Same but squeezed in chunks that don't line up
+	 * with the rate (or the lanes) */
+	memset(xof, 0, sizeof(xof));
+	shake128_init(&ctx);
+	sha3_update(&ctx, "abc", 3);
+	for(i = 0; i < sizeof(xof); i += 13)
+		shake_squeeze(&ctx, xof + i, (sizeof(xof) - i) < 13 ? (sizeof(xof) - i) : 13);
+	if(print) {
+		printf("SHAKE128 of \"abc\" (chunked):\t");
+		sha3_print((const char*) xof + sizeof(xof) - 32, 32);
+	}
+
+	/* Same as above but fed in chunks that don't
+	 * line up with the rate, to exercise the
+	 * partial block handling of the incremental API */
+	sha3_256_init(&ctx);
+	for(i = 0; i < 1000000; i += 137)
+		sha3_update(&ctx, amillion_as + i, (1000000 - i) < 137 ? (1000000 - i) : 137);
+	sha3_final(&ctx, md256);
+	if(print) {
+		printf("SHA3-256 of 1mil 'a's (stream):\t");
+		sha3_print((const char*) md256, 32);
+	}
+
+	/* Pre-FIPS 202 padding, as used by Ethereum */
+	keccak_256_oneshot("", 0, md256);
+	if(print) {
+		printf("Keccak-256 of empty string:\t");
+		sha3_print((const char*) md256, 32);
+	}
+
+	/* Hash "abc" on all ways of the multi-buffer engine */
+	for(i = 0; i < KECCAK1600_MAX_WAYS; i++) {
+		batch_msgs[i] = "abc";
+		batch_lens[i] = 3;
+		batch_mds[i] = batch_md[i];
+	}
+	sha3_256_batch(batch_msgs, batch_lens, batch_mds, KECCAK1600_MAX_WAYS);
+	if(print) {
+		printf("SHA3-256 of 8x\"abc\" (batch):\t");
+		sha3_print((const char*) batch_md[KECCAK1600_MAX_WAYS - 1], 32);
+	}
+
+	/* KangarooTwelve, the second one goes through
+	 * the tree using all cpus, see RFC 9861 for
+	 * more test vectors */
+	k12_oneshot("", 0, "", 0, md256, 32, 0);
+	if(print) {
+		printf("K12 of empty string:\t\t");
+		sha3_print((const char*) md256, 32);
+	}
+
+	k12_oneshot(amillion_as, 1000000, "", 0, md256, 32, 0);
+	if(print) {
+		printf("K12 of 1mil 'a's:\t\t");
+		sha3_print((const char*) md256, 32);
+	}
+
+	/* KMAC128 sample 1 from NIST's SP 800-185 examples,
+	 * with a key of 0x40 - 0x5F and 00 01 02 03 */
+	for(i = 0; i < 32; i++)
+		kmac_key[i] = 0x40 + i;
+	kmac128_oneshot(kmac_key, 32, "\x00\x01\x02\x03", 4, "", 0, md256, 32);
+	if(print) {
+		printf("KMAC128 sample 1:\t\t");
+		sha3_print((const char*) md256, 32);
+	}
+#endif
+
 	end = clock();
 
 	return (end - start);
 }
 
+#ifndef OSSL_BUILD
+/* Hash ways copies of 1mil 'a's with a multi-buffer engine */
+static clock_t
+sha3_test_mb(int print, const k1600_mb_engine_t *eng, char* amillion_as) {
+	char md256[KECCAK1600_MAX_WAYS][32] = {0};
+	const void *msgs[KECCAK1600_MAX_WAYS] = {0};
+	void *mds[KECCAK1600_MAX_WAYS] = {0};
+	unsigned int i = 0;
+	clock_t start = 0;
+	clock_t end = 0;
+
+	for(i = 0; i < eng->ways; i++) {
+		msgs[i] = amillion_as;
+		mds[i] = md256[i];
+	}
+
+	start = clock();
+
+	keccakf1600_oneshot_mb(eng, msgs, 1000000, mds, 32, 0x06);
+	if(print) {
+		printf("SHA3-256 of %ux1mil 'a's:\t", eng->ways);
+		sha3_print((const char*) md256[eng->ways - 1], 32);
+	}
+
+	end = clock();
+
+	return (end - start);
+}
+#endif
+
 int
 main()
 {
@@ -95,6 +243,9 @@ main()
 	double n = 10;
 	char *amillion_as = NULL;
 	int i = 0;
+#ifndef OSSL_BUILD
+	int j = 0;
+#endif
 
 	amillion_as = malloc(sizeof(char) * 1000000);
 	memset(amillion_as, 0x61, sizeof(char) * 1000000);
@@ -110,7 +261,7 @@ main()
 #else
 	printf("\nReference implementation\n");
 	printf("========================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_ref, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_ref);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -120,7 +271,7 @@ main()
 
 	printf("\nIn-place unrolled\n");
 	printf("=================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_inplaceur, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_inplaceur);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -130,7 +281,7 @@ main()
 
 	printf("\nUnrolled with intermediate state (cache friendly)\n");
 	printf("=================================================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_intermediateur, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_intermediateur);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -140,7 +291,7 @@ main()
 
 	printf("\nUnrolled with intermediate state + early parity\n");
 	printf("===============================================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_intermediateur_ep, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_intermediateur_ep);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -150,7 +301,7 @@ main()
 
 	printf("\nUnrolled with intermediate state + lane complementing\n");
 	printf("=====================================================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_intermediateur_lc, 1);
+	keccakf1600_set_default_engine(&keccakf1600_engine_intermediateur_lc);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -160,7 +311,7 @@ main()
 #ifdef RVASM_IMPL
 	printf("\nUnrolled with intermediate state (RV64I)\n");
 	printf("========================================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_intermediateur_rv64i, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_intermediateur_rv64i);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
@@ -170,12 +321,48 @@ main()
 
 	printf("\nIn-place unrolled (RV64ID)\n");
 	printf("==========================\n");
-	keccakf1600_set_permutation_function(&keccakf1600_state_permute_inplaceur_rv64id, 0);
+	keccakf1600_set_default_engine(&keccakf1600_engine_inplaceur_rv64id);
 	for(i = 0; i < n; i++) {
 		test_dur = (double) sha3_test(!i, amillion_as);
 		ema = (test_dur + (n - 1) * ema) / n;
 	}
 	printf("Test took an avg of %lg sec (%lg clock ticks)\n", ema / CLOCKS_PER_SEC, ema);
+	ema = 0;
 #endif /* RVASM_IMPL */
+#ifdef __x86_64__
+	if (keccakf1600_engine_supported(&keccakf1600_engine_avx512)) {
+		printf("\nOne plane per register (AVX-512)\n");
+		printf("================================\n");
+		keccakf1600_set_default_engine(&keccakf1600_engine_avx512);
+		for(i = 0; i < n; i++) {
+			test_dur = (double) sha3_test(!i, amillion_as);
+			ema = (test_dur + (n - 1) * ema) / n;
+		}
+		printf("Test took an avg of %lg sec (%lg clock ticks)\n", ema / CLOCKS_PER_SEC, ema);
+		ema = 0;
+	}
+#endif
+
+	for(j = 0; keccakf1600_mb_engines[j]; j++) {
+		if (!keccakf1600_mb_engine_supported(keccakf1600_mb_engines[j]))
+			continue;
+		printf("\nMulti-buffer (%s)\n", keccakf1600_mb_engines[j]->name);
+		printf("=================================\n");
+		for(i = 0; i < n; i++) {
+			test_dur = (double) sha3_test_mb(!i, keccakf1600_mb_engines[j], amillion_as);
+			ema = (test_dur + (n - 1) * ema) / n;
+		}
+		printf("Test took an avg of %lg sec (%lg clock ticks)\n", ema / CLOCKS_PER_SEC, ema);
+		ema = 0;
+	}
+
+	printf("\nAuto-selected after calibration\n");
+	printf("===============================\n");
+	printf("Using: %s\n", keccakf1600_autoselect(1)->name);
+	for(i = 0; i < n; i++) {
+		test_dur = (double) sha3_test(!i, amillion_as);
+		ema = (test_dur + (n - 1) * ema) / n;
+	}
+	printf("Test took an avg of %lg sec (%lg clock ticks)\n", ema / CLOCKS_PER_SEC, ema);
 #endif /* OSSL_BUILD */
 }